@@ -0,0 +1,39 @@
+# Copyright 2021 Jan Stephan
+#
+# Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+# the European Commission - subsequent versions of the EUPL (the “Licence”).
+# You may not use this work except in compliance with the Licence.
+# You may obtain a copy of the Licence at:
+#
+#     http://ec.europa.eu/idabc/eupl.html
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+#  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#  Licence permissions and limitations under the Licence.
+
+# This will define:
+# SystemTapSDT_FOUND - System has the SystemTap SDT header
+#
+# SystemTapSDT::SystemTapSDT - target for using the SDT header
+# SYSTEMTAP_SDT_INCLUDE_DIR - include directory containing sys/sdt.h
+
+include(FindPackageHandleStandardArgs)
+
+# The SDT header is header-only; there is no library to link against
+find_path(SYSTEMTAP_SDT_INCLUDE_DIR
+          NAMES sys/sdt.h
+          PATHS /usr/include /usr/local/include)
+
+find_package_handle_standard_args(
+    SystemTapSDT DEFAULT_MSG
+    SYSTEMTAP_SDT_INCLUDE_DIR
+)
+
+if(SystemTapSDT_FOUND AND NOT TARGET SystemTapSDT::SystemTapSDT)
+    add_library(SystemTapSDT::SystemTapSDT INTERFACE IMPORTED)
+    set_target_properties(SystemTapSDT::SystemTapSDT PROPERTIES
+                          INTERFACE_INCLUDE_DIRECTORIES ${SYSTEMTAP_SDT_INCLUDE_DIR})
+endif()
+
+mark_as_advanced(SYSTEMTAP_SDT_INCLUDE_DIR)
@@ -0,0 +1,12 @@
+auto submit(thread_pool& pool)
+{
+    using namespace bactria::ranges;
+
+    // Started on the submitting thread
+    auto task_range = AsyncRange{"Task", color::yellow};
+
+    pool.enqueue([r = std::move(task_range)]() mutable {
+        work();
+        r.stop(); // Stopped on the worker thread
+    });
+}
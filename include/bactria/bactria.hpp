@@ -23,15 +23,27 @@
 #pragma once
 
 #include <bactria/core/Activation.hpp>
+#include <bactria/core/Capture.hpp>
 #include <bactria/core/Context.hpp>
 #include <bactria/metrics/Phase.hpp>
 #include <bactria/metrics/Sector.hpp>
 #include <bactria/metrics/Tags.hpp>
+#include <bactria/metrics/Work.hpp>
+#include <bactria/ranges/AsyncRange.hpp>
 #include <bactria/ranges/Category.hpp>
+#include <bactria/ranges/ClockDomain.hpp>
 #include <bactria/ranges/Colors.hpp>
+#include <bactria/ranges/Correlation.hpp>
+#include <bactria/ranges/Counter.hpp>
 #include <bactria/ranges/Event.hpp>
+#include <bactria/ranges/Flow.hpp>
 #include <bactria/ranges/Marker.hpp>
+#include <bactria/ranges/Payload.hpp>
 #include <bactria/ranges/Range.hpp>
+#include <bactria/ranges/Sampler.hpp>
+#include <bactria/ranges/ScopedRange.hpp>
+#include <bactria/ranges/Span.hpp>
+#include <bactria/ranges/Timeline.hpp>
 #include <bactria/reports/Incident.hpp>
 #include <bactria/reports/IncidentRecorder.hpp>
 #include <bactria/reports/Report.hpp>
\ No newline at end of file
@@ -77,14 +77,26 @@ namespace bactria
      * bactria itself is platform-independent and provides a unified modern C++ API to the user. The profiling and/or
      * tracing information are collected by its various plugins:
      *
-     * * JSON: Supported on all platforms. Used for saving user-defined metrics to disk.
+     * * JSON: Supported on all platforms. Used for saving user-defined metrics to disk and for writing traces in the
+     * Trace Event Format understood by `chrome://tracing` and Perfetto (see `BACTRIA_JSON_TRACE_FILE`).
+     * * latency: Supported on all platforms. Matches both ends of every `Flow` instance and prints the latency
+     * distribution per flow name at exit (see `BACTRIA_LATENCY_FILE`).
+     * * ftrace: Supported on Linux. Writes events and time spans to the kernel's `trace_marker` so they appear on the
+     *   same timeline as scheduling, interrupt and block I/O events in `trace-cmd`, KernelShark or Perfetto. If tracefs
+     *   is not writable the records are written to a regular file instead (see `BACTRIA_FTRACE_FILE` and
+     *   `BACTRIA_FTRACE_RAW`).
      * * stdout: Supported on all platforms. Used for tracing events and time spans and printing them to stdout.
+     * * native: Supported on Linux. Builds a call-path profile of all sectors and phases (number of calls,
+     * inclusive and exclusive time) without any external tool chain and writes it to `bactria_profile_<pid>.txt`.
      * * Score-P: Supported on Linux. Used for collecting various metrics (such as hardware counters) and saving them
      *   to disk for later analysis.
      * * NVTX: Supported on all platforms. Used for tracing events and time spans and visualizing them on NVIDIA's
      *   visual profilers.
      * * rocTX: Supported on Linux. Used for tracing events and time spans and visualizing them on Chrome's
      *   `about:tracing` tool (used by AMD's ROCm).
+     * * USDT: Supported on Linux. Exposes events, time spans, sectors and phases as SystemTap SDT probes (provider
+     *   `bactria`). The probes cost next to nothing until an external tool such as `perf`, `bpftrace` or SystemTap
+     *   attaches to the running process.
      *
      * \subsection about_differences Differences to similar projects
      * TODO: Fill this out!
@@ -113,6 +125,8 @@ namespace bactria
      * * `bactria_BUILD_DOCUMENTATION` -- Build the Doxygen documentation. Default: `ON`.
      * * `bactria_BUILD_EXAMPLES` -- Build the examples (see the `examples` folder). Default: `ON`.
      * * `bactria_CUDA_PLUGINS` -- Build the CUDA ecosystem plugins. Default: `OFF`
+     * * `bactria_CONTROL_TOOL` -- Build the `bactria-ctl` runtime control tool. Default: `ON` on Unix platforms.
+     * * `bactria_FTRACE_PLUGINS` -- Build the Linux ftrace plugins. Default: `ON` on Unix platforms.
      * * `bactria_JSON_PLUGINS` -- Build the JSON-based plugins. Default: `ON`
      *      * `bactria_SYSTEM_JSON` -- Use your local installation of the nlohnmann-json library. If set to `OFF`,
      *        bactria will attempt to download the library to its build directory. Default: `ON`.
@@ -123,6 +137,8 @@ namespace bactria
               If set to `OFF`, bactria will attempt to download the library to its build directory. Default: `ON`.
      * * `bactria_SYSTEM_TOML11` -- Use your local installation of toml11. If set to `OFF`, bactria will attempt to
      *   download the library to its build directory. Default: `ON`.
+     * * `bactria_USDT_PLUGINS` -- Build the USDT plugins. Requires `sys/sdt.h` (usually part of the
+     *   `systemtap-sdt-dev` or `systemtap-sdt-devel` package). Default: `OFF`.
      *
      * The following example configures the build system for building the Doxygen documentation, the examples and the
      * plugins for CUDA, JSON, Score-P and `stdout` in `Release` mode:
@@ -216,6 +232,46 @@ namespace bactria
      * before. These are the files you can now load into your favourite analysis / profiling tools for further
      * examination.
      *
+     * Markers can be filtered independently of the plugin in use. The following environment variables take
+     * comma-separated lists of glob patterns (`*` matches any sequence of characters, `?` a single character):
+     *
+     * * `BACTRIA_FILTER_NAMES_INCLUDE` / `BACTRIA_FILTER_NAMES_EXCLUDE` -- filter sectors, phases, ranges,
+     *   counters, timelines, flows and events by name.
+     * * `BACTRIA_FILTER_CATEGORIES_INCLUDE` / `BACTRIA_FILTER_CATEGORIES_EXCLUDE` -- filter ranges, counters,
+     *   timelines, flows and events by the name of their category.
+     *
+     * A marker is recorded if its name (and category) matches at least one include pattern, or there are no include
+     * patterns, and matches none of the exclude patterns. The filters are evaluated once when a marker is
+     * constructed; filtered markers don't get a plugin handle and cost a single branch afterwards.
+     *
+     * Recording can also be switched on and off while the program is running. If `BACTRIA_CONTROL` is set to `on`
+     * (or `off` to start with recording switched off) bactria creates the shared-memory control block
+     * `/bactria_control_<pid>` and `bactria-ctl` flips its switches:
+     *
+     * ```
+     * bactria-ctl <pid>                          # show the switches
+     * bactria-ctl <pid> on                       # switch recording on (or off)
+     * bactria-ctl <pid> category 'io*' off       # switch categories on or off
+     * bactria-ctl <pid> site 'LOOP*' off         # switch sites (a name in a category) on or off
+     * ```
+     *
+     * A marker records if the global switch, its category's switch and its site's switch are on. Sectors and phases
+     * belong to the category `bactria.metrics`. Every marker checks its site's flag with a single relaxed atomic
+     * load; entered sectors and phases and started ranges are always left and stopped.
+     *
+     * To trace only a part of a long run, `BACTRIA_CAPTURE` takes a comma-separated list of capture windows.
+     * Outside of them every marker is switched off just like with `bactria-ctl`, so the trace size and overhead are
+     * proportional to the windows:
+     *
+     * * `time:<first>-<last>` -- from `first` to `last` seconds after the first `Context` was created.
+     * * `phase:<name>:<first>-<last>` / `sector:<name>:<first>-<last>` -- from the `first` to the `last` entry of the
+     *   phases or sectors with the given name (counted from 1 over all threads).
+     * * `step:<first>-<last>` -- while the step reported by bactria::set_capture_step() lies in the window.
+     *
+     * Omitting `last` keeps the window open until the end of the run. For example,
+     * `BACTRIA_CAPTURE="phase:STEP:1000-1100"` records the steps 1000 to 1100 only and
+     * `BACTRIA_CAPTURE="time:60-120"` one minute after the warm-up.
+     *
      * In the next sections we will explain the concepts behind `metrics`, `ranges` and `reports`.
      *
      * \subsection usage_init Initialization
@@ -239,14 +295,45 @@ namespace bactria
      *
      * * `Event`s are single points in time and are simply triggered / `fire`d in the application code.
      * * `Range`s are time spans and are `start`ed and `stop`ped.
+     * * `AsyncRange`s are time spans which may be `start`ed and `stop`ped on different threads. They carry a
+     * correlation ID and can be moved to the thread which completes the work.
+     * * `ScopedRange`s (or the #bactria_Range macro) are lightweight time spans for strictly nested, single-threaded
+     * code. They are pushed onto a per-thread range stack on construction and popped on destruction without creating
+     * a plugin-side handle.
+     * * `Counter`s track a numeric quantity (such as the memory in use or the number of items in a queue) over
+     * time. Trace plugins render them as counter tracks next to the ranges. Identical consecutive values are
+     * coalesced and a minimum sampling interval can be set per counter or globally through the
+     * `BACTRIA_COUNTER_INTERVAL` environment variable (in microseconds).
+     * * `Timeline`s collect retroactive ranges which have been measured elsewhere (device timestamps, simulation
+     * logs, timings collected in a hot loop). Spans are recorded as `{name ID, start, end, track}` records,
+     * converted from their `ClockDomain` into bactria's time base and submitted to the plugin in bulk.
+     * * `Flow`s link a point on a producer thread (`begin`) to a point on a consumer thread (`end`) through a 64 bit
+     * flow ID. Trace plugins draw an arrow between the two points, the latency plugin reports the distribution of the
+     * time in between.
      * * Both `Event`s and `Range`s can be assigned to a `Category`. Through the configuration file you can filter out
      * all `Event`s and `Range`s part of a specific `Category`.
+     * * High-frequency `Event`s and `Range`s can be sampled before they reach the plugin: every Nth occurrence
+     * (`Sampler::every`), at most one per time interval (`Sampler::at_most_every`) or with a fixed probability
+     * (`Sampler::with_probability`). The default `Sampler` of a marker comes from the `BACTRIA_RANGES_SAMPLING`
+     * environment variable, e.g. `every:100,io*=interval:1000,debug=probability:0.01`: a policy without prefix
+     * applies to all categories, `<glob>=` restricts it to the matching categories. The `bactria_Event` macros keep
+     * one `Sampler` per call site and thread. An unsampled occurrence costs a counter increment (or a clock read, or
+     * a random number).
      *
      * `Event`s and `Range`s can freely overlap / be nested in any way you feel necessary. This is how it looks like
      * in code:
      *
      * \include foo.cpp
      *
+     * `Event`s and `Range`s can carry a numeric Payload (a signed or unsigned 64 bit integer or a `double`), for
+     * example a residual norm or the number of processed bytes. Plugins that support payloads show the value next to
+     * the marker. See Event::fire, Range::start and #bactria_ValueEvent.
+     *
+     * If a time span begins on one thread and ends on another (for example, a task submitted to a thread pool), use
+     * an `AsyncRange`:
+     *
+     * \include submit.cpp
+     *
      * As you may have noticed we have supplied a color to the range / event constructor. Some plugins support custom
      * colors to enhance the visualizer output (this depends on vendor APIs and is therefore not supported by all
      * available plugins). You can either use one of bactria's numerous pre-defined colors (see Colors.hpp) or supply
@@ -0,0 +1,386 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+/**
+ * \file Capture.hpp
+ * \brief Capture window file.
+ *
+ * This file contains the capture windows which restrict recording to a part of the run. It should not be included
+ * directly by the user.
+ */
+
+#pragma once
+
+#include <bactria/core/Control.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace bactria
+{
+    namespace capture
+    {
+        /**
+         * \addtogroup bactria_core_internal
+         * \{
+         */
+
+        /**
+         * \brief The kinds of capture windows.
+         */
+        enum class window_type
+        {
+            time, /**< Seconds since the first Context was created. */
+            phase, /**< Entries of the Phases with a given name. */
+            sector, /**< Entries of the Sectors with a given name. */
+            step /**< Steps passed to bactria::set_capture_step(). */
+        };
+
+        /**
+         * \brief A capture window.
+         *
+         * The bounds are inclusive. An open-ended window has the upper bound infinity.
+         */
+        struct window
+        {
+            window(window_type t, std::string n, double f, double l) : type{t}, name{std::move(n)}, first{f}, last{l}
+            {
+            }
+
+            window_type type;
+            std::string name;
+            double first;
+            double last;
+            std::atomic<bool> open{false};
+        };
+
+        class scheduler;
+
+        /**
+         * \brief Counts the entries of the Phases or Sectors with a given name.
+         *
+         * The count is shared by all threads. Entering the first entry of a window opens it, leaving while the last
+         * entry of the window is the most recent one closes it.
+         */
+        class trigger final
+        {
+        public:
+            trigger(scheduler& s, window_type type, std::string name)
+                : m_scheduler{s}
+                , m_type{type}
+                , m_name{std::move(name)}
+            {
+            }
+
+            //! Called before the Phase or Sector is entered.
+            auto enter() noexcept -> void;
+
+            //! Called after the Phase or Sector has been left.
+            auto leave() noexcept -> void;
+
+        private:
+            friend class scheduler;
+
+            scheduler& m_scheduler;
+            window_type m_type;
+            std::string m_name;
+            std::vector<window*> m_windows{};
+            std::atomic<std::uint64_t> m_entries{0u};
+        };
+
+        /**
+         * \brief Opens and closes the capture windows.
+         *
+         * Reads the environment variable `BACTRIA_CAPTURE` once. It holds a comma-separated list of windows:
+         *
+         * * `time:<first>-<last>` -- from \a first to \a last seconds after the first Context was created.
+         * * `phase:<name>:<first>-<last>` -- from the \a first to the \a last entry of the Phases named \a name.
+         * * `sector:<name>:<first>-<last>` -- the same for Sectors.
+         * * `step:<first>-<last>` -- from step \a first to step \a last, see bactria::set_capture_step().
+         *
+         * Entries are counted from 1. Omitting \a last leaves the window open until the end of the run; `<first>`
+         * alone is a window of a single entry or step. Recording is switched off while no window is open. Without
+         * windows recording is never switched off. Malformed windows are ignored with a warning.
+         */
+        class scheduler final
+        {
+        public:
+            scheduler()
+            {
+                auto const env = std::getenv("BACTRIA_CAPTURE");
+                if(env == nullptr)
+                    return;
+
+                auto const list = std::string{env};
+                auto begin = std::string::size_type{0u};
+                while(begin <= list.size())
+                {
+                    auto end = list.find(',', begin);
+                    if(end == std::string::npos)
+                        end = list.size();
+
+                    auto const entry = list.substr(begin, end - begin);
+                    if(!entry.empty() && !parse(entry))
+                        std::fprintf(stderr, "WARNING: Ignoring malformed capture window \"%s\".\n", entry.c_str());
+
+                    begin = end + 1u;
+                }
+
+                if(m_windows.empty())
+                    return;
+
+                control::set_capture(false);
+                for(auto& w : m_windows)
+                {
+                    if(w.type == window_type::time)
+                    {
+                        m_events.emplace_back(w.first, true, &w);
+                        if(w.last != std::numeric_limits<double>::infinity())
+                            m_events.emplace_back(w.last, false, &w);
+                    }
+                    else if(w.type == window_type::step)
+                        m_steps.push_back(&w);
+                }
+
+                if(!m_events.empty())
+                {
+                    // Windows which close and open at the same time are closed first
+                    std::sort(m_events.begin(), m_events.end());
+                    m_timer = std::thread{[this]() { run(); }};
+                }
+            }
+
+            scheduler(scheduler const&) = delete;
+            auto operator=(scheduler const&) -> scheduler& = delete;
+
+            ~scheduler()
+            {
+                if(m_timer.joinable())
+                {
+                    {
+                        std::lock_guard<std::mutex> const lock{m_timer_mutex};
+                        m_stop = true;
+                    }
+                    m_cv.notify_one();
+                    m_timer.join();
+                }
+            }
+
+            /**
+             * \brief Returns the trigger of a Phase or Sector name or nullptr if no window refers to it.
+             *
+             * Called once when a Phase or Sector is constructed.
+             */
+            auto trigger_for(window_type type, std::string const& name) noexcept -> trigger*
+            {
+                for(auto& t : m_triggers)
+                {
+                    if(t.m_type == type && t.m_name == name)
+                        return &t;
+                }
+
+                return nullptr;
+            }
+
+            /**
+             * \brief Opens and closes the step windows.
+             */
+            auto set_step(std::uint64_t step) noexcept -> void
+            {
+                auto const s = static_cast<double>(step);
+                for(auto w : m_steps)
+                    set_open(*w, s >= w->first && s <= w->last);
+            }
+
+            /**
+             * \brief Opens or closes a window.
+             *
+             * Recording is switched on while at least one window is open.
+             */
+            auto set_open(window& w, bool open) noexcept -> void
+            {
+                if(w.open.exchange(open) == open)
+                    return;
+
+                std::lock_guard<std::mutex> const lock{m_mutex};
+                m_open = open ? m_open + 1u : m_open - 1u;
+                control::set_capture(m_open != 0u);
+            }
+
+        private:
+            // Parses [<first>][-[<last>]]
+            static auto parse_bounds(std::string const& str, double& first, double& last) -> bool
+            {
+                auto end = static_cast<char*>(nullptr);
+                first = std::strtod(str.c_str(), &end);
+                if(end == str.c_str() || first < 0.0)
+                    return false;
+
+                if(*end == '\0')
+                {
+                    last = first;
+                    return true;
+                }
+                if(*end != '-')
+                    return false;
+
+                auto const upper = end + 1;
+                if(*upper == '\0')
+                {
+                    last = std::numeric_limits<double>::infinity();
+                    return true;
+                }
+
+                last = std::strtod(upper, &end);
+                return end != upper && *end == '\0' && last >= first;
+            }
+
+            auto parse(std::string const& entry) -> bool
+            {
+                auto const colon = entry.find(':');
+                if(colon == std::string::npos)
+                    return false;
+
+                auto const kind = entry.substr(0u, colon);
+                auto first = 0.0;
+                auto last = 0.0;
+                if(kind == "time" || kind == "step")
+                {
+                    if(!parse_bounds(entry.substr(colon + 1u), first, last))
+                        return false;
+
+                    auto const type = (kind == "time") ? window_type::time : window_type::step;
+                    m_windows.emplace_back(type, std::string{}, first, last);
+                    return true;
+                }
+
+                if(kind != "phase" && kind != "sector")
+                    return false;
+
+                // Names may contain colons, the bounds may not
+                auto const bounds = entry.rfind(':');
+                if(bounds == colon || !parse_bounds(entry.substr(bounds + 1u), first, last) || first < 1.0)
+                    return false;
+
+                auto const type = (kind == "phase") ? window_type::phase : window_type::sector;
+                auto const name = entry.substr(colon + 1u, bounds - colon - 1u);
+                m_windows.emplace_back(type, name, first, last);
+
+                auto t = trigger_for(type, name);
+                if(t == nullptr)
+                {
+                    m_triggers.emplace_back(*this, type, name);
+                    t = &m_triggers.back();
+                }
+                t->m_windows.push_back(&m_windows.back());
+
+                return true;
+            }
+
+            auto run() -> void
+            {
+                auto const stopped = [this]() { return m_stop; };
+                auto lock = std::unique_lock<std::mutex>{m_timer_mutex};
+                for(auto const& e : m_events)
+                {
+                    auto const at = m_start
+                                    + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                        std::chrono::duration<double>{std::get<0>(e)});
+                    if(m_cv.wait_until(lock, at, stopped))
+                        return;
+
+                    set_open(*std::get<2>(e), std::get<1>(e));
+                }
+            }
+
+            std::chrono::steady_clock::time_point const m_start{std::chrono::steady_clock::now()};
+            // Deques keep the addresses of their elements stable
+            std::deque<window> m_windows{};
+            std::deque<trigger> m_triggers{};
+            std::vector<window*> m_steps{};
+            // (seconds, open, window) for the time windows
+            std::vector<std::tuple<double, bool, window*>> m_events{};
+            std::mutex m_mutex{};
+            std::uint32_t m_open{0u};
+            std::mutex m_timer_mutex{};
+            std::condition_variable m_cv{};
+            bool m_stop{false};
+            std::thread m_timer{};
+        };
+
+        inline auto trigger::enter() noexcept -> void
+        {
+            auto const n = static_cast<double>(m_entries.fetch_add(1u, std::memory_order_relaxed) + 1u);
+            for(auto w : m_windows)
+            {
+                if(n == w->first)
+                    m_scheduler.set_open(*w, true);
+            }
+        }
+
+        inline auto trigger::leave() noexcept -> void
+        {
+            auto const n = static_cast<double>(m_entries.load(std::memory_order_relaxed));
+            for(auto w : m_windows)
+            {
+                if(n == w->last)
+                    m_scheduler.set_open(*w, false);
+            }
+        }
+
+        /**
+         * \brief Returns the process's scheduler.
+         *
+         * The scheduler is created by the first Context, or by the first Phase or Sector if they are created earlier.
+         */
+        inline auto get_scheduler() -> scheduler&
+        {
+            static scheduler s;
+            return s;
+        }
+
+        /**
+         * \}
+         */
+    } // namespace capture
+
+    /**
+     * \brief Report the current step to the capture windows.
+     * \ingroup bactria_core_user
+     *
+     * Opens the `step:<first>-<last>` windows of `BACTRIA_CAPTURE` which contain \a step and closes the others. Call
+     * it once per iteration of the main loop, e.g. with the time step of a simulation. If there are no step windows
+     * this function returns immediately.
+     *
+     * \param step The current step.
+     */
+    inline auto set_capture_step(std::uint64_t step) noexcept -> void
+    {
+        capture::get_scheduler().set_step(step);
+    }
+} // namespace bactria
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <bactria/core/Activation.hpp>
+#include <bactria/core/Capture.hpp>
 #include <bactria/core/Plugin.hpp>
 #include <bactria/metrics/Plugin.hpp>
 #include <bactria/ranges/Plugin.hpp>
@@ -57,11 +58,15 @@ namespace bactria
          *
          * Loads the plugins and maintains the plugins' internal states. It is allowed to have multiple Context objects
          * because the plugins are reference counted. They will only be unloaded once the last Context in a process
-         * reaches the end of its lifetime.
+         * reaches the end of its lifetime. The first Context also starts the clock of the time-based capture windows
+         * (see `BACTRIA_CAPTURE`).
          *
          * \sa ~Context
          */
-        Context() = default;
+        Context()
+        {
+            capture::get_scheduler();
+        }
 
         /**
          * \brief The copy constructor.
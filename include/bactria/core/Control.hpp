@@ -0,0 +1,427 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+/**
+ * \file Control.hpp
+ * \brief Runtime control file.
+ *
+ * This file contains the shared-memory control block which lets `bactria-ctl` switch recording on and off in a
+ * running process. It should not be included directly by the user.
+ */
+
+#pragma once
+
+#include <bactria/core/SiteCache.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+
+#ifndef _WIN32
+#    include <fcntl.h>
+#    include <pthread.h>
+#    include <sys/mman.h>
+#    include <unistd.h>
+
+#    include <cerrno>
+#endif
+
+namespace bactria
+{
+    namespace control
+    {
+        /**
+         * \addtogroup bactria_core_internal
+         * \{
+         */
+
+        /**
+         * \brief The enable flag of a site.
+         *
+         * Non-zero if the site may record. Markers keep a pointer to their site's flag and check it with a single
+         * relaxed load before every operation.
+         */
+        using site_flag = std::atomic<std::uint32_t>;
+
+        /**
+         * \brief Checks a site's enable flag.
+         */
+        inline auto is_enabled(site_flag const& flag) noexcept -> bool
+        {
+            return flag.load(std::memory_order_relaxed) != 0u;
+        }
+
+        /**
+         * \brief The category of the sites of Sectors and Phases.
+         */
+        constexpr auto metrics_category = "bactria.metrics";
+
+        /**
+         * \brief The flag of every site if there is no control block.
+         *
+         * Set unless a capture window is configured and none is open, see set_capture().
+         */
+        inline auto default_flag() noexcept -> site_flag&
+        {
+            static site_flag flag{1u};
+            return flag;
+        }
+
+#ifndef _WIN32
+        //! "bactria" followed by the layout version. bactria-ctl refuses blocks with a different value.
+        constexpr auto magic = std::uint64_t{0x6261637472696103u};
+        constexpr auto name_size = std::size_t{64u};
+        constexpr auto category_capacity = std::uint32_t{256u};
+        constexpr auto site_capacity = std::uint32_t{4096u};
+
+        /**
+         * \brief A category in the control block.
+         */
+        struct category_entry
+        {
+            site_flag enabled;
+            char name[name_size];
+        };
+
+        /**
+         * \brief A site in the control block.
+         *
+         * A site is a marker name in a category. All markers with the same name and category share one site.
+         */
+        struct site_entry
+        {
+            //! The flag read by the markers: the global, category and site bits combined.
+            site_flag effective;
+            //! The site bit.
+            site_flag enabled;
+            std::uint32_t category;
+            char name[name_size];
+        };
+
+        /**
+         * \brief The shared-memory control block `/bactria_control_<pid>`.
+         *
+         * Created by the process if `BACTRIA_CONTROL` is set and modified by `bactria-ctl`. Both sides hold the
+         * process-shared robust mutex while they add sites or change bits; the markers only read the effective
+         * flags. Names are written before the corresponding count is raised with release semantics.
+         */
+        struct block
+        {
+            std::uint64_t magic;
+            pthread_mutex_t mutex;
+            site_flag global;
+            //! Cleared by the process outside of its capture windows, see Capture.hpp.
+            site_flag capture;
+            //! The flag of the sites which didn't fit into the block: the global and capture bits combined.
+            site_flag fallback;
+            std::atomic<std::uint32_t> categories;
+            std::atomic<std::uint32_t> sites;
+            //! The number of sites which didn't fit into the block.
+            std::atomic<std::uint32_t> overflow;
+            category_entry category[category_capacity];
+            site_entry site[site_capacity];
+        };
+
+        /**
+         * \brief Returns the name of the control block of a process.
+         */
+        inline auto block_name(long pid) -> std::string
+        {
+            return "/bactria_control_" + std::to_string(pid);
+        }
+
+        /**
+         * \brief Locks the mutex of a control block.
+         *
+         * If the previous owner died while holding the mutex the block is still consistent (all bits are written
+         * atomically), so the mutex is marked consistent and locked.
+         */
+        class block_lock final
+        {
+        public:
+            explicit block_lock(block& b) noexcept : m_mutex{&b.mutex}
+            {
+                if(pthread_mutex_lock(m_mutex) == EOWNERDEAD)
+                    pthread_mutex_consistent(m_mutex);
+            }
+
+            block_lock(block_lock const&) = delete;
+            auto operator=(block_lock const&) -> block_lock& = delete;
+
+            ~block_lock()
+            {
+                pthread_mutex_unlock(m_mutex);
+            }
+
+        private:
+            pthread_mutex_t* m_mutex;
+        };
+
+        /**
+         * \brief Recomputes the effective flag of a site. The caller must hold the block's mutex.
+         */
+        inline auto refresh(block& b, site_entry& s) noexcept -> void
+        {
+            auto const on
+                = is_enabled(b.fallback) && is_enabled(b.category[s.category].enabled) && is_enabled(s.enabled);
+            s.effective.store(on ? 1u : 0u, std::memory_order_relaxed);
+        }
+
+        /**
+         * \brief Recomputes the effective flags of all sites. The caller must hold the block's mutex.
+         */
+        inline auto refresh(block& b) noexcept -> void
+        {
+            auto const on = is_enabled(b.global) && is_enabled(b.capture);
+            b.fallback.store(on ? 1u : 0u, std::memory_order_relaxed);
+
+            auto const sites = b.sites.load(std::memory_order_acquire);
+            for(auto i = std::uint32_t{0u}; i < sites; ++i)
+                refresh(b, b.site[i]);
+        }
+
+        /**
+         * \brief The process side of the control block.
+         *
+         * Reads `BACTRIA_CONTROL` once. If it is `on` or `off` the control block is created with recording switched
+         * on or off, otherwise every site uses default_flag(). The block is removed when the process exits.
+         */
+        class controller final
+        {
+        public:
+            controller()
+            {
+                auto const env = std::getenv("BACTRIA_CONTROL");
+                if(env == nullptr || (std::strcmp(env, "on") != 0 && std::strcmp(env, "off") != 0))
+                    return;
+
+                m_name = block_name(static_cast<long>(getpid()));
+                auto const fd = shm_open(m_name.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0600);
+                if(fd == -1)
+                {
+                    warn();
+                    return;
+                }
+
+                auto const mapping = (ftruncate(fd, static_cast<off_t>(sizeof(block))) == 0)
+                                         ? mmap(nullptr, sizeof(block), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                                         : MAP_FAILED;
+                close(fd);
+                if(mapping == MAP_FAILED)
+                {
+                    warn();
+                    shm_unlink(m_name.c_str());
+                    return;
+                }
+
+                // The pages are zero-filled, which is a valid state for all atomics and names
+                auto const b = new(mapping) block;
+
+                auto attr = pthread_mutexattr_t{};
+                pthread_mutexattr_init(&attr);
+                pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+                pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+                pthread_mutex_init(&b->mutex, &attr);
+                pthread_mutexattr_destroy(&attr);
+
+                b->global.store(std::strcmp(env, "on") == 0 ? 1u : 0u, std::memory_order_relaxed);
+                b->capture.store(default_flag().load(std::memory_order_relaxed), std::memory_order_relaxed);
+                refresh(*b);
+                std::atomic_thread_fence(std::memory_order_release);
+                b->magic = magic;
+                m_block = b;
+            }
+
+            controller(controller const&) = delete;
+            auto operator=(controller const&) -> controller& = delete;
+
+            // Markers may still be used while the process exits, so the mapping is left to the operating system
+            ~controller()
+            {
+                if(m_block != nullptr)
+                    shm_unlink(m_name.c_str());
+            }
+
+            /**
+             * \brief Returns the flag of a site, adding the site to the block if necessary.
+             *
+             * Every thread remembers the sites it has looked up before, so repeated lookups of a site neither lock nor
+             * allocate.
+             *
+             * \param name The marker's name.
+             * \param cat_name The name of the marker's category.
+             */
+            auto site(char const* name, char const* cat_name) -> site_flag const&
+            {
+                if(m_block == nullptr)
+                    return default_flag();
+
+                thread_local auto cache = site_cache<site_flag const*>{};
+                auto cached = static_cast<site_flag const*>(nullptr);
+                if(cache.find(name, cat_name, cached))
+                    return *cached;
+
+                auto key = std::string{cat_name};
+                key += '\0';
+                key += name;
+
+                std::lock_guard<std::mutex> const lock{m_mutex};
+                auto it = m_sites.find(key);
+                if(it == m_sites.end())
+                    it = m_sites.emplace(std::move(key), &add(name, cat_name)).first;
+
+                cache.insert(name, cat_name, it->second);
+                return *it->second;
+            }
+
+            /**
+             * \brief Opens or closes the capture window of all sites.
+             */
+            auto set_capture(bool on) noexcept -> void
+            {
+                if(m_block == nullptr)
+                {
+                    default_flag().store(on ? 1u : 0u, std::memory_order_relaxed);
+                    return;
+                }
+
+                block_lock const lock{*m_block};
+                m_block->capture.store(on ? 1u : 0u, std::memory_order_relaxed);
+                refresh(*m_block);
+            }
+
+        private:
+            auto add(char const* name, char const* cat_name) -> site_flag const&
+            {
+                auto& b = *m_block;
+                block_lock const lock{b};
+
+                auto const category = find_category(cat_name);
+                auto const sites = b.sites.load(std::memory_order_relaxed);
+                if(category == category_capacity || sites == site_capacity)
+                {
+                    b.overflow.fetch_add(1u, std::memory_order_relaxed);
+                    return b.fallback;
+                }
+
+                auto& s = b.site[sites];
+                copy(s.name, name);
+                s.category = category;
+                s.enabled.store(1u, std::memory_order_relaxed);
+                refresh(b, s);
+                b.sites.store(sites + 1u, std::memory_order_release);
+
+                return s.effective;
+            }
+
+            // Returns category_capacity if the category is new and the block is full
+            auto find_category(char const* cat_name) noexcept -> std::uint32_t
+            {
+                auto& b = *m_block;
+                auto const categories = b.categories.load(std::memory_order_relaxed);
+                for(auto i = std::uint32_t{0u}; i < categories; ++i)
+                {
+                    if(std::strncmp(b.category[i].name, cat_name, name_size - 1u) == 0)
+                        return i;
+                }
+
+                if(categories == category_capacity)
+                    return category_capacity;
+
+                auto& c = b.category[categories];
+                copy(c.name, cat_name);
+                c.enabled.store(1u, std::memory_order_relaxed);
+                b.categories.store(categories + 1u, std::memory_order_release);
+
+                return categories;
+            }
+
+            // Longer names are truncated; sites whose names only differ after the cut share their bits in bactria-ctl
+            static auto copy(char (&dst)[name_size], char const* src) noexcept -> void
+            {
+                std::strncpy(dst, src, name_size - 1u);
+                dst[name_size - 1u] = '\0';
+            }
+
+            auto warn() const -> void
+            {
+                std::fprintf(
+                    stderr,
+                    "WARNING: bactria failed to create the control block %s: %s. Runtime control is disabled.\n",
+                    m_name.c_str(),
+                    std::strerror(errno));
+            }
+
+            std::string m_name{};
+            block* m_block{nullptr};
+            std::mutex m_mutex{};
+            std::unordered_map<std::string, site_flag const*> m_sites{};
+        };
+
+        /**
+         * \brief Returns the process's controller.
+         */
+        inline auto get_controller() -> controller&
+        {
+            static controller c;
+            return c;
+        }
+
+        /**
+         * \brief Returns the flag of a site.
+         *
+         * Called once when a marker is constructed. If runtime control is disabled (the default) every site shares
+         * default_flag().
+         *
+         * \param name The marker's name.
+         * \param cat_name The name of the marker's category.
+         */
+        inline auto site(char const* name, char const* cat_name) -> site_flag const&
+        {
+            return get_controller().site(name, cat_name);
+        }
+
+        /**
+         * \brief Opens or closes the capture window.
+         *
+         * Outside of the capture window no site records, regardless of the switches set by `bactria-ctl`.
+         */
+        inline auto set_capture(bool on) noexcept -> void
+        {
+            get_controller().set_capture(on);
+        }
+#else
+        inline auto site(char const* /* name */, char const* /* cat_name */) -> site_flag const&
+        {
+            return default_flag();
+        }
+
+        inline auto set_capture(bool on) noexcept -> void
+        {
+            default_flag().store(on ? 1u : 0u, std::memory_order_relaxed);
+        }
+#endif
+
+        /**
+         * \}
+         */
+    } // namespace control
+} // namespace bactria
@@ -0,0 +1,216 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+/**
+ * \file Filter.hpp
+ * \brief Marker filtering file.
+ *
+ * This file contains the backend-independent name and category filters. It should not be included directly by the
+ * user.
+ */
+
+#pragma once
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace bactria
+{
+    /**
+     * \addtogroup bactria_core_internal
+     * \{
+     */
+
+    /**
+     * \brief Matches a string against a glob pattern.
+     *
+     * `*` matches any sequence of characters (including the empty one) and `?` matches exactly one character. All
+     * other characters match themselves.
+     *
+     * \param pattern The glob pattern.
+     * \param str The string to match.
+     * \return true If \a str matches \a pattern.
+     */
+    inline auto glob_match(char const* pattern, char const* str) noexcept -> bool
+    {
+        // Iterative matching with a single backtracking point: the most recent '*' absorbs one more character
+        // whenever the remaining pattern fails to match
+        auto star = static_cast<char const*>(nullptr);
+        auto resume = static_cast<char const*>(nullptr);
+
+        while(*str != '\0')
+        {
+            if(*pattern == '*')
+            {
+                star = pattern++;
+                resume = str;
+            }
+            else if(*pattern == '?' || *pattern == *str)
+            {
+                ++pattern;
+                ++str;
+            }
+            else if(star != nullptr)
+            {
+                pattern = star + 1;
+                str = ++resume;
+            }
+            else
+                return false;
+        }
+
+        while(*pattern == '*')
+            ++pattern;
+
+        return *pattern == '\0';
+    }
+
+    /**
+     * \brief An include / exclude list of glob patterns.
+     *
+     * A string passes the filter if it matches at least one include pattern (or if there are no include patterns)
+     * and none of the exclude patterns.
+     */
+    class glob_filter final
+    {
+    public:
+        /**
+         * \brief Reads the patterns from two environment variables.
+         *
+         * Both variables hold comma-separated lists of glob patterns. Unset or empty variables yield empty lists.
+         *
+         * \param include_var The name of the environment variable holding the include patterns.
+         * \param exclude_var The name of the environment variable holding the exclude patterns.
+         */
+        glob_filter(char const* include_var, char const* exclude_var)
+            : m_include{split(std::getenv(include_var))}
+            , m_exclude{split(std::getenv(exclude_var))}
+        {
+        }
+
+        /**
+         * \brief Query status.
+         *
+         * \return true If there are neither include nor exclude patterns, i.e. every string passes.
+         */
+        auto empty() const noexcept -> bool
+        {
+            return m_include.empty() && m_exclude.empty();
+        }
+
+        /**
+         * \brief Checks a string against the patterns.
+         *
+         * \param str The string to check.
+         * \return true If \a str passes the filter.
+         */
+        auto accepts(char const* str) const noexcept -> bool
+        {
+            auto const matches = [str](std::vector<std::string> const& patterns)
+            {
+                for(auto const& p : patterns)
+                {
+                    if(glob_match(p.c_str(), str))
+                        return true;
+                }
+                return false;
+            };
+
+            return (m_include.empty() || matches(m_include)) && !matches(m_exclude);
+        }
+
+    private:
+        static auto split(char const* list) -> std::vector<std::string>
+        {
+            auto patterns = std::vector<std::string>{};
+            if(list == nullptr)
+                return patterns;
+
+            // Whitespace around the commas is dropped, whitespace inside a pattern belongs to it
+            auto const str = std::string{list};
+            auto begin = std::string::size_type{0u};
+            while(begin <= str.size())
+            {
+                auto end = str.find(',', begin);
+                if(end == std::string::npos)
+                    end = str.size();
+
+                auto const first = str.find_first_not_of(" \t", begin);
+                if(first != std::string::npos && first < end)
+                {
+                    auto const last = str.find_last_not_of(" \t", end - 1u);
+                    patterns.emplace_back(str.substr(first, last - first + 1u));
+                }
+
+                begin = end + 1u;
+            }
+
+            return patterns;
+        }
+
+        std::vector<std::string> m_include;
+        std::vector<std::string> m_exclude;
+    };
+
+    /**
+     * \brief Returns the filter for marker names.
+     *
+     * Read once from the environment variables `BACTRIA_FILTER_NAMES_INCLUDE` and `BACTRIA_FILTER_NAMES_EXCLUDE`.
+     */
+    inline auto name_filter() -> glob_filter const&
+    {
+        static auto const filter = glob_filter{"BACTRIA_FILTER_NAMES_INCLUDE", "BACTRIA_FILTER_NAMES_EXCLUDE"};
+        return filter;
+    }
+
+    /**
+     * \brief Returns the filter for category names.
+     *
+     * Read once from the environment variables `BACTRIA_FILTER_CATEGORIES_INCLUDE` and
+     * `BACTRIA_FILTER_CATEGORIES_EXCLUDE`.
+     */
+    inline auto category_filter() -> glob_filter const&
+    {
+        static auto const filter
+            = glob_filter{"BACTRIA_FILTER_CATEGORIES_INCLUDE", "BACTRIA_FILTER_CATEGORIES_EXCLUDE"};
+        return filter;
+    }
+
+    /**
+     * \brief Checks whether a marker has been filtered out by the user.
+     *
+     * Called once when a plugin handle is created. Filtered markers don't get a handle; every later operation on
+     * them is reduced to a null check. If no filter is configured this function returns immediately.
+     *
+     * \param name The marker's name.
+     * \param cat_name The name of the marker's category. Markers without a category (sectors and phases) pass
+     *                 \a nullptr and are only subject to the name filter.
+     * \return true If the marker must not be recorded.
+     */
+    inline auto is_filtered(char const* name, char const* cat_name = nullptr) noexcept -> bool
+    {
+        static auto const enabled = !name_filter().empty() || !category_filter().empty();
+        if(!enabled)
+            return false;
+
+        return (name != nullptr && !name_filter().accepts(name))
+               || (cat_name != nullptr && !category_filter().accepts(cat_name));
+    }
+
+    /**
+     * \}
+     */
+} // namespace bactria
@@ -0,0 +1,120 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+/**
+ * \file SiteCache.hpp
+ * \brief Site cache file.
+ *
+ * This file contains a per-thread cache for values that are looked up by marker and category name. It should not be
+ * included directly by the user.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace bactria
+{
+    /**
+     * \addtogroup bactria_core_internal
+     * \{
+     */
+
+    /**
+     * \brief A cache of values per site.
+     *
+     * A site is a marker name in a category. The process-wide registries of per-site state (runtime control flags,
+     * shared Samplers) need a lock and a key string for every lookup. Markers which are constructed anew on every
+     * occurrence look up the same sites over and over, so each thread keeps the values it has already looked up in a
+     * `thread_local` site_cache. A cache hit hashes the names but neither allocates nor locks.
+     *
+     * \tparam TValue The cached value. Usually a pointer into a registry.
+     */
+    template<typename TValue>
+    class site_cache final
+    {
+    public:
+        /**
+         * \brief Looks up a site.
+         *
+         * \param name The marker's name.
+         * \param cat_name The name of the marker's category.
+         * \param value Receives the cached value if there is one.
+         * \return true If the site is in the cache.
+         */
+        auto find(char const* name, char const* cat_name, TValue& value) const noexcept -> bool
+        {
+            auto const range = m_entries.equal_range(hash(name, cat_name));
+            for(auto it = range.first; it != range.second; ++it)
+            {
+                if(it->second.name == name && it->second.cat_name == cat_name)
+                {
+                    value = it->second.value;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /**
+         * \brief Adds a site which is not in the cache yet.
+         *
+         * \param name The marker's name.
+         * \param cat_name The name of the marker's category.
+         * \param value The value to cache.
+         */
+        auto insert(char const* name, char const* cat_name, TValue value) -> void
+        {
+            m_entries.emplace(hash(name, cat_name), entry{name, cat_name, std::move(value)});
+        }
+
+    private:
+        struct entry
+        {
+            std::string name;
+            std::string cat_name;
+            TValue value;
+        };
+
+        // FNV-1a over the category name, a separator and the marker name
+        static auto hash(char const* name, char const* cat_name) noexcept -> std::size_t
+        {
+            auto h = static_cast<std::size_t>(14695981039346656037ull);
+            auto const add = [&h](char const* str) noexcept
+            {
+                for(auto c = str; *c != '\0'; ++c)
+                {
+                    h ^= static_cast<unsigned char>(*c);
+                    h *= static_cast<std::size_t>(1099511628211ull);
+                }
+            };
+
+            add(cat_name);
+            h ^= std::size_t{0xffu};
+            add(name);
+            return h;
+        }
+
+        std::unordered_multimap<std::size_t, entry> m_entries{};
+    };
+
+    /**
+     * \}
+     */
+} // namespace bactria
@@ -22,8 +22,11 @@
 
 #pragma once
 
+#include <bactria/core/Capture.hpp>
+#include <bactria/core/Control.hpp>
 #include <bactria/metrics/Plugin.hpp>
 
+#include <cstdint>
 #include <string>
 #include <utility>
 
@@ -80,11 +83,20 @@ namespace bactria
              * \param caller The surrounding function this phase is constructed in. This should be `__func__`.
              * \sa bactria_Enter, bactria_Leave, ~Phase()
              */
-            Phase(std::string name, std::string source, std::uint32_t lineno, std::string caller)
+            Phase(std::string name, char const* source, std::uint32_t lineno, char const* caller)
                 : m_name{std::move(name)}
             {
-                if(plugin::activated())
-                    enter(std::move(source), lineno, std::move(caller));
+                enter(source, lineno, caller);
+            }
+
+            /**
+             * \brief The entering constructor.
+             *
+             * \overload
+             */
+            Phase(std::string name, std::string const& source, std::uint32_t lineno, std::string const& caller)
+                : Phase(std::move(name), source.c_str(), lineno, caller.c_str())
+            {
             }
 
             /**
@@ -112,6 +124,10 @@ namespace bactria
                 : m_name{std::move(other.m_name)}
                 , m_entered{std::exchange(other.m_entered, bool{})}
                 , m_handle{std::exchange(other.m_handle, nullptr)}
+                , m_site{other.m_site}
+                , m_open{std::exchange(other.m_open, 0u)}
+                , m_trigger{other.m_trigger}
+                , m_triggered{std::exchange(other.m_triggered, 0u)}
             {
             }
 
@@ -126,7 +142,11 @@ namespace bactria
             {
                 m_name = std::move(rhs.m_name);
                 m_handle = std::exchange(rhs.m_handle, nullptr);
+                m_site = rhs.m_site;
                 m_entered = std::exchange(rhs.m_entered, bool{});
+                m_open = std::exchange(rhs.m_open, 0u);
+                m_trigger = rhs.m_trigger;
+                m_triggered = std::exchange(rhs.m_triggered, 0u);
 
                 return *this;
             }
@@ -141,13 +161,12 @@ namespace bactria
              */
             ~Phase()
             {
-                if(plugin::activated())
-                {
-                    if(m_entered)
-                        leave(__FILE__, __LINE__, __func__);
+                // An entry that was only counted by the capture trigger has to be left as well
+                if(m_entered || m_triggered != 0u)
+                    leave(__FILE__, __LINE__, __func__);
 
+                if(plugin::activated())
                     plugin::destroy_phase(m_handle);
-                }
             }
 
             /**
@@ -161,15 +180,33 @@ namespace bactria
              * \param caller The function where the phase is entered. This should be `__func__`.
              * \sa bactria_Enter, bactria_Leave, leave, ~Phase
              */
-            auto enter(std::string source, std::uint32_t lineno, std::string caller) -> void
+            auto enter(char const* source, std::uint32_t lineno, char const* caller) -> void
             {
-                if(plugin::activated())
+                // The entries are counted even while recording is switched off, that's what opens the window
+                if(m_trigger != nullptr)
                 {
-                    plugin::enter_phase(m_handle, source.c_str(), lineno, caller.c_str());
+                    m_trigger->enter();
+                    ++m_triggered;
+                }
+
+                if(plugin::activated() && control::is_enabled(*m_site))
+                {
+                    plugin::enter_phase(m_handle, source, lineno, caller);
+                    ++m_open;
                     m_entered = true;
                 }
             }
 
+            /**
+             * \brief Enter the phase.
+             *
+             * \overload
+             */
+            auto enter(std::string const& source, std::uint32_t lineno, std::string const& caller) -> void
+            {
+                enter(source.c_str(), lineno, caller.c_str());
+            }
+
             /**
              * \brief Leave the phase.
              *
@@ -181,19 +218,41 @@ namespace bactria
              * \param caller The function where the phase is left. This should be `__func__`.
              * \sa bactria_Enter, enter, bactria_Leave, Phase()
              */
-            auto leave(std::string source, std::uint32_t lineno, std::string caller) -> void
+            auto leave(char const* source, std::uint32_t lineno, char const* caller) -> void
             {
-                if(plugin::activated())
+                // Entries skipped because the phase was switched off at runtime aren't left either
+                if(plugin::activated() && m_open != 0u)
                 {
-                    plugin::leave_phase(m_handle, source.c_str(), lineno, caller.c_str());
+                    plugin::leave_phase(m_handle, source, lineno, caller);
+                    --m_open;
                     m_entered = false;
                 }
+
+                if(m_triggered != 0u)
+                {
+                    m_trigger->leave();
+                    --m_triggered;
+                }
+            }
+
+            /**
+             * \brief Leave the phase.
+             *
+             * \overload
+             */
+            auto leave(std::string const& source, std::uint32_t lineno, std::string const& caller) -> void
+            {
+                leave(source.c_str(), lineno, caller.c_str());
             }
 
         private:
             std::string m_name{"BACTRIA_GENERIC_PHASE"};
             void* m_handle{plugin::activated() ? plugin::create_phase(m_name.c_str()) : nullptr};
             bool m_entered{false};
+            control::site_flag const* m_site{&control::site(m_name.c_str(), control::metrics_category)};
+            std::uint32_t m_open{0u};
+            capture::trigger* m_trigger{capture::get_scheduler().trigger_for(capture::window_type::phase, m_name)};
+            std::uint32_t m_triggered{0u};
         };
     } // namespace metrics
 } // namespace bactria
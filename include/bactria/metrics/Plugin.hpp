@@ -22,10 +22,12 @@
 #pragma once
 
 #include <bactria/core/Activation.hpp>
+#include <bactria/core/Filter.hpp>
 #include <bactria/core/Plugin.hpp>
 
 #include <cstdint>
 #include <cstdlib>
+#include <limits>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
@@ -132,6 +134,34 @@ namespace bactria
              */
             auto sector_summary_ptr = sector_summary_t{nullptr};
 
+            /**
+             * \brief Signature for plugin function bactria_metrics_sector_quantile().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using sector_quantile_t = std::add_pointer_t<double(void*, double) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_metrics_sector_quantile().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto sector_quantile_ptr = sector_quantile_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_metrics_sector_work().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using sector_work_t = std::add_pointer_t<void(void*, std::uint32_t, std::uint64_t) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_metrics_sector_work().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto sector_work_ptr = sector_work_t{nullptr};
+
             /**
              * \brief Signature for plugin function bactria_metrics_create_phase().
              *
@@ -208,6 +238,8 @@ namespace bactria
                     system::load_func(handle, enter_sector_ptr, "bactria_metrics_enter_sector");
                     system::load_func(handle, leave_sector_ptr, "bactria_metrics_leave_sector");
                     system::load_func(handle, sector_summary_ptr, "bactria_metrics_sector_summary");
+                    system::load_func(handle, sector_quantile_ptr, "bactria_metrics_sector_quantile");
+                    system::load_func(handle, sector_work_ptr, "bactria_metrics_sector_work");
 
                     system::load_func(handle, create_phase_ptr, "bactria_metrics_create_phase");
                     system::load_func(handle, destroy_phase_ptr, "bactria_metrics_destroy_phase");
@@ -230,7 +262,7 @@ namespace bactria
              */
             [[nodiscard, gnu::always_inline]] inline auto create_sector(char const* name, std::uint32_t tag) noexcept
             {
-                if(create_sector_ptr != nullptr)
+                if(create_sector_ptr != nullptr && !is_filtered(name))
                     return (create_sector_ptr) (name, tag);
 
                 return static_cast<void*>(nullptr);
@@ -245,7 +277,7 @@ namespace bactria
              */
             [[gnu::always_inline]] inline auto destroy_sector(void* sector_handle) noexcept
             {
-                if(destroy_sector_ptr != nullptr)
+                if(destroy_sector_ptr != nullptr && sector_handle != nullptr)
                     (destroy_sector_ptr)(sector_handle);
             }
 
@@ -262,7 +294,7 @@ namespace bactria
                 std::uint32_t lineno,
                 char const* caller) noexcept
             {
-                if(enter_sector_ptr != nullptr)
+                if(enter_sector_ptr != nullptr && sector_handle != nullptr)
                     (enter_sector_ptr)(sector_handle, source, lineno, caller);
             }
 
@@ -279,7 +311,7 @@ namespace bactria
                 std::uint32_t lineno,
                 char const* caller) noexcept
             {
-                if(leave_sector_ptr != nullptr)
+                if(leave_sector_ptr != nullptr && sector_handle != nullptr)
                     (leave_sector_ptr)(sector_handle, source, lineno, caller);
             }
 
@@ -292,10 +324,41 @@ namespace bactria
              */
             [[gnu::always_inline]] inline auto sector_summary(void* sector_handle) noexcept
             {
-                if(sector_summary_ptr != nullptr)
+                if(sector_summary_ptr != nullptr && sector_handle != nullptr)
                     (sector_summary_ptr)(sector_handle);
             }
 
+            /**
+             * \brief Plugin-specific sector quantile query.
+             *
+             * Used internally by the Sector class. Users should not call this directly.
+             *
+             * \sa Sector::quantile()
+             */
+            [[gnu::always_inline]] inline auto sector_quantile(void* sector_handle, double q) noexcept
+            {
+                if(sector_quantile_ptr != nullptr && sector_handle != nullptr)
+                    return (sector_quantile_ptr) (sector_handle, q);
+
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+
+            /**
+             * \brief Plugin-specific sector work annotation.
+             *
+             * Used internally by the Sector class. Users should not call this directly.
+             *
+             * \sa Sector::add_work()
+             */
+            [[gnu::always_inline]] inline auto sector_work(
+                void* sector_handle,
+                std::uint32_t type,
+                std::uint64_t amount) noexcept
+            {
+                if(sector_work_ptr != nullptr && sector_handle != nullptr)
+                    (sector_work_ptr)(sector_handle, type, amount);
+            }
+
             /**
              * \brief Creates a plugin-specific phase handle.
              *
@@ -306,7 +369,7 @@ namespace bactria
              */
             [[nodiscard, gnu::always_inline]] inline auto create_phase(char const* name) noexcept
             {
-                if(create_phase_ptr != nullptr)
+                if(create_phase_ptr != nullptr && !is_filtered(name))
                     return (create_phase_ptr) (name);
 
                 return static_cast<void*>(nullptr);
@@ -321,7 +384,7 @@ namespace bactria
              */
             [[gnu::always_inline]] inline auto destroy_phase(void* phase_handle) noexcept
             {
-                if(destroy_phase_ptr != nullptr)
+                if(destroy_phase_ptr != nullptr && phase_handle != nullptr)
                     (destroy_phase_ptr)(phase_handle);
             }
 
@@ -338,7 +401,7 @@ namespace bactria
                 std::uint32_t lineno,
                 char const* caller) noexcept
             {
-                if(enter_phase_ptr != nullptr)
+                if(enter_phase_ptr != nullptr && phase_handle != nullptr)
                     (enter_phase_ptr)(phase_handle, source, lineno, caller);
             }
 
@@ -355,7 +418,7 @@ namespace bactria
                 std::uint32_t lineno,
                 char const* caller) noexcept
             {
-                if(leave_phase_ptr != nullptr)
+                if(leave_phase_ptr != nullptr && phase_handle != nullptr)
                     (leave_phase_ptr)(phase_handle, source, lineno, caller);
             }
             /** \} */
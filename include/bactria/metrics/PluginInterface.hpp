@@ -107,12 +107,41 @@ extern "C"
      * Flushes the sector summary. This is called internally by bactria::Sector::summary() or by
      * bactria::Sector::~Sector() if bactria::Sector::summary() has not been called before.
      *
+     * Plugins which collect per-execution statistics (for example of the iterations of a Body sector) should report
+     * the executions on the calling thread since the previous summary and start a new series afterwards.
+     *
      * \param[in,out] sector_handle The sector handle created by bactria_metrics_create_sector().
      * \sa bactria_metrics_create_sector(), bactria_metrics_destroy_sector(), bactria_metrics_enter_sector(),
      *     bactria_metrics_leave_sector()
      */
     auto bactria_metrics_sector_summary(void* sector_handle) noexcept -> void;
 
+    /**
+     * \brief Query a quantile of a sector's durations.
+     *
+     * Returns the \a q quantile of the durations (in seconds) of all executions of the sector on the calling thread so
+     * far. This is called internally by bactria::Sector::quantile(). Plugins which don't collect durations return NaN.
+     *
+     * \param[in] sector_handle The sector handle created by bactria_metrics_create_sector().
+     * \param[in] q The quantile in [0, 1], for example 0.99 for the 99th percentile.
+     * \return The quantile in seconds or NaN.
+     * \sa bactria_metrics_sector_summary()
+     */
+    auto bactria_metrics_sector_quantile(void* sector_handle, double q) noexcept -> double;
+
+    /**
+     * \brief Annotate a sector with work.
+     *
+     * Adds \a amount units of work of the given type to the current execution of the sector on the calling thread.
+     * This is called internally by bactria::Sector::add_work() and must neither block nor allocate. Plugins which
+     * can't relate work to durations ignore it.
+     *
+     * \param[in] sector_handle The sector handle created by bactria_metrics_create_sector().
+     * \param[in] type The work type. See bactria::metrics::work_type for the possible values.
+     * \param[in] amount The amount of work.
+     */
+    auto bactria_metrics_sector_work(void* sector_handle, std::uint32_t type, std::uint64_t amount) noexcept -> void;
+
     /**
      * \brief Create a phase handle.
      *
@@ -22,11 +22,15 @@
 
 #pragma once
 
+#include <bactria/core/Capture.hpp>
+#include <bactria/core/Control.hpp>
 #include <bactria/metrics/Plugin.hpp>
 #include <bactria/metrics/Tags.hpp>
+#include <bactria/metrics/Work.hpp>
 
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -48,9 +52,11 @@ namespace bactria
          * This class can be instantiated to instrument portions of the application code.
          * The concrete metrics collected by this class are backend-specific.
          *
-         * \sa Phase
+         * \tparam TTag The tag of the sector.
+         * \tparam TMasked Whether the tag is compiled out. Never set this explicitly.
+         * \sa Phase, BACTRIA_METRICS_TAG_MASK
          */
-        template<typename TTag = Generic>
+        template<typename TTag = Generic, bool TMasked = is_masked_tag<TTag>::value>
         class Sector final
         {
         public:
@@ -92,16 +98,32 @@ namespace bactria
              * \param caller The surrounding function this sector is constructed in. This should be `__func__`.
              * \sa bactria_Enter, bactria_Leave, ~Sector()
              */
-            Sector(std::string sector_name, std::string source, std::uint32_t lineno, std::string caller)
+            Sector(std::string sector_name, char const* source, std::uint32_t lineno, char const* caller)
                 : m_name{std::move(sector_name)}
             {
-                if(plugin::activated())
+                if(m_trigger != nullptr)
+                {
+                    m_trigger->enter();
+                    m_triggered = true;
+                }
+
+                if(plugin::activated() && control::is_enabled(*m_site))
                 {
-                    plugin::enter_sector(m_handle, source.c_str(), lineno, caller.c_str());
+                    plugin::enter_sector(m_handle, source, lineno, caller);
                     m_entered = true;
                 }
             }
 
+            /**
+             * \brief The entering constructor.
+             *
+             * \overload
+             */
+            Sector(std::string sector_name, std::string const& source, std::uint32_t lineno, std::string const& caller)
+                : Sector(std::move(sector_name), source.c_str(), lineno, caller.c_str())
+            {
+            }
+
             /**
              * \brief The copy constructor (deleted).
              *
@@ -126,6 +148,9 @@ namespace bactria
             Sector(Sector&& other)
                 : m_name{std::move(other.m_name)}
                 , m_handle{std::exchange(other.m_handle, nullptr)}
+                , m_site{other.m_site}
+                , m_trigger{other.m_trigger}
+                , m_triggered{std::exchange(other.m_triggered, bool{})}
                 , m_entered{std::exchange(other.m_entered, bool{})}
                 , m_summary{std::exchange(other.m_summary, bool{})}
                 , m_on_enter{std::move(other.m_on_enter)}
@@ -144,6 +169,9 @@ namespace bactria
             {
                 m_name = std::move(rhs.m_name);
                 m_handle = std::exchange(rhs.m_handle, nullptr);
+                m_site = rhs.m_site;
+                m_trigger = rhs.m_trigger;
+                m_triggered = std::exchange(rhs.m_triggered, bool{});
                 m_entered = std::exchange(rhs.m_entered, bool{});
                 m_summary = std::exchange(rhs.m_summary, bool{});
                 m_on_enter = std::move(rhs.m_on_enter);
@@ -162,11 +190,12 @@ namespace bactria
              */
             ~Sector()
             {
+                // An entry that was only counted by the capture trigger has to be left as well
+                if(m_entered || m_triggered)
+                    leave(__FILE__, __LINE__, __func__);
+
                 if(plugin::activated())
                 {
-                    if(m_entered)
-                        leave(__FILE__, __LINE__, __func__);
-
                     if(!m_summary)
                         summary();
 
@@ -185,16 +214,33 @@ namespace bactria
              * \param caller The function where the sector is entered. This should be `__func__`.
              * \sa bactria_Enter, bactria_Leave, leave, ~Sector
              */
-            auto enter(std::string source, std::uint32_t lineno, std::string caller) -> void
+            auto enter(char const* source, std::uint32_t lineno, char const* caller) -> void
             {
-                if(plugin::activated())
+                // The entries are counted even while recording is switched off, that's what opens the window
+                if(m_trigger != nullptr)
+                {
+                    m_trigger->enter();
+                    m_triggered = true;
+                }
+
+                if(plugin::activated() && control::is_enabled(*m_site))
                 {
-                    plugin::enter_sector(m_handle, source.c_str(), lineno, caller.c_str());
+                    plugin::enter_sector(m_handle, source, lineno, caller);
                     m_on_enter();
                     m_entered = true;
                 }
             }
 
+            /**
+             * \brief Enter the sector.
+             *
+             * \overload
+             */
+            auto enter(std::string const& source, std::uint32_t lineno, std::string const& caller) -> void
+            {
+                enter(source.c_str(), lineno, caller.c_str());
+            }
+
             /**
              * \brief Leave the sector.
              *
@@ -205,14 +251,30 @@ namespace bactria
              * \param caller The function where the sector is left. This should be `__func__`.
              * \sa bactria_Enter, enter, bactria_Leave, Sector()
              */
-            auto leave(std::string source, std::uint32_t lineno, std::string caller) -> void
+            auto leave(char const* source, std::uint32_t lineno, char const* caller) -> void
             {
-                if(plugin::activated())
+                if(plugin::activated() && m_entered)
                 {
                     m_on_leave();
-                    plugin::leave_sector(m_handle, source.c_str(), lineno, caller.c_str());
+                    plugin::leave_sector(m_handle, source, lineno, caller);
                     m_entered = false;
                 }
+
+                if(m_triggered)
+                {
+                    m_trigger->leave();
+                    m_triggered = false;
+                }
+            }
+
+            /**
+             * \brief Leave the sector.
+             *
+             * \overload
+             */
+            auto leave(std::string const& source, std::uint32_t lineno, std::string const& caller) -> void
+            {
+                leave(source.c_str(), lineno, caller.c_str());
             }
 
             /**
@@ -222,6 +284,9 @@ namespace bactria
              * useful for Sectors with the Body tag which allows the back-end to evaluate the individual iterations
              * and generate statistics for the overall loop. If this method has not been called before destruction,
              * the destructor will call this internally.
+             *
+             * A summary covers the executions of the Sector on the calling thread since the previous summary.
+             * Construct Body sectors outside of the loop so that the summary covers all iterations.
              */
             auto summary() -> void
             {
@@ -232,6 +297,45 @@ namespace bactria
                 }
             }
 
+            /**
+             * \brief Query a quantile of the Sector's durations.
+             *
+             * Returns the \a q quantile of the durations of all executions of the Sector (and of all other Sectors
+             * with the same name and tag) on the calling thread so far. The query may be made at any time. Not all
+             * back-ends collect durations; the native plugin does so if `sketch.enable` is set in the
+             * `[metrics.native]` section of the configuration.
+             *
+             * \param q The quantile in [0, 1], for example 0.99 for the 99th percentile.
+             * \return The quantile in seconds or NaN if the back-end doesn't collect durations or bactria is
+             *         deactivated.
+             */
+            auto quantile(double q) const noexcept -> double
+            {
+                if(plugin::activated())
+                    return plugin::sector_quantile(m_handle, q);
+
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+
+            /**
+             * \brief Annotate the Sector with work.
+             *
+             * Adds \a amount units of work to the current execution of the Sector, for example the bytes a loop
+             * body reads or the floating-point operations it performs. May be called any number of times between
+             * enter() and leave(); work added while the Sector isn't entered is ignored by the back-ends. Back-ends
+             * which support work report the throughput (e.g. GB/s or FLOP/s) and the arithmetic intensity of the
+             * Sector. This function does not allocate.
+             *
+             * \param type The kind of work.
+             * \param amount The amount of work.
+             * \sa work_type
+             */
+            auto add_work(work_type type, std::uint64_t amount) const noexcept -> void
+            {
+                if(plugin::activated())
+                    plugin::sector_work(m_handle, static_cast<std::uint32_t>(type), amount);
+            }
+
             /**
              * \brief Define an enter action.
              *
@@ -269,12 +373,83 @@ namespace bactria
         private:
             std::string m_name{"BACTRIA_GENERIC_SECTOR"};
             void* m_handle{plugin::activated() ? plugin::create_sector(m_name.c_str(), TTag::value) : nullptr};
+            control::site_flag const* m_site{&control::site(m_name.c_str(), control::metrics_category)};
+            capture::trigger* m_trigger{capture::get_scheduler().trigger_for(capture::window_type::sector, m_name)};
+            bool m_triggered{false};
             bool m_entered{false};
             bool m_summary{false};
             std::function<void(void)> m_on_enter = []() {};
             std::function<void(void)> m_on_leave = []() {};
         };
 
+        /**
+         * \brief The compiled-out sector class.
+         *
+         * Sectors whose tag is set in #BACTRIA_METRICS_TAG_MASK are replaced by this empty class. It accepts the
+         * same arguments as the regular Sector but ignores them without converting them, so the compiler can remove
+         * every use. Actions defined with on_enter() and on_leave() are not executed, just as if bactria was
+         * deactivated.
+         *
+         * \sa BACTRIA_METRICS_TAG_MASK
+         */
+        template<typename TTag>
+        class Sector<TTag, true> final
+        {
+        public:
+            Sector() = default;
+
+            template<
+                typename TName,
+                std::enable_if_t<!std::is_same<std::decay_t<TName>, Sector>::value, int> = 0>
+            constexpr Sector(TName&&) noexcept
+            {
+            }
+
+            template<typename TName, typename TSource, typename TCaller>
+            constexpr Sector(TName&&, TSource&&, std::uint32_t, TCaller&&) noexcept
+            {
+            }
+
+            Sector(Sector const&) = delete;
+            auto operator=(Sector const&) -> Sector& = delete;
+            Sector(Sector&&) noexcept = default;
+            auto operator=(Sector&&) noexcept -> Sector& = default;
+            ~Sector() = default;
+
+            template<typename... TArgs>
+            constexpr auto enter(TArgs&&...) const noexcept -> void
+            {
+            }
+
+            template<typename... TArgs>
+            constexpr auto leave(TArgs&&...) const noexcept -> void
+            {
+            }
+
+            constexpr auto summary() const noexcept -> void
+            {
+            }
+
+            auto quantile(double) const noexcept -> double
+            {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+
+            constexpr auto add_work(work_type, std::uint64_t) const noexcept -> void
+            {
+            }
+
+            template<typename TFunc>
+            constexpr auto on_enter(TFunc&&) const noexcept -> void
+            {
+            }
+
+            template<typename TFunc>
+            constexpr auto on_leave(TFunc&&) const noexcept -> void
+            {
+            }
+        };
+
         /**
          * \}
          */
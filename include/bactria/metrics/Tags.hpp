@@ -23,6 +23,53 @@
 
 #pragma once
 
+#include <type_traits>
+
+/**
+ * \brief Mask bit of the Generic tag.
+ * \ingroup bactria_metrics_user
+ * \sa BACTRIA_METRICS_TAG_MASK
+ */
+#define BACTRIA_METRICS_TAG_GENERIC (1ull << 1u)
+
+/**
+ * \brief Mask bit of the Function tag.
+ * \ingroup bactria_metrics_user
+ * \sa BACTRIA_METRICS_TAG_MASK
+ */
+#define BACTRIA_METRICS_TAG_FUNCTION (1ull << 2u)
+
+/**
+ * \brief Mask bit of the Loop tag.
+ * \ingroup bactria_metrics_user
+ * \sa BACTRIA_METRICS_TAG_MASK
+ */
+#define BACTRIA_METRICS_TAG_LOOP (1ull << 3u)
+
+/**
+ * \brief Mask bit of the Body tag.
+ * \ingroup bactria_metrics_user
+ * \sa BACTRIA_METRICS_TAG_MASK
+ */
+#define BACTRIA_METRICS_TAG_BODY (1ull << 4u)
+
+#ifndef BACTRIA_METRICS_TAG_MASK
+/**
+ * \brief The tags which are compiled out.
+ * \ingroup bactria_metrics_user
+ *
+ * Sectors with a tag in this mask are replaced by an empty type whose member functions do nothing, so they cost
+ * nothing at run-time. Define this on the command line to strip fine-grained instrumentation from production builds,
+ * for example `-DBACTRIA_METRICS_TAG_MASK=BACTRIA_METRICS_TAG_BODY` removes all Body sectors while Function sectors
+ * remain. Combine several tags with `|`. The bit of a tag is `1 << TTag::value`, so user-defined tags with a value
+ * below 64 take part as well; alternatively specialize bactria::metrics::is_masked_tag. Default: no tag is masked.
+ *
+ * \sa is_masked_tag, BACTRIA_METRICS_TAG_GENERIC, BACTRIA_METRICS_TAG_FUNCTION, BACTRIA_METRICS_TAG_LOOP,
+ *     BACTRIA_METRICS_TAG_BODY
+ */
+#    define BACTRIA_METRICS_TAG_MASK 0ull
+#endif
+
 namespace bactria
 {
     namespace metrics
@@ -93,5 +140,25 @@ namespace bactria
              */
             static constexpr auto value = 4u;
         };
+
+        /**
+         * \brief Query whether a tag is compiled out.
+         * \ingroup bactria_metrics_user
+         *
+         * True if the bit `1 << TTag::value` is set in #BACTRIA_METRICS_TAG_MASK. Specialize this trait for
+         * user-defined tags which should be masked independently of their value.
+         *
+         * \tparam TTag The tag.
+         * \sa BACTRIA_METRICS_TAG_MASK, Sector
+         */
+        template<typename TTag>
+        struct is_masked_tag
+            : std::integral_constant<
+                  bool,
+                  (TTag::value < 64u)
+                      ? ((static_cast<unsigned long long>(BACTRIA_METRICS_TAG_MASK) >> TTag::value) & 1ull) != 0ull
+                      : false>
+        {
+        };
     } // namespace metrics
 } // namespace bactria
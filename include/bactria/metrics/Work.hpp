@@ -0,0 +1,49 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+/**
+ * \file Work.hpp
+ * \brief Work type definitions.
+ *
+ * This file defines the kinds of work a Sector can be annotated with. It should not be included directly by the user.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace bactria
+{
+    namespace metrics
+    {
+        /**
+         * \brief The work types.
+         * \ingroup bactria_metrics_user
+         *
+         * The quantities of work a Sector can be annotated with. Back-ends relate them to the Sector's duration, e.g.
+         * as bandwidth (bytes per second), FLOP rate or arithmetic intensity (FLOPs per byte). The numeric values are
+         * part of the plugin interface and must not change.
+         *
+         * \sa Sector::add_work
+         */
+        enum class work_type : std::uint32_t
+        {
+            bytes_read = 0u, /**< Bytes loaded from memory or storage. */
+            bytes_written = 1u, /**< Bytes stored to memory or storage. */
+            flops = 2u, /**< Floating-point operations. */
+            items = 3u /**< Application-defined work items, e.g. cells, particles or requests. */
+        };
+    } // namespace metrics
+} // namespace bactria
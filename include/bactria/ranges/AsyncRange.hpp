@@ -0,0 +1,226 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+/**
+ * \file AsyncRange.hpp
+ * \brief AsyncRange definitions.
+ *
+ * This file contains the definition of the AsyncRange class. It should not be included directly by the user.
+ */
+
+#pragma once
+
+#include <bactria/ranges/Category.hpp>
+#include <bactria/ranges/Colors.hpp>
+#include <bactria/ranges/Correlation.hpp>
+#include <bactria/ranges/Marker.hpp>
+#include <bactria/ranges/Plugin.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace bactria
+{
+    namespace ranges
+    {
+        /**
+         * \brief The asynchronous range class.
+         * \ingroup bactria_ranges_user
+         *
+         * An AsyncRange is a time span that may be started on one thread and stopped on another, for example when a
+         * work item is created by a producer and completed by a thread pool. Each AsyncRange carries a 64 bit
+         * correlation ID which back-ends use to match the start and the stop. Back-ends record AsyncRanges as
+         * asynchronous or flow spans instead of nested per-thread spans.
+         *
+         * An AsyncRange can not be copied, but it can be moved to the thread that completes the work. start() and
+         * stop() may be called from any thread; concurrent calls to stop() will stop the range exactly once.
+         *
+         * \sa Range
+         */
+        class AsyncRange : public Marker
+        {
+        public:
+            /**
+             * \brief The default constructor.
+             *
+             * Constructs an AsyncRange with the name \a BACTRIA_GENERIC_ASYNC_RANGE, the color
+             * bactria::ranges::color::bactria_cyan, the default Category and a newly generated correlation ID. It
+             * will not be started automatically.
+             *
+             * \sa ~AsyncRange, start, stop, Category
+             */
+            AsyncRange() : Marker("BACTRIA_GENERIC_ASYNC_RANGE", color::bactria_cyan, Category{})
+            {
+            }
+
+            /**
+             * \brief The constructor.
+             *
+             * Constructs an AsyncRange with the name \a name, the color \a color, the Category \a category and the
+             * correlation ID \a correlation_id.
+             *
+             * \param name The name of the range as it should be shown on the visualizer.
+             * \param color The range's color in ARGB format as it should be shown on the visualizer.
+             *              Default: bactria::ranges::color::bactria_cyan.
+             * \param category The range's category. Default: bactria's default category.
+             * \param correlation_id The ID correlating start and stop. Default: a newly generated ID.
+             * \param autostart If \a true start the range on construction. Default: \a true.
+             *
+             * \sa ~AsyncRange, start, stop, Category, make_correlation_id
+             */
+            AsyncRange(
+                std::string name,
+                std::uint32_t color = color::bactria_cyan,
+                Category category = Category{},
+                std::uint64_t correlation_id = make_correlation_id(),
+                bool autostart = true)
+                : Marker(std::move(name), color, std::move(category))
+                , m_correlation_id{correlation_id}
+            {
+                if(autostart && plugin::activated())
+                    start();
+            }
+
+            /**
+             * \brief The copy constructor (deleted).
+             *
+             * Two AsyncRanges with the same correlation ID would confuse the back-ends. Thus, the copy constructor is
+             * deleted.
+             */
+            AsyncRange(AsyncRange const&) = delete;
+
+            /**
+             * \brief The copy assignment operator (deleted).
+             *
+             * Two AsyncRanges with the same correlation ID would confuse the back-ends. Thus, the copy assignment
+             * operator is deleted.
+             */
+            auto operator=(AsyncRange const&) -> AsyncRange& = delete;
+
+            /**
+             * \brief The move constructor.
+             *
+             * Constructs an AsyncRange by moving the properties of the \a other AsyncRange into \a this. If \a other
+             * is already started \a this will keep running. This is the intended way of handing an AsyncRange over to
+             * another thread.
+             *
+             * After construction \a other will be in an undefined state.
+             *
+             * \sa ~AsyncRange, start, stop
+             */
+            AsyncRange(AsyncRange&& other) noexcept
+                : Marker(std::move(other))
+                , m_handle{std::exchange(other.m_handle, nullptr)}
+                , m_correlation_id{other.m_correlation_id}
+                , m_started{other.m_started.exchange(false)}
+            {
+            }
+
+            /**
+             * \brief The move assignment operator.
+             *
+             * Moves the properties of the \a rhs AsyncRange into \a this. If \a this is still running it will be
+             * stopped first. If \a rhs is already started \a this will keep running.
+             *
+             * After the assignment \a rhs will be in an undefined state.
+             *
+             * \sa ~AsyncRange, start, stop
+             */
+            auto operator=(AsyncRange&& rhs) noexcept -> AsyncRange&
+            {
+                if(plugin::activated())
+                {
+                    stop();
+                    plugin::destroy_range(m_handle);
+                }
+
+                Marker::operator=(std::move(rhs));
+                m_handle = std::exchange(rhs.m_handle, nullptr);
+                m_correlation_id = rhs.m_correlation_id;
+                m_started = rhs.m_started.exchange(false);
+
+                return *this;
+            }
+
+            /**
+             * \brief The destructor.
+             *
+             * Destructs the AsyncRange. If the AsyncRange was running until this point the destructor will stop it
+             * on the calling thread.
+             */
+            ~AsyncRange() override
+            {
+                if(plugin::activated())
+                {
+                    stop();
+                    plugin::destroy_range(m_handle);
+                }
+            }
+
+            /**
+             * \brief Manual start.
+             *
+             * Manually starts the AsyncRange. If \a this was already started before the method will do nothing.
+             */
+            auto start() noexcept -> void
+            {
+                if(plugin::activated() && is_enabled() && !m_started.exchange(true, std::memory_order_acq_rel))
+                    plugin::start_async_range(m_handle, m_correlation_id);
+            }
+
+            /**
+             * \brief Manual stop.
+             *
+             * Manually stops the AsyncRange. This may happen on any thread. If \a this was not running before the
+             * method will do nothing.
+             */
+            auto stop() noexcept -> void
+            {
+                if(plugin::activated() && m_started.exchange(false, std::memory_order_acq_rel))
+                    plugin::stop_async_range(m_handle, m_correlation_id);
+            }
+
+            /**
+             * \brief Query status.
+             *
+             * \return If \a true then \a this has been started and can be stopped.
+             */
+            auto is_running() const noexcept -> bool
+            {
+                return m_started.load(std::memory_order_acquire);
+            }
+
+            /**
+             * \brief Return the correlation ID.
+             *
+             * \return The correlation ID assigned to \a this.
+             */
+            auto get_correlation_id() const noexcept -> std::uint64_t
+            {
+                return m_correlation_id;
+            }
+
+        private:
+            void* m_handle{
+                plugin::activated()
+                    ? plugin::create_range(m_name.c_str(), m_color, m_category.get_c_name(), m_category.get_id())
+                    : nullptr};
+            std::uint64_t m_correlation_id{make_correlation_id()};
+            std::atomic<bool> m_started{false};
+        };
+    } // namespace ranges
+} // namespace bactria
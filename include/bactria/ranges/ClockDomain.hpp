@@ -0,0 +1,143 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+/**
+ * \file ClockDomain.hpp
+ * \brief ClockDomain definitions.
+ *
+ * This file contains the definition of the ClockDomain class which converts foreign timestamps into bactria's time
+ * base. It should not be included directly by the user.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace bactria
+{
+    namespace ranges
+    {
+        /**
+         * \brief Return the current time in bactria's time base.
+         * \ingroup bactria_ranges_user
+         *
+         * bactria's time base are the nanoseconds of `std::chrono::steady_clock`.
+         *
+         * \return The current time in nanoseconds.
+         * \sa ClockDomain
+         */
+        inline auto time_base_now() noexcept -> std::int64_t
+        {
+            auto const now = std::chrono::steady_clock::now().time_since_epoch();
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+        }
+
+        /**
+         * \brief A linear mapping from a foreign clock into bactria's time base.
+         * \ingroup bactria_ranges_user
+         *
+         * Timestamps measured elsewhere (device timers, cycle counters, simulation logs, ...) are usually given in
+         * ticks of a foreign clock. A ClockDomain converts them into bactria's time base using a tick rate and a
+         * reference point at which both clocks have been read. The default-constructed ClockDomain is the identity,
+         * i.e. the timestamps already are in bactria's time base.
+         *
+         * \sa time_base_now, Timeline
+         */
+        class ClockDomain
+        {
+        public:
+            /**
+             * \brief The default constructor.
+             *
+             * Constructs the identity mapping.
+             */
+            ClockDomain() = default;
+
+            /**
+             * \brief The constructor.
+             *
+             * Constructs a mapping for a clock running at \a ticks_per_second which showed \a reference_ticks at
+             * bactria's time \a reference_time.
+             *
+             * \param ticks_per_second The frequency of the foreign clock. Must be positive and finite.
+             * \param reference_ticks The foreign timestamp of the reference point.
+             * \param reference_time The time of the reference point in bactria's time base (see time_base_now).
+             * \throws std::invalid_argument If \a ticks_per_second is not positive and finite.
+             */
+            ClockDomain(double ticks_per_second, std::uint64_t reference_ticks, std::int64_t reference_time)
+                : m_ns_per_tick{1e9 / ticks_per_second}
+                , m_reference_ticks{reference_ticks}
+                , m_reference_time{reference_time}
+                , m_identity{false}
+            {
+                // A zero, negative or infinite rate would map every timestamp to the reference point or overflow
+                if(!(ticks_per_second > 0.0) || !std::isfinite(ticks_per_second))
+                    throw std::invalid_argument{"bactria::ranges::ClockDomain: invalid tick rate"};
+            }
+
+            /**
+             * \brief Derive a mapping from two reference points.
+             *
+             * Both clocks are read twice (as close together as possible). The tick rate is derived from the two
+             * points, which also compensates for a constant drift between the clocks. Both clocks must have advanced
+             * in the same direction between the two points.
+             *
+             * \param ticks0 The foreign timestamp of the first reference point.
+             * \param time0 The first reference point in bactria's time base.
+             * \param ticks1 The foreign timestamp of the second reference point.
+             * \param time1 The second reference point in bactria's time base.
+             * \return The ClockDomain mapping the foreign clock into bactria's time base.
+             * \throws std::invalid_argument If the two points have the same ticks or the same time, or if one clock
+             *         went backwards while the other went forwards.
+             */
+            static auto calibrate(std::uint64_t ticks0, std::int64_t time0, std::uint64_t ticks1, std::int64_t time1)
+                -> ClockDomain
+            {
+                auto const ticks = static_cast<double>(static_cast<std::int64_t>(ticks1 - ticks0));
+                auto const ns = static_cast<double>(time1 - time0);
+                if(ticks == 0.0 || ns == 0.0)
+                    throw std::invalid_argument{"bactria::ranges::ClockDomain: degenerate reference points"};
+
+                return ClockDomain{ticks * 1e9 / ns, ticks0, time0};
+            }
+
+            /**
+             * \brief Convert a foreign timestamp.
+             *
+             * \param ticks The foreign timestamp.
+             * \return The timestamp in bactria's time base.
+             */
+            auto to_time_base(std::uint64_t ticks) const noexcept -> std::int64_t
+            {
+                if(m_identity)
+                    return static_cast<std::int64_t>(ticks);
+
+                // Scale only the (small) distance to the reference point to keep the full precision of the result
+                auto const delta = static_cast<double>(static_cast<std::int64_t>(ticks - m_reference_ticks));
+                return m_reference_time + static_cast<std::int64_t>(delta * m_ns_per_tick);
+            }
+
+        private:
+            double m_ns_per_tick{1.0};
+            std::uint64_t m_reference_ticks{0u};
+            std::int64_t m_reference_time{0};
+            bool m_identity{true};
+        };
+    } // namespace ranges
+} // namespace bactria
@@ -0,0 +1,49 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+/**
+ * \file Correlation.hpp
+ * \brief Correlation ID definitions.
+ *
+ * This file contains the generator for correlation IDs which link markers across threads. It should not be included
+ * directly by the user.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace bactria
+{
+    namespace ranges
+    {
+        /**
+         * \brief Generate a correlation ID.
+         * \ingroup bactria_ranges_user
+         *
+         * Generates a process-wide unique 64 bit correlation ID. This function is thread-safe.
+         *
+         * \return A correlation ID that has not been returned before.
+         * \sa AsyncRange, Flow
+         */
+        inline auto make_correlation_id() noexcept -> std::uint64_t
+        {
+            static std::atomic<std::uint64_t> next_id{1u};
+            return next_id.fetch_add(1u, std::memory_order_relaxed);
+        }
+    } // namespace ranges
+} // namespace bactria
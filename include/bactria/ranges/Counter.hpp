@@ -0,0 +1,276 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+/**
+ * \file Counter.hpp
+ * \brief Counter definitions.
+ *
+ * This file contains the definition of the Counter class. It should not be included directly by the user.
+ */
+
+#pragma once
+
+#include <bactria/ranges/Category.hpp>
+#include <bactria/ranges/Colors.hpp>
+#include <bactria/ranges/Marker.hpp>
+#include <bactria/ranges/Payload.hpp>
+#include <bactria/ranges/Plugin.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace bactria
+{
+    namespace ranges
+    {
+        /**
+         * \brief Return the default minimum sampling interval of Counters.
+         * \ingroup bactria_ranges_user
+         *
+         * The default interval is read once from the environment variable `BACTRIA_COUNTER_INTERVAL` (in
+         * microseconds). If the variable is not set the interval is zero, i.e. every changed value is recorded.
+         *
+         * \return The default minimum sampling interval.
+         * \sa Counter
+         */
+        inline auto default_counter_interval() -> std::chrono::nanoseconds
+        {
+            static auto const interval = []() {
+                auto const env = std::getenv("BACTRIA_COUNTER_INTERVAL");
+                auto const us = (env != nullptr) ? std::strtoll(env, nullptr, 10) : 0ll;
+                return std::chrono::nanoseconds{std::chrono::microseconds{us > 0 ? us : 0ll}};
+            }();
+            return interval;
+        }
+
+        /**
+         * \brief The counter class.
+         * \ingroup bactria_ranges_user
+         *
+         * A Counter tracks a numeric quantity over time, for example the memory in use or the number of items in a
+         * queue. Every change of the value is sent to the plugin as a timestamped sample; trace back-ends render
+         * the samples as a counter track next to the ranges.
+         *
+         * To keep Counters cheap in hot loops, consecutive identical values are coalesced and samples closer
+         * together than the Counter's minimum interval are dropped. A dropped value is recorded by the next sample
+         * after the interval, by flush() or by the destructor. If the value didn't change the caller only pays for
+         * a comparison.
+         *
+         * Counters are not thread-safe. Use one Counter per thread or synchronize the accesses.
+         *
+         * \tparam TValue The value type. Signed and unsigned integers and floating-point numbers are supported.
+         * \sa Payload, default_counter_interval
+         */
+        template<typename TValue = std::int64_t>
+        class Counter : public Marker
+        {
+            static_assert(
+                std::is_arithmetic<TValue>::value && !std::is_same<TValue, bool>::value,
+                "bactria::ranges::Counter requires an integral or floating-point value type");
+
+        public:
+            /**
+             * \brief The default constructor.
+             *
+             * Constructs a Counter with the name \a BACTRIA_GENERIC_COUNTER, the color
+             * bactria::ranges::color::bactria_green, the default Category and the default minimum interval.
+             */
+            Counter() : Marker("BACTRIA_GENERIC_COUNTER", color::bactria_green, Category{})
+            {
+            }
+
+            /**
+             * \brief The constructor.
+             *
+             * Constructs a Counter with the name \a name, the color \a color, the Category \a category and the
+             * minimum sampling interval \a min_interval. The initial value is zero; it is not recorded until the
+             * first call to set() or add().
+             *
+             * \param name The name of the counter as it should be shown on the visualizer.
+             * \param color The counter's color in ARGB format. Default: bactria::ranges::color::bactria_green.
+             * \param category The counter's category. Default: bactria's default category.
+             * \param min_interval The minimum time between two samples. Default: default_counter_interval().
+             */
+            Counter(
+                std::string name,
+                std::uint32_t color = color::bactria_green,
+                Category category = Category{},
+                std::chrono::nanoseconds min_interval = default_counter_interval())
+                : Marker(std::move(name), color, std::move(category))
+                , m_min_interval{min_interval}
+            {
+            }
+
+            /**
+             * \brief The copy constructor (deleted).
+             *
+             * Two Counters would write to the same counter track. Thus, the copy constructor is deleted.
+             */
+            Counter(Counter const&) = delete;
+
+            /**
+             * \brief The copy assignment operator (deleted).
+             *
+             * Two Counters would write to the same counter track. Thus, the copy assignment operator is deleted.
+             */
+            auto operator=(Counter const&) -> Counter& = delete;
+
+            /**
+             * \brief The move constructor.
+             *
+             * Constructs a Counter by moving the properties and the current value of \a other into \a this. After
+             * construction \a other will be in an undefined state.
+             */
+            Counter(Counter&& other) noexcept
+                : Marker(std::move(other))
+                , m_handle{std::exchange(other.m_handle, nullptr)}
+                , m_min_interval{other.m_min_interval}
+                , m_last_time{other.m_last_time}
+                , m_value{other.m_value}
+                , m_last_value{other.m_last_value}
+                , m_recorded{std::exchange(other.m_recorded, false)}
+            {
+            }
+
+            /**
+             * \brief The move assignment operator.
+             *
+             * Flushes \a this and moves the properties and the current value of \a rhs into \a this. After the
+             * assignment \a rhs will be in an undefined state.
+             */
+            auto operator=(Counter&& rhs) noexcept -> Counter&
+            {
+                if(plugin::activated())
+                {
+                    flush();
+                    plugin::destroy_counter(m_handle);
+                }
+
+                Marker::operator=(std::move(rhs));
+                m_handle = std::exchange(rhs.m_handle, nullptr);
+                m_min_interval = rhs.m_min_interval;
+                m_last_time = rhs.m_last_time;
+                m_value = rhs.m_value;
+                m_last_value = rhs.m_last_value;
+                m_recorded = std::exchange(rhs.m_recorded, false);
+
+                return *this;
+            }
+
+            /**
+             * \brief The destructor.
+             *
+             * Records a pending value which was dropped because of the minimum interval and destroys the Counter.
+             */
+            ~Counter() override
+            {
+                if(plugin::activated())
+                {
+                    flush();
+                    plugin::destroy_counter(m_handle);
+                }
+            }
+
+            /**
+             * \brief Set the counter's value.
+             *
+             * \param value The new value.
+             */
+            auto set(TValue value) noexcept -> void
+            {
+                m_value = value;
+                sample();
+            }
+
+            /**
+             * \brief Add to the counter's value.
+             *
+             * \param delta The difference to add. May be negative for signed and floating-point value types.
+             */
+            auto add(TValue delta) noexcept -> void
+            {
+                m_value += delta;
+                sample();
+            }
+
+            /**
+             * \brief Return the counter's current value.
+             */
+            auto get() const noexcept -> TValue
+            {
+                return m_value;
+            }
+
+            /**
+             * \brief Record the current value regardless of the minimum interval.
+             *
+             * Does nothing if the current value has already been recorded.
+             */
+            auto flush() noexcept -> void
+            {
+                // Moved-from Counters have no handle left
+                if(plugin::activated() && m_handle != nullptr && is_enabled()
+                   && !(m_recorded && m_value == m_last_value))
+                {
+                    if(m_min_interval.count() > 0)
+                        m_last_time = std::chrono::steady_clock::now();
+
+                    record();
+                }
+            }
+
+        private:
+            auto sample() noexcept -> void
+            {
+                // Coalescing has to be as cheap as possible: it is the common case in hot loops
+                if(!plugin::activated() || (m_recorded && m_value == m_last_value) || !is_enabled())
+                    return;
+
+                // Only read the clock if there is an interval to enforce
+                if(m_min_interval.count() > 0)
+                {
+                    auto const now = std::chrono::steady_clock::now();
+                    if(m_recorded && (now - m_last_time) < m_min_interval)
+                        return;
+
+                    m_last_time = now;
+                }
+
+                record();
+            }
+
+            auto record() noexcept -> void
+            {
+                plugin::sample_counter(m_handle, Payload{m_value});
+                m_last_value = m_value;
+                m_recorded = true;
+            }
+
+            void* m_handle{
+                plugin::activated()
+                    ? plugin::create_counter(m_name.c_str(), m_color, m_category.get_c_name(), m_category.get_id())
+                    : nullptr};
+            std::chrono::nanoseconds m_min_interval{default_counter_interval()};
+            std::chrono::steady_clock::time_point m_last_time{};
+            TValue m_value{};
+            TValue m_last_value{};
+            bool m_recorded{false};
+        };
+    } // namespace ranges
+} // namespace bactria
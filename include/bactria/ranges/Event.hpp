@@ -26,7 +26,9 @@
 #include <bactria/ranges/Category.hpp>
 #include <bactria/ranges/Colors.hpp>
 #include <bactria/ranges/Marker.hpp>
+#include <bactria/ranges/Payload.hpp>
 #include <bactria/ranges/Plugin.hpp>
+#include <bactria/ranges/Sampler.hpp>
 
 #include <functional>
 #include <string>
@@ -73,6 +75,26 @@ namespace bactria
             {
             }
 
+            /**
+             * \brief The constructor with a Sampler.
+             *
+             * Constructs an Event like the constructor above, but samples its firings with its own \a sampler instead
+             * of sharing the Sampler of its site (see site_sampler()).
+             *
+             * \param name The name as it should appear on the visualizer.
+             * \param color The color as it should appear on the visualizer. Needs to be supplied in ARGB format.
+             * \param category The category this event should be assigned to. This allows for later filtering.
+             * \param sampler The event's Sampler.
+             *
+             * \sa Sampler, set_sampler
+             */
+            Event(std::string name, std::uint32_t color, Category category, Sampler sampler)
+                : Marker(std::move(name), color, std::move(category))
+                , m_site_sampler{nullptr}
+                , m_sampler{sampler}
+            {
+            }
+
             /**
              * \brief The copy constructor.
              *
@@ -82,8 +104,9 @@ namespace bactria
              */
             Event(const Event& other)
                 : Marker(other)
-                , m_handle{plugin::activated() ? plugin::create_event(m_color, m_category.get_c_name(), m_category.get_id()) : nullptr}
                 , m_action{other.m_action}
+                , m_site_sampler{other.m_site_sampler}
+                , m_sampler{other.m_sampler}
             {
             }
 
@@ -96,14 +119,15 @@ namespace bactria
              */
             auto operator=(const Event& rhs) -> Event&
             {
-                Marker::operator=(rhs);
-
                 if(plugin::activated())
-                    m_handle = plugin::create_event(m_color, m_category.get_c_name(), m_category.get_id());
-                else
-                    m_handle = nullptr;
+                    plugin::destroy_event(m_handle);
 
+                Marker::operator=(rhs);
+                m_handle = nullptr;
+                m_created = false;
                 m_action = rhs.m_action;
+                m_site_sampler = rhs.m_site_sampler;
+                m_sampler = rhs.m_sampler;
 
                 return *this;
             }
@@ -116,7 +140,12 @@ namespace bactria
              *
              * \param other The Event to be moved.
              */
-            Event(Event&& other) noexcept : Marker(std::move(other)), m_handle{std::exchange(other.m_handle, nullptr)}
+            Event(Event&& other) noexcept
+                : Marker(std::move(other))
+                , m_handle{std::exchange(other.m_handle, nullptr)}
+                , m_created{std::exchange(other.m_created, bool{})}
+                , m_site_sampler{other.m_site_sampler}
+                , m_sampler{other.m_sampler}
             {
                 std::swap(m_action, other.m_action);
             }
@@ -131,9 +160,15 @@ namespace bactria
              */
             auto operator=(Event&& rhs) noexcept -> Event&
             {
+                if(plugin::activated())
+                    plugin::destroy_event(m_handle);
+
                 Marker::operator=(std::move(rhs));
                 m_handle = std::exchange(rhs.m_handle, nullptr);
+                m_created = std::exchange(rhs.m_created, bool{});
                 std::swap(m_action, rhs.m_action);
+                m_site_sampler = rhs.m_site_sampler;
+                m_sampler = rhs.m_sampler;
 
                 return *this;
             }
@@ -157,15 +192,25 @@ namespace bactria
              * the interface requires the source file, the line number and the calling function, this information may
              * not be supported by all back-ends. In this case the parameters will be silently ignored.
              *
+             * An optional Payload attaches a numeric value to this particular firing. Firings which are not sampled
+             * by the Event's Sampler are dropped before they reach the plugin. The plugin's handle for the Event is
+             * created by the first sampled firing, so an Event whose firings are never sampled doesn't reach the
+             * plugin at all.
+             *
              * \param source The source file where the event is fired. Should be `__FILE__`.
              * \param lineno The source line where the event is fired. Should be `__LINE__`.
              * \param caller The surrounding function of the event firing. Should be `__func__`.
+             * \param payload The value attached to the event. Default: no value.
              */
-            auto fire(std::string source, std::uint32_t lineno, std::string caller) noexcept -> void
+            auto fire(
+                std::string source,
+                std::uint32_t lineno,
+                std::string caller,
+                Payload payload = Payload{}) noexcept -> void
             {
-                if(plugin::activated())
+                if(plugin::activated() && is_enabled() && sample())
                 {
-                    plugin::fire_event(m_handle, m_action().c_str(), source.c_str(), lineno, caller.c_str());
+                    plugin::fire_event(handle(), m_action().c_str(), payload, source.c_str(), lineno, caller.c_str());
                 }
             }
 
@@ -183,11 +228,44 @@ namespace bactria
                 m_action = std::move(a);
             }
 
+            /**
+             * \brief Replace the Event's Sampler.
+             *
+             * By default an Event shares the Sampler of its site, which applies the configuration of its Category,
+             * see site_sampler() and sampler_for(). The new Sampler belongs to \a this alone.
+             *
+             * \param sampler The new Sampler.
+             */
+            auto set_sampler(Sampler sampler) noexcept -> void
+            {
+                m_site_sampler = nullptr;
+                m_sampler = sampler;
+            }
+
         private:
-            void* m_handle{
-                plugin::activated() ? plugin::create_event(m_color, m_category.get_c_name(), m_category.get_id())
-                                    : nullptr};
+            auto sample() noexcept -> bool
+            {
+                return (m_site_sampler != nullptr) ? m_site_sampler->sample() : m_sampler.sample();
+            }
+
+            auto handle() noexcept -> void*
+            {
+                // Filtered Events get a null handle, which must not be requested again on every firing
+                if(!m_created)
+                {
+                    m_handle
+                        = plugin::create_event(m_name.c_str(), m_color, m_category.get_c_name(), m_category.get_id());
+                    m_created = true;
+                }
+
+                return m_handle;
+            }
+
+            void* m_handle{nullptr};
+            bool m_created{false};
             std::function<std::string(void)> m_action = [this]() { return m_name; };
+            shared_sampler* m_site_sampler{site_sampler(m_name.c_str(), m_category.get_c_name())};
+            Sampler m_sampler{};
         };
     } // namespace ranges
 } // namespace bactria
@@ -198,7 +276,8 @@ namespace bactria
  *
  * A macro that internally creates an event, fires it and destroys it afterwards. If you want to customize the
  * event's behaviour you will have to manage the event's lifetime and fire operation on your own by instantiating
- * the Event class.
+ * the Event class. Every call site keeps its own Sampler per thread; unsampled firings don't create the event. The
+ * runtime control flag (see `bactria-ctl`) of the call site is looked up once, for the name passed on the first call.
  *
  * \param[in] name     The name of the event as it should later appear on the visualizer.
  * \param[in] color    The color of the event as it should later appear on the visualizer.
@@ -206,8 +285,15 @@ namespace bactria
  */
 #define bactria_Event(name, color, category)                                                                          \
     {                                                                                                                 \
-        auto e = bactria::ranges::Event(name, color, category);                                                       \
-        e.fire(__FILE__, __LINE__, __func__);                                                                         \
+        static auto const& bactria_site_flag                                                                          \
+            = bactria::control::site(std::string{name}.c_str(), (category).get_c_name());                             \
+        static thread_local auto bactria_site_sampler = bactria::ranges::sampler_for((category).get_c_name());        \
+        if(bactria::ranges::plugin::activated() && bactria::control::is_enabled(bactria_site_flag)                    \
+           && bactria_site_sampler.sample())                                                                          \
+        {                                                                                                             \
+            auto e = bactria::ranges::Event(name, color, category, bactria::ranges::Sampler{});                       \
+            e.fire(__FILE__, __LINE__, __func__);                                                                     \
+        }                                                                                                             \
     }
 
 /**
@@ -216,7 +302,7 @@ namespace bactria
  *
  * A macro that internally creates an event, assigns it an action, fires it and destroys it afterwards. If you want to
  * customize the event's behaviour you will have to manage the event's lifetime and fire operation on your own by
- * instantiating the Event class.
+ * instantiating the Event class. Every call site keeps its own Sampler per thread and its own runtime control flag.
  *
  * \param[in] action   The action generating the event name as it should later appear on the visualizer.
  * \param[in] color    The color of the event as it should later appear on the visualizer.
@@ -224,7 +310,42 @@ namespace bactria
  */
 #define bactria_ActionEvent(action, color, category)                                                                  \
     {                                                                                                                 \
-        auto e = bactria::ranges::Event("BACTRIA_ACTION_EVENT", color, category);                                     \
-        e.set_action(action);                                                                                         \
-        e.fire(__FILE__, __LINE__, __func__);                                                                         \
+        static auto const& bactria_site_flag                                                                          \
+            = bactria::control::site("BACTRIA_ACTION_EVENT", (category).get_c_name());                                \
+        static thread_local auto bactria_site_sampler = bactria::ranges::sampler_for((category).get_c_name());        \
+        if(bactria::ranges::plugin::activated() && bactria::control::is_enabled(bactria_site_flag)                    \
+           && bactria_site_sampler.sample())                                                                          \
+        {                                                                                                             \
+            auto e = bactria::ranges::Event("BACTRIA_ACTION_EVENT", color, category, bactria::ranges::Sampler{});     \
+            e.set_action(action);                                                                                     \
+            e.fire(__FILE__, __LINE__, __func__);                                                                     \
+        }                                                                                                             \
+    }
+
+/**
+ * \brief A macro that fires an event with a value.
+ * \ingroup bactria_ranges_user
+ *
+ * A macro that internally creates an event, fires it with the Payload \a value and destroys it afterwards. Every
+ * call site keeps its own Sampler per thread. The runtime control flag of the call site is looked up once, for the
+ * name passed on the first call.
+ *
+ * \param[in] name     The name of the event as it should later appear on the visualizer.
+ * \param[in] color    The color of the event as it should later appear on the visualizer.
+ * \param[in] category The Category of the event.
+ * \param[in] value    The value attached to the event. Signed and unsigned integers and floating-point numbers are
+ *                     supported.
+ * \sa Payload
+ */
+#define bactria_ValueEvent(name, color, category, value)                                                              \
+    {                                                                                                                 \
+        static auto const& bactria_site_flag                                                                          \
+            = bactria::control::site(std::string{name}.c_str(), (category).get_c_name());                             \
+        static thread_local auto bactria_site_sampler = bactria::ranges::sampler_for((category).get_c_name());        \
+        if(bactria::ranges::plugin::activated() && bactria::control::is_enabled(bactria_site_flag)                    \
+           && bactria_site_sampler.sample())                                                                          \
+        {                                                                                                             \
+            auto e = bactria::ranges::Event(name, color, category, bactria::ranges::Sampler{});                       \
+            e.fire(__FILE__, __LINE__, __func__, bactria::ranges::Payload{value});                                    \
+        }                                                                                                             \
     }
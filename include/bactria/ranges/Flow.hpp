@@ -0,0 +1,198 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+/**
+ * \file Flow.hpp
+ * \brief Flow definitions.
+ *
+ * This file contains the definition of the Flow class. It should not be included directly by the user.
+ */
+
+#pragma once
+
+#include <bactria/ranges/Category.hpp>
+#include <bactria/ranges/Colors.hpp>
+#include <bactria/ranges/Correlation.hpp>
+#include <bactria/ranges/Marker.hpp>
+#include <bactria/ranges/Plugin.hpp>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace bactria
+{
+    namespace ranges
+    {
+        /**
+         * \brief The flow class.
+         * \ingroup bactria_ranges_user
+         *
+         * A Flow links a point on a producer thread to a point on a consumer thread, for example the enqueueing of a
+         * work item and the start of its processing. The producer calls begin() and hands the flow ID over together
+         * with the work item; the consumer calls end() with the same ID. Trace back-ends render each flow instance
+         * as an arrow between the two points, aggregating back-ends report the latency between them.
+         *
+         * A single Flow describes all instances of one kind of hand-over. begin() and end() may be called
+         * concurrently from different threads on the same Flow.
+         *
+         *     auto enqueue = bactria::ranges::Flow{"enqueue"};
+         *
+         *     // Producer
+         *     auto const id = bactria::ranges::make_correlation_id();
+         *     enqueue.begin(id);
+         *     queue.push(work_item{id});
+         *
+         *     // Consumer
+         *     auto item = queue.pop();
+         *     enqueue.end(item.id);
+         *
+         * \sa make_correlation_id, AsyncRange
+         */
+        class Flow : public Marker
+        {
+        public:
+            /**
+             * \brief The default constructor.
+             *
+             * Constructs a Flow with the name \a BACTRIA_GENERIC_FLOW, the color bactria::ranges::color::bactria_cyan
+             * and the default Category.
+             */
+            Flow() : Marker("BACTRIA_GENERIC_FLOW", color::bactria_cyan, Category{})
+            {
+            }
+
+            /**
+             * \brief The constructor.
+             *
+             * Constructs a Flow with the name \a name, the color \a color and the Category \a category.
+             *
+             * \param name The name of the flow as it should be shown on the visualizer.
+             * \param color The flow's color in ARGB format. Default: bactria::ranges::color::bactria_cyan.
+             * \param category The flow's category. Default: bactria's default category.
+             */
+            Flow(std::string name, std::uint32_t color = color::bactria_cyan, Category category = Category{})
+                : Marker(std::move(name), color, std::move(category))
+            {
+            }
+
+            /**
+             * \brief The copy constructor.
+             *
+             * Constructs a new Flow with the same properties as \a other. Flow IDs begun on \a other can be ended on
+             * the copy.
+             */
+            Flow(Flow const& other) : Marker(other), m_handle{create_handle()}
+            {
+            }
+
+            /**
+             * \brief The copy assignment operator.
+             *
+             * Destroys \a this and replaces it with a new Flow with the same properties as \a rhs.
+             */
+            auto operator=(Flow const& rhs) -> Flow&
+            {
+                if(this != &rhs)
+                {
+                    if(plugin::activated())
+                        plugin::destroy_flow(m_handle);
+
+                    Marker::operator=(rhs);
+                    m_handle = create_handle();
+                }
+
+                return *this;
+            }
+
+            /**
+             * \brief The move constructor.
+             *
+             * Constructs a Flow by moving the properties of \a other into \a this. After construction \a other will
+             * be in an undefined state.
+             */
+            Flow(Flow&& other) noexcept : Marker(std::move(other)), m_handle{std::exchange(other.m_handle, nullptr)}
+            {
+            }
+
+            /**
+             * \brief The move assignment operator.
+             *
+             * Destroys \a this and moves the properties of \a rhs into \a this. After the assignment \a rhs will be in
+             * an undefined state.
+             */
+            auto operator=(Flow&& rhs) noexcept -> Flow&
+            {
+                if(plugin::activated())
+                    plugin::destroy_flow(m_handle);
+
+                Marker::operator=(std::move(rhs));
+                m_handle = std::exchange(rhs.m_handle, nullptr);
+
+                return *this;
+            }
+
+            /**
+             * \brief The destructor.
+             *
+             * Destroys the Flow. Flow instances which have begun but not ended are discarded.
+             */
+            ~Flow() override
+            {
+                if(plugin::activated())
+                    plugin::destroy_flow(m_handle);
+            }
+
+            /**
+             * \brief Begin a flow instance.
+             *
+             * Marks the producer side of the flow instance \a id. Call this on the thread that hands the work over.
+             *
+             * \param id The ID of the flow instance, usually obtained from make_correlation_id().
+             * \sa end
+             */
+            auto begin(std::uint64_t id) const noexcept -> void
+            {
+                if(plugin::activated() && is_enabled())
+                    plugin::begin_flow(m_handle, id);
+            }
+
+            /**
+             * \brief End a flow instance.
+             *
+             * Marks the consumer side of the flow instance \a id. Call this on the thread that takes the work over.
+             *
+             * \param id The ID passed to begin() on the producer side.
+             * \sa begin
+             */
+            auto end(std::uint64_t id) const noexcept -> void
+            {
+                if(plugin::activated() && is_enabled())
+                    plugin::end_flow(m_handle, id);
+            }
+
+        private:
+            auto create_handle() const noexcept -> void*
+            {
+                return plugin::activated()
+                           ? plugin::create_flow(m_name.c_str(), m_color, m_category.get_c_name(), m_category.get_id())
+                           : nullptr;
+            }
+
+            void* m_handle{create_handle()};
+        };
+    } // namespace ranges
+} // namespace bactria
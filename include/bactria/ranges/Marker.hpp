@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <bactria/core/Control.hpp>
 #include <bactria/ranges/Category.hpp>
 #include <bactria/ranges/Colors.hpp>
 
@@ -168,6 +169,19 @@ namespace bactria
             }
 
         protected:
+            /**
+             * \brief Query status.
+             *
+             * Checks whether recording has been switched off for this Marker's site at runtime (see `bactria-ctl`).
+             * This costs a single relaxed atomic load.
+             *
+             * \return true If the Marker may record.
+             */
+            auto is_enabled() const noexcept -> bool
+            {
+                return control::is_enabled(*m_site);
+            }
+
             /**
              * \brief The name assigned to the Marker.
              *
@@ -191,6 +205,14 @@ namespace bactria
              * notice.
              */
             Category m_category{};
+
+            /**
+             * \brief The runtime control flag of the Marker's name and Category.
+             *
+             * Users should not rely on this member to be stable. It may change between versions without further
+             * notice.
+             */
+            control::site_flag const* m_site{&control::site(m_name.c_str(), m_category.get_c_name())};
         };
 
         /**
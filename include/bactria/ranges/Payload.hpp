@@ -0,0 +1,176 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+/**
+ * \file Payload.hpp
+ * \brief Payload definitions.
+ *
+ * This file contains the definition of the Payload class which attaches a numeric value to Events and Ranges. It is
+ * also used by plugin developers to decode payloads. It should not be included directly by the user.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace bactria
+{
+    namespace ranges
+    {
+        /**
+         * \brief The payload types.
+         * \ingroup bactria_ranges_user
+         *
+         * The numeric values are part of the plugin interface and must not change.
+         */
+        enum class payload_type : std::uint32_t
+        {
+            none = 0u, /**< No payload. */
+            int64 = 1u, /**< A signed 64 bit integer. */
+            uint64 = 2u, /**< An unsigned 64 bit integer. */
+            float64 = 3u /**< A double precision floating-point number. */
+        };
+
+        /**
+         * \brief The payload class.
+         * \ingroup bactria_ranges_user
+         *
+         * A Payload is a typed numeric value (such as a residual norm, a byte count or a queue depth) which can be
+         * attached to a fired Event or a started Range. Signed integers are stored as int64, unsigned integers as
+         * uint64 and floating-point numbers as double. Back-ends which do not support payloads will silently ignore
+         * them.
+         *
+         * Payloads are passed to plugins as a (type, bits) pair. Plugins can reconstruct the Payload from this pair
+         * and use the typed getters.
+         *
+         * \sa Event::fire, Range::start
+         */
+        class Payload
+        {
+        public:
+            /**
+             * \brief The default constructor.
+             *
+             * Constructs an empty Payload.
+             */
+            constexpr Payload() noexcept = default;
+
+            /**
+             * \brief The integral constructor.
+             *
+             * Constructs a Payload from the integral \a value. Signed values are stored as int64, unsigned values as
+             * uint64.
+             *
+             * \param value The value of the payload.
+             */
+            template<
+                typename TIntegral,
+                std::enable_if_t<std::is_integral<TIntegral>::value && !std::is_same<TIntegral, bool>::value, int> = 0>
+            constexpr Payload(TIntegral value) noexcept
+                : m_type{std::is_signed<TIntegral>::value ? payload_type::int64 : payload_type::uint64}
+                , m_bits{std::is_signed<TIntegral>::value
+                             ? static_cast<std::uint64_t>(static_cast<std::int64_t>(value))
+                             : static_cast<std::uint64_t>(value)}
+            {
+            }
+
+            /**
+             * \brief The floating-point constructor.
+             *
+             * Constructs a Payload from the floating-point \a value. The value is stored as double.
+             *
+             * \param value The value of the payload.
+             */
+            template<typename TFloat, std::enable_if_t<std::is_floating_point<TFloat>::value, int> = 0>
+            Payload(TFloat value) noexcept : m_type{payload_type::float64}
+            {
+                auto const d = static_cast<double>(value);
+                std::memcpy(&m_bits, &d, sizeof(double));
+            }
+
+            /**
+             * \brief The raw constructor.
+             *
+             * Reconstructs a Payload from the (type, bits) pair passed to a plugin.
+             *
+             * \param type The payload type as passed to the plugin.
+             * \param bits The payload bits as passed to the plugin.
+             */
+            constexpr Payload(std::uint32_t type, std::uint64_t bits) noexcept
+                : m_type{static_cast<payload_type>(type)}
+                , m_bits{bits}
+            {
+            }
+
+            /**
+             * \brief Return the payload's type.
+             */
+            constexpr auto get_type() const noexcept -> payload_type
+            {
+                return m_type;
+            }
+
+            /**
+             * \brief Return the payload's bits as passed to the plugin.
+             */
+            constexpr auto get_bits() const noexcept -> std::uint64_t
+            {
+                return m_bits;
+            }
+
+            /**
+             * \brief Query status.
+             *
+             * \return If \a true then \a this carries a value.
+             */
+            constexpr auto has_value() const noexcept -> bool
+            {
+                return m_type != payload_type::none;
+            }
+
+            /**
+             * \brief Return the value as signed integer. Only meaningful if the type is payload_type::int64.
+             */
+            constexpr auto as_int64() const noexcept -> std::int64_t
+            {
+                return static_cast<std::int64_t>(m_bits);
+            }
+
+            /**
+             * \brief Return the value as unsigned integer. Only meaningful if the type is payload_type::uint64.
+             */
+            constexpr auto as_uint64() const noexcept -> std::uint64_t
+            {
+                return m_bits;
+            }
+
+            /**
+             * \brief Return the value as double. Only meaningful if the type is payload_type::float64.
+             */
+            auto as_double() const noexcept -> double
+            {
+                auto d = double{};
+                std::memcpy(&d, &m_bits, sizeof(double));
+                return d;
+            }
+
+        private:
+            payload_type m_type{payload_type::none};
+            std::uint64_t m_bits{0u};
+        };
+    } // namespace ranges
+} // namespace bactria
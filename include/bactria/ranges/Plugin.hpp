@@ -23,13 +23,19 @@
 #pragma once
 
 #include <bactria/core/Activation.hpp>
+#include <bactria/core/Filter.hpp>
 #include <bactria/core/Plugin.hpp>
+#include <bactria/ranges/Payload.hpp>
+#include <bactria/ranges/Span.hpp>
 
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <unordered_set>
 
 namespace bactria
 {
@@ -63,6 +69,20 @@ namespace bactria
             }
 
             /* Standard function pointer declaration style is forbidden because of noexcept */
+            /**
+             * \brief Signature for plugin function bactria_ranges_register_category().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using register_category_t = std::add_pointer_t<void(std::uint32_t, char const*) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_register_category().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto register_category_ptr = register_category_t{nullptr};
+
             /**
              * \brief Signature for plugin function bactria_ranges_create_event().
              *
@@ -96,8 +116,14 @@ namespace bactria
              *
              * Used internally by bactria during plugin initialization. Should never be used by the user.
              */
-            using fire_event_t
-                = std::add_pointer_t<void(void*, char const*, char const*, std::uint32_t, char const*) noexcept>;
+            using fire_event_t = std::add_pointer_t<void(
+                void*,
+                char const*,
+                std::uint32_t,
+                std::uint64_t,
+                char const*,
+                std::uint32_t,
+                char const*) noexcept>;
 
             /**
              * \brief Pointer to plugin function bactria_ranges_fire_event().
@@ -140,7 +166,7 @@ namespace bactria
              *
              * Used internally by bactria during plugin initialization. Should never be used by the user.
              */
-            using start_range_t = std::add_pointer_t<void(void*) noexcept>;
+            using start_range_t = std::add_pointer_t<void(void*, std::uint32_t, std::uint64_t) noexcept>;
 
             /**
              * \brief Pointer to plugin function bactria_ranges_start_range().
@@ -164,6 +190,211 @@ namespace bactria
              */
             auto stop_range_ptr = stop_range_t{nullptr};
 
+            /**
+             * \brief Signature for plugin function bactria_ranges_start_async_range().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using start_async_range_t = std::add_pointer_t<void(void*, std::uint64_t) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_start_async_range().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto start_async_range_ptr = start_async_range_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_stop_async_range().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using stop_async_range_t = std::add_pointer_t<void(void*, std::uint64_t) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_stop_async_range().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto stop_async_range_ptr = stop_async_range_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_push_range().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using push_range_t
+                = std::add_pointer_t<void(char const*, std::uint32_t, char const*, std::uint32_t) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_push_range().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto push_range_ptr = push_range_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_pop_range().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using pop_range_t = std::add_pointer_t<void() noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_pop_range().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto pop_range_ptr = pop_range_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_create_counter().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using create_counter_t
+                = std::add_pointer_t<void*(char const*, std::uint32_t, char const*, std::uint32_t) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_create_counter().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto create_counter_ptr = create_counter_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_destroy_counter().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using destroy_counter_t = std::add_pointer_t<void(void*) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_destroy_counter().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto destroy_counter_ptr = destroy_counter_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_sample_counter().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using sample_counter_t = std::add_pointer_t<void(void*, std::uint32_t, std::uint64_t) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_sample_counter().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto sample_counter_ptr = sample_counter_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_create_timeline().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using create_timeline_t = std::add_pointer_t<void*(
+                char const*,
+                char const* const*,
+                std::uint32_t,
+                std::uint32_t,
+                char const*,
+                std::uint32_t) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_create_timeline().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto create_timeline_ptr = create_timeline_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_destroy_timeline().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using destroy_timeline_t = std::add_pointer_t<void(void*) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_destroy_timeline().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto destroy_timeline_ptr = destroy_timeline_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_submit_spans().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using submit_spans_t = std::add_pointer_t<void(void*, Span const*, std::size_t) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_submit_spans().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto submit_spans_ptr = submit_spans_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_create_flow().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using create_flow_t
+                = std::add_pointer_t<void*(char const*, std::uint32_t, char const*, std::uint32_t) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_create_flow().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto create_flow_ptr = create_flow_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_destroy_flow().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using destroy_flow_t = std::add_pointer_t<void(void*) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_destroy_flow().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto destroy_flow_ptr = destroy_flow_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_begin_flow().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using begin_flow_t = std::add_pointer_t<void(void*, std::uint64_t) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_begin_flow().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto begin_flow_ptr = begin_flow_t{nullptr};
+
+            /**
+             * \brief Signature for plugin function bactria_ranges_end_flow().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            using end_flow_t = std::add_pointer_t<void(void*, std::uint64_t) noexcept>;
+
+            /**
+             * \brief Pointer to plugin function bactria_ranges_end_flow().
+             *
+             * Used internally by bactria during plugin initialization. Should never be used by the user.
+             */
+            auto end_flow_ptr = end_flow_t{nullptr};
+
             /**
              * \brief Initializes the ranges plugin.
              *
@@ -179,6 +410,8 @@ namespace bactria
                 {
                     auto handle = system::open_plugin(path);
 
+                    system::load_func(handle, register_category_ptr, "bactria_ranges_register_category");
+
                     system::load_func(handle, create_event_ptr, "bactria_ranges_create_event");
                     system::load_func(handle, destroy_event_ptr, "bactria_ranges_destroy_event");
                     system::load_func(handle, fire_event_ptr, "bactria_ranges_fire_event");
@@ -187,6 +420,23 @@ namespace bactria
                     system::load_func(handle, destroy_range_ptr, "bactria_ranges_destroy_range");
                     system::load_func(handle, start_range_ptr, "bactria_ranges_start_range");
                     system::load_func(handle, stop_range_ptr, "bactria_ranges_stop_range");
+                    system::load_func(handle, start_async_range_ptr, "bactria_ranges_start_async_range");
+                    system::load_func(handle, stop_async_range_ptr, "bactria_ranges_stop_async_range");
+                    system::load_func(handle, push_range_ptr, "bactria_ranges_push_range");
+                    system::load_func(handle, pop_range_ptr, "bactria_ranges_pop_range");
+
+                    system::load_func(handle, create_counter_ptr, "bactria_ranges_create_counter");
+                    system::load_func(handle, destroy_counter_ptr, "bactria_ranges_destroy_counter");
+                    system::load_func(handle, sample_counter_ptr, "bactria_ranges_sample_counter");
+
+                    system::load_func(handle, create_timeline_ptr, "bactria_ranges_create_timeline");
+                    system::load_func(handle, destroy_timeline_ptr, "bactria_ranges_destroy_timeline");
+                    system::load_func(handle, submit_spans_ptr, "bactria_ranges_submit_spans");
+
+                    system::load_func(handle, create_flow_ptr, "bactria_ranges_create_flow");
+                    system::load_func(handle, destroy_flow_ptr, "bactria_ranges_destroy_flow");
+                    system::load_func(handle, begin_flow_ptr, "bactria_ranges_begin_flow");
+                    system::load_func(handle, end_flow_ptr, "bactria_ranges_end_flow");
 
                     return handle;
                 }
@@ -195,6 +445,36 @@ namespace bactria
                 throw std::runtime_error{std::string{"Failed to load bactria ranges plugin "} + path};
             }
 
+            /**
+             * \brief Registers a Category with the plugin.
+             *
+             * Used internally by the Event and Range classes. Users should not call this directly. The plugin is
+             * called only once per distinct category ID; later calls with an already registered ID are cheap.
+             *
+             * \sa Category
+             */
+            inline auto register_category(std::uint32_t cat_id, char const* cat_name) noexcept
+            {
+                if(register_category_ptr == nullptr)
+                    return;
+
+                // Fast path: this thread has already seen the category
+                thread_local auto seen = std::unordered_set<std::uint32_t>{};
+                if(seen.count(cat_id) != 0u)
+                    return;
+
+                // Keep the lock during the call so no other thread uses the category before it is registered
+                static auto registered = std::unordered_set<std::uint32_t>{};
+                static std::mutex registered_mutex;
+                {
+                    std::lock_guard<std::mutex> const lock{registered_mutex};
+                    if(registered.insert(cat_id).second)
+                        (register_category_ptr)(cat_id, cat_name);
+                }
+
+                seen.insert(cat_id);
+            }
+
             /**
              * \brief Creates a plugin-specific event handle.
              *
@@ -203,11 +483,15 @@ namespace bactria
              * \sa Event::Event()
              */
             [[nodiscard, gnu::always_inline]] inline auto create_event(
+                char const* name,
                 std::uint32_t color,
                 char const* cat_name,
                 std::uint32_t cat_id) noexcept
             {
-                if(create_event_ptr != nullptr)
+                register_category(cat_id, cat_name);
+
+                // The plugin interface doesn't pass the event's name; it is only needed for filtering
+                if(create_event_ptr != nullptr && !is_filtered(name, cat_name))
                     return (create_event_ptr) (color, cat_name, cat_id);
 
                 return static_cast<void*>(nullptr);
@@ -222,7 +506,7 @@ namespace bactria
              */
             [[gnu::always_inline]] inline auto destroy_event(void* event_handle) noexcept
             {
-                if(destroy_event_ptr != nullptr)
+                if(destroy_event_ptr != nullptr && event_handle != nullptr)
                     (destroy_event_ptr)(event_handle);
             }
 
@@ -236,12 +520,20 @@ namespace bactria
             [[gnu::always_inline]] inline auto fire_event(
                 void* event_handle,
                 char const* event_name,
+                Payload const& payload,
                 char const* source,
                 std::uint32_t lineno,
                 char const* caller) noexcept
             {
-                if(fire_event_ptr != nullptr)
-                    (fire_event_ptr)(event_handle, event_name, source, lineno, caller);
+                if(fire_event_ptr != nullptr && event_handle != nullptr)
+                    (fire_event_ptr)(
+                        event_handle,
+                        event_name,
+                        static_cast<std::uint32_t>(payload.get_type()),
+                        payload.get_bits(),
+                        source,
+                        lineno,
+                        caller);
             }
 
             /**
@@ -257,7 +549,9 @@ namespace bactria
                 char const* cat_name,
                 std::uint32_t cat_id) noexcept
             {
-                if(create_range_ptr != nullptr)
+                register_category(cat_id, cat_name);
+
+                if(create_range_ptr != nullptr && !is_filtered(name, cat_name))
                     return (create_range_ptr) (name, color, cat_name, cat_id);
 
                 return static_cast<void*>(nullptr);
@@ -272,7 +566,7 @@ namespace bactria
              */
             [[gnu::always_inline]] inline auto destroy_range(void* range_handle) noexcept
             {
-                if(destroy_range_ptr != nullptr)
+                if(destroy_range_ptr != nullptr && range_handle != nullptr)
                     (destroy_range_ptr)(range_handle);
             }
 
@@ -283,10 +577,13 @@ namespace bactria
              *
              * \sa Range::start()
              */
-            [[gnu::always_inline]] inline auto start_range(void* range_handle) noexcept
+            [[gnu::always_inline]] inline auto start_range(void* range_handle, Payload const& payload) noexcept
             {
-                if(start_range_ptr != nullptr)
-                    (start_range_ptr)(range_handle);
+                if(start_range_ptr != nullptr && range_handle != nullptr)
+                    (start_range_ptr)(
+                        range_handle,
+                        static_cast<std::uint32_t>(payload.get_type()),
+                        payload.get_bits());
             }
 
             /**
@@ -298,9 +595,233 @@ namespace bactria
              */
             [[gnu::always_inline]] inline auto stop_range(void* range_handle) noexcept
             {
-                if(stop_range_ptr != nullptr)
+                if(stop_range_ptr != nullptr && range_handle != nullptr)
                     (stop_range_ptr)(range_handle);
             }
+
+            /**
+             * \brief Plugin-specific asynchronous range starting.
+             *
+             * Used internally by the AsyncRange class. Users should not call this directly.
+             *
+             * \sa AsyncRange::start()
+             */
+            [[gnu::always_inline]] inline auto start_async_range(
+                void* range_handle,
+                std::uint64_t correlation_id) noexcept
+            {
+                if(start_async_range_ptr != nullptr && range_handle != nullptr)
+                    (start_async_range_ptr)(range_handle, correlation_id);
+            }
+
+            /**
+             * \brief Plugin-specific asynchronous range stopping.
+             *
+             * Used internally by the AsyncRange class. Users should not call this directly.
+             *
+             * \sa AsyncRange::stop()
+             */
+            [[gnu::always_inline]] inline auto stop_async_range(
+                void* range_handle,
+                std::uint64_t correlation_id) noexcept
+            {
+                if(stop_async_range_ptr != nullptr && range_handle != nullptr)
+                    (stop_async_range_ptr)(range_handle, correlation_id);
+            }
+
+            /**
+             * \brief Plugin-specific range pushing.
+             *
+             * Used internally by the ScopedRange class. Users should not call this directly.
+             *
+             * \sa ScopedRange::ScopedRange()
+             */
+            [[gnu::always_inline]] inline auto push_range(
+                char const* name,
+                std::uint32_t color,
+                char const* cat_name,
+                std::uint32_t cat_id) noexcept
+            {
+                register_category(cat_id, cat_name);
+
+                if(push_range_ptr != nullptr)
+                    (push_range_ptr)(name, color, cat_name, cat_id);
+            }
+
+            /**
+             * \brief Plugin-specific range popping.
+             *
+             * Used internally by the ScopedRange class. Users should not call this directly.
+             *
+             * \sa ScopedRange::~ScopedRange()
+             */
+            [[gnu::always_inline]] inline auto pop_range() noexcept
+            {
+                if(pop_range_ptr != nullptr)
+                    (pop_range_ptr)();
+            }
+
+            /**
+             * \brief Creates a plugin-specific counter handle.
+             *
+             * Used internally by the Counter class. Users should not call this directly.
+             *
+             * \sa Counter::Counter()
+             */
+            [[nodiscard, gnu::always_inline]] inline auto create_counter(
+                char const* name,
+                std::uint32_t color,
+                char const* cat_name,
+                std::uint32_t cat_id) noexcept
+            {
+                register_category(cat_id, cat_name);
+
+                if(create_counter_ptr != nullptr && !is_filtered(name, cat_name))
+                    return (create_counter_ptr) (name, color, cat_name, cat_id);
+
+                return static_cast<void*>(nullptr);
+            }
+
+            /**
+             * \brief Destroys a plugin-specific counter handle.
+             *
+             * Used internally by the Counter class. Users should not call this directly.
+             *
+             * \sa Counter::~Counter()
+             */
+            [[gnu::always_inline]] inline auto destroy_counter(void* counter_handle) noexcept
+            {
+                if(destroy_counter_ptr != nullptr && counter_handle != nullptr)
+                    (destroy_counter_ptr)(counter_handle);
+            }
+
+            /**
+             * \brief Plugin-specific counter sampling.
+             *
+             * Used internally by the Counter class. Users should not call this directly.
+             *
+             * \sa Counter::set(), Counter::add()
+             */
+            [[gnu::always_inline]] inline auto sample_counter(void* counter_handle, Payload const& value) noexcept
+            {
+                if(sample_counter_ptr != nullptr && counter_handle != nullptr)
+                    (sample_counter_ptr)(
+                        counter_handle,
+                        static_cast<std::uint32_t>(value.get_type()),
+                        value.get_bits());
+            }
+
+            /**
+             * \brief Creates a plugin-specific timeline handle.
+             *
+             * Used internally by the Timeline class. Users should not call this directly.
+             *
+             * \sa Timeline::Timeline()
+             */
+            [[nodiscard, gnu::always_inline]] inline auto create_timeline(
+                char const* name,
+                char const* const* span_names,
+                std::uint32_t span_name_count,
+                std::uint32_t color,
+                char const* cat_name,
+                std::uint32_t cat_id) noexcept
+            {
+                register_category(cat_id, cat_name);
+
+                if(create_timeline_ptr != nullptr && !is_filtered(name, cat_name))
+                    return (create_timeline_ptr) (name, span_names, span_name_count, color, cat_name, cat_id);
+
+                return static_cast<void*>(nullptr);
+            }
+
+            /**
+             * \brief Destroys a plugin-specific timeline handle.
+             *
+             * Used internally by the Timeline class. Users should not call this directly.
+             *
+             * \sa Timeline::~Timeline()
+             */
+            [[gnu::always_inline]] inline auto destroy_timeline(void* timeline_handle) noexcept
+            {
+                if(destroy_timeline_ptr != nullptr && timeline_handle != nullptr)
+                    (destroy_timeline_ptr)(timeline_handle);
+            }
+
+            /**
+             * \brief Plugin-specific span submission.
+             *
+             * Used internally by the Timeline class. Users should not call this directly.
+             *
+             * \sa Timeline::submit()
+             */
+            [[gnu::always_inline]] inline auto submit_spans(
+                void* timeline_handle,
+                Span const* spans,
+                std::size_t count) noexcept
+            {
+                if(submit_spans_ptr != nullptr && timeline_handle != nullptr)
+                    (submit_spans_ptr)(timeline_handle, spans, count);
+            }
+
+            /**
+             * \brief Creates a plugin-specific flow handle.
+             *
+             * Used internally by the Flow class. Users should not call this directly.
+             *
+             * \sa Flow::Flow()
+             */
+            [[nodiscard, gnu::always_inline]] inline auto create_flow(
+                char const* name,
+                std::uint32_t color,
+                char const* cat_name,
+                std::uint32_t cat_id) noexcept
+            {
+                register_category(cat_id, cat_name);
+
+                if(create_flow_ptr != nullptr && !is_filtered(name, cat_name))
+                    return (create_flow_ptr) (name, color, cat_name, cat_id);
+
+                return static_cast<void*>(nullptr);
+            }
+
+            /**
+             * \brief Destroys a plugin-specific flow handle.
+             *
+             * Used internally by the Flow class. Users should not call this directly.
+             *
+             * \sa Flow::~Flow()
+             */
+            [[gnu::always_inline]] inline auto destroy_flow(void* flow_handle) noexcept
+            {
+                if(destroy_flow_ptr != nullptr && flow_handle != nullptr)
+                    (destroy_flow_ptr)(flow_handle);
+            }
+
+            /**
+             * \brief Plugin-specific flow begin.
+             *
+             * Used internally by the Flow class. Users should not call this directly.
+             *
+             * \sa Flow::begin()
+             */
+            [[gnu::always_inline]] inline auto begin_flow(void* flow_handle, std::uint64_t flow_id) noexcept
+            {
+                if(begin_flow_ptr != nullptr && flow_handle != nullptr)
+                    (begin_flow_ptr)(flow_handle, flow_id);
+            }
+
+            /**
+             * \brief Plugin-specific flow end.
+             *
+             * Used internally by the Flow class. Users should not call this directly.
+             *
+             * \sa Flow::end()
+             */
+            [[gnu::always_inline]] inline auto end_flow(void* flow_handle, std::uint64_t flow_id) noexcept
+            {
+                if(end_flow_ptr != nullptr && flow_handle != nullptr)
+                    (end_flow_ptr)(flow_handle, flow_id);
+            }
             /** \} */
         } // namespace plugin
     } // namespace ranges
@@ -23,6 +23,10 @@
 
 #pragma once
 
+#include <bactria/ranges/Payload.hpp>
+#include <bactria/ranges/Span.hpp>
+
+#include <cstddef>
 #include <cstdint>
 
 /**
@@ -31,11 +35,31 @@
  *
  * This is the interface for a ranges plugin. Plugin developers should include ranges/PluginInterface.hpp and
  * implement all functions listed here.
+ *
+ * Payloads are passed as a pair of the payload type (see bactria::ranges::payload_type) and its bits. The bits
+ * contain the value itself for integers and the object representation of the double for floating-point numbers.
+ * Plugins can decode them with bactria::ranges::Payload.
+ *
+ * String arguments are only guaranteed to be valid for the duration of the call. Plugins that need them later (for
+ * example when a range is stopped) have to keep their own copy.
  * \{
  */
 
 extern "C"
 {
+    /**
+     * \brief Register a category.
+     *
+     * This function makes a Category known to the plugin. bactria calls it exactly once per distinct category ID and
+     * before the ID is passed to any other function of the plugin. Plugins can use it to perform expensive setup
+     * (such as naming the category in the vendor API) once instead of on every marker.
+     *
+     * \param[in] cat_id The category's id.
+     * \param[in] cat_name The category's name.
+     * \sa bactria_ranges_create_event, bactria_ranges_create_range, bactria_ranges_push_range
+     */
+    auto bactria_ranges_register_category(std::uint32_t cat_id, char const* cat_name) noexcept -> void;
+
     /**
      * \brief Create an event handle.
      *
@@ -70,6 +94,8 @@ extern "C"
      *
      * \param[in,out] event_handle The event handle created by bactria_ranges_create_event().
      * \param[in] event_name The name of the event (as it should appear on the visualizer).
+     * \param[in] payload_type The type of the payload. bactria::ranges::payload_type::none if there is no payload.
+     * \param[in] payload The bits of the payload.
      * \param[in] source The event's source file location.
      * \param[in] lineno The event's source line location.
      * \param[in] caller The event's calling function.
@@ -78,6 +104,8 @@ extern "C"
     auto bactria_ranges_fire_event(
         void* event_handle,
         char const* event_name,
+        std::uint32_t payload_type,
+        std::uint64_t payload,
         char const* source,
         std::uint32_t lineno,
         char const* caller) noexcept -> void;
@@ -119,9 +147,12 @@ extern "C"
      * This function starts a plugin-specific range. It is called internally by bactria::Range::start().
      *
      * \param[in,out] range_handle The range handle created by bactria_ranges_create_range().
+     * \param[in] payload_type The type of the payload. bactria::ranges::payload_type::none if there is no payload.
+     * \param[in] payload The bits of the payload.
      * \sa bactria_ranges_create_range, bactria_ranges_destroy_range, bactria_ranges_stop_range
      */
-    auto bactria_ranges_start_range(void* range_handle) noexcept -> void;
+    auto bactria_ranges_start_range(void* range_handle, std::uint32_t payload_type, std::uint64_t payload) noexcept
+        -> void;
 
     /**
      * \brief Stop a range.
@@ -132,6 +163,213 @@ extern "C"
      * \sa bactria_ranges_create_range, bactria_ranges_destroy_range, bactria_ranges_start_range
      */
     auto bactria_ranges_stop_range(void* range_handle) noexcept -> void;
+
+    /**
+     * \brief Start an asynchronous range.
+     *
+     * This function starts a plugin-specific range that may be stopped on another thread. It is called internally by
+     * bactria::AsyncRange::start(). The range handle is created by bactria_ranges_create_range(). Plugins must not
+     * rely on thread-local state between this call and the corresponding call to bactria_ranges_stop_async_range();
+     * bactria guarantees that both calls are ordered, but not that they happen on the same thread. If the back-end
+     * distinguishes between nested per-thread spans and asynchronous / flow spans the latter should be used.
+     *
+     * \param[in,out] range_handle The range handle created by bactria_ranges_create_range().
+     * \param[in] correlation_id The 64 bit ID correlating the start and the stop of the range.
+     * \sa bactria_ranges_create_range, bactria_ranges_destroy_range, bactria_ranges_stop_async_range
+     */
+    auto bactria_ranges_start_async_range(void* range_handle, std::uint64_t correlation_id) noexcept -> void;
+
+    /**
+     * \brief Stop an asynchronous range.
+     *
+     * This function stops a plugin-specific range that was started by bactria_ranges_start_async_range(), possibly on
+     * another thread. It is called internally by bactria::AsyncRange::stop().
+     *
+     * \param[in,out] range_handle The range handle created by bactria_ranges_create_range().
+     * \param[in] correlation_id The 64 bit ID correlating the start and the stop of the range.
+     * \sa bactria_ranges_create_range, bactria_ranges_destroy_range, bactria_ranges_start_async_range
+     */
+    auto bactria_ranges_stop_async_range(void* range_handle, std::uint64_t correlation_id) noexcept -> void;
+
+    /**
+     * \brief Push a range onto the calling thread's range stack.
+     *
+     * This function starts a strictly nested range without a range handle. It is called internally by
+     * bactria::ScopedRange::ScopedRange(). Pushed ranges are always popped by bactria_ranges_pop_range() on the same
+     * thread and in reverse order, so plugins can keep them on a per-thread stack (or forward them to an equivalent
+     * vendor API).
+     *
+     * \param[in] name The name of the range (as it should appear on the visualizer).
+     * \param[in] color The color of the range (as it should appear on the visualizer).
+     * \param[in] cat_name The category's name (for filtering).
+     * \param[in] cat_id The category's id (for filtering).
+     * \sa bactria_ranges_pop_range
+     */
+    auto bactria_ranges_push_range(
+        char const* name,
+        std::uint32_t color,
+        char const* cat_name,
+        std::uint32_t cat_id) noexcept -> void;
+
+    /**
+     * \brief Pop a range from the calling thread's range stack.
+     *
+     * This function stops the range most recently pushed by the calling thread. It is called internally by
+     * bactria::ScopedRange::~ScopedRange().
+     *
+     * \sa bactria_ranges_push_range
+     */
+    auto bactria_ranges_pop_range() noexcept -> void;
+
+    /**
+     * \brief Create a counter handle.
+     *
+     * This function creates a plugin-specific counter handle. This is internally used by bactria::Counter to
+     * communicate with the plugin. Trace back-ends should render each counter as its own counter track.
+     *
+     * \param[in] name The name of the counter (as it should appear on the visualizer).
+     * \param[in] color The color of the counter (as it should appear on the visualizer).
+     * \param[in] cat_name The category's name (for filtering).
+     * \param[in] cat_id The category's id (for filtering).
+     * \return A handle to the plugin-specific counter.
+     * \sa bactria_ranges_destroy_counter, bactria_ranges_sample_counter
+     */
+    auto bactria_ranges_create_counter(
+        char const* name,
+        std::uint32_t color,
+        char const* cat_name,
+        std::uint32_t cat_id) noexcept -> void*;
+
+    /**
+     * \brief Destroy a counter handle.
+     *
+     * This function destroys a plugin-specific counter handle. It is called internally by
+     * bactria::Counter::~Counter().
+     *
+     * \param[in] counter_handle The counter handle created by bactria_ranges_create_counter().
+     * \sa bactria_ranges_create_counter, bactria_ranges_sample_counter
+     */
+    auto bactria_ranges_destroy_counter(void* counter_handle) noexcept -> void;
+
+    /**
+     * \brief Record a counter sample.
+     *
+     * This function records the current value of a counter. The plugin is expected to timestamp the sample. bactria
+     * already coalesces consecutive identical values and enforces the counter's minimum sampling interval, so the
+     * plugin can record every sample it receives.
+     *
+     * \param[in,out] counter_handle The counter handle created by bactria_ranges_create_counter().
+     * \param[in] value_type The type of the value (see bactria::ranges::payload_type).
+     * \param[in] value The bits of the value.
+     * \sa bactria_ranges_create_counter, bactria_ranges_destroy_counter
+     */
+    auto bactria_ranges_sample_counter(void* counter_handle, std::uint32_t value_type, std::uint64_t value) noexcept
+        -> void;
+
+    /**
+     * \brief Create a timeline handle.
+     *
+     * This function creates a plugin-specific timeline handle. This is internally used by bactria::Timeline to
+     * submit retroactive ranges. Plugins which can't record ranges with explicit timestamps should return a null
+     * handle; bactria then doesn't buffer any spans for the timeline.
+     *
+     * \param[in] name The name of the timeline (as it should appear on the visualizer).
+     * \param[in] span_names The names of the spans. Spans refer to them by their index.
+     * \param[in] span_name_count The number of span names.
+     * \param[in] color The color of the timeline (as it should appear on the visualizer).
+     * \param[in] cat_name The category's name (for filtering).
+     * \param[in] cat_id The category's id (for filtering).
+     * \return A handle to the plugin-specific timeline or a null handle.
+     * \sa bactria_ranges_destroy_timeline, bactria_ranges_submit_spans
+     */
+    auto bactria_ranges_create_timeline(
+        char const* name,
+        char const* const* span_names,
+        std::uint32_t span_name_count,
+        std::uint32_t color,
+        char const* cat_name,
+        std::uint32_t cat_id) noexcept -> void*;
+
+    /**
+     * \brief Destroy a timeline handle.
+     *
+     * This function destroys a plugin-specific timeline handle. It is called internally by
+     * bactria::Timeline::~Timeline().
+     *
+     * \param[in] timeline_handle The timeline handle created by bactria_ranges_create_timeline().
+     * \sa bactria_ranges_create_timeline, bactria_ranges_submit_spans
+     */
+    auto bactria_ranges_destroy_timeline(void* timeline_handle) noexcept -> void;
+
+    /**
+     * \brief Submit retroactive ranges.
+     *
+     * This function submits a batch of spans which have already happened. The timestamps are given in bactria's
+     * time base (nanoseconds of `std::chrono::steady_clock`). The spans are not necessarily sorted.
+     *
+     * \param[in,out] timeline_handle The timeline handle created by bactria_ranges_create_timeline().
+     * \param[in] spans The spans.
+     * \param[in] count The number of spans.
+     * \sa bactria_ranges_create_timeline, bactria_ranges_destroy_timeline
+     */
+    auto bactria_ranges_submit_spans(
+        void* timeline_handle,
+        bactria::ranges::Span const* spans,
+        std::size_t count) noexcept -> void;
+
+    /**
+     * \brief Create a flow handle.
+     *
+     * This function creates a plugin-specific flow handle. This is internally used by bactria::Flow to link a point
+     * on a producer thread to a point on a consumer thread.
+     *
+     * \param[in] name The name of the flow (as it should appear on the visualizer).
+     * \param[in] color The color of the flow (as it should appear on the visualizer).
+     * \param[in] cat_name The category's name (for filtering).
+     * \param[in] cat_id The category's id (for filtering).
+     * \return A handle to the plugin-specific flow.
+     * \sa bactria_ranges_destroy_flow, bactria_ranges_begin_flow, bactria_ranges_end_flow
+     */
+    auto bactria_ranges_create_flow(
+        char const* name,
+        std::uint32_t color,
+        char const* cat_name,
+        std::uint32_t cat_id) noexcept -> void*;
+
+    /**
+     * \brief Destroy a flow handle.
+     *
+     * This function destroys a plugin-specific flow handle. It is called internally by bactria::Flow::~Flow().
+     *
+     * \param[in] flow_handle The flow handle created by bactria_ranges_create_flow().
+     * \sa bactria_ranges_create_flow
+     */
+    auto bactria_ranges_destroy_flow(void* flow_handle) noexcept -> void;
+
+    /**
+     * \brief Begin a flow.
+     *
+     * This function marks the producer side of the flow instance identified by \a flow_id. The plugin is expected to
+     * timestamp the call. It may be called concurrently with bactria_ranges_end_flow() for the same handle.
+     *
+     * \param[in] flow_handle The flow handle created by bactria_ranges_create_flow().
+     * \param[in] flow_id The 64 bit ID of the flow instance.
+     * \sa bactria_ranges_end_flow
+     */
+    auto bactria_ranges_begin_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void;
+
+    /**
+     * \brief End a flow.
+     *
+     * This function marks the consumer side of the flow instance identified by \a flow_id. It is usually called on a
+     * different thread than bactria_ranges_begin_flow(). If the producer hands the work over before it calls
+     * bactria_ranges_begin_flow() the end may reach the plugin first; plugins should tolerate that.
+     *
+     * \param[in] flow_handle The flow handle created by bactria_ranges_create_flow().
+     * \param[in] flow_id The 64 bit ID of the flow instance.
+     * \sa bactria_ranges_begin_flow
+     */
+    auto bactria_ranges_end_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void;
 }
 
 /**
@@ -24,7 +24,9 @@
 
 #include <bactria/ranges/Colors.hpp>
 #include <bactria/ranges/Marker.hpp>
+#include <bactria/ranges/Payload.hpp>
 #include <bactria/ranges/Plugin.hpp>
+#include <bactria/ranges/Sampler.hpp>
 
 #include <cstdint>
 #include <string>
@@ -88,6 +90,38 @@ namespace bactria
                     start();
             }
 
+            /**
+             * \brief The constructor with a Sampler.
+             *
+             * Constructs a Range like the constructor above, but samples its runs with its own \a sampler instead of
+             * sharing the Sampler of its site (see site_sampler()). Ranges which are constructed anew for every run
+             * can't keep the sampling state themselves; they should be constructed with `Sampler{}` inside a branch on
+             * a longer-lived (e.g. `static thread_local`) Sampler:
+             *
+             *     static thread_local auto site = bactria::ranges::sampler_for(category.get_c_name());
+             *     if(site.sample())
+             *     {
+             *         auto r = bactria::ranges::Range{"Hot path", color, category, bactria::ranges::Sampler{}};
+             *         // ...
+             *     }
+             *
+             * \param name The name of the range as it should be shown on the visualizer.
+             * \param color The range's color in ARGB format as it should be shown on the visualizer.
+             * \param category The range's category.
+             * \param sampler The range's Sampler.
+             * \param autostart If \a true start the range on construction. Default: \a true.
+             *
+             * \sa Sampler, set_sampler
+             */
+            Range(std::string name, std::uint32_t color, Category category, Sampler sampler, bool autostart = true)
+                : Marker(std::move(name), color, std::move(category))
+                , m_site_sampler{nullptr}
+                , m_sampler{sampler}
+            {
+                if(autostart && plugin::activated())
+                    start();
+            }
+
             /**
              * \brief The copy constructor.
              *
@@ -99,18 +133,22 @@ namespace bactria
              * \sa ~Range, start, stop
              */
             Range(Range const& other)
-            : Marker(other), m_handle{plugin::activated() ? plugin::create_range(m_name.c_str(), m_color, m_category.get_c_name(), m_category.get_id()) : nullptr}
-            , m_started{other.m_started}
+                : Marker(other)
+                , m_started{other.m_started}
+                , m_payload{other.m_payload}
+                , m_site_sampler{other.m_site_sampler}
+                , m_sampler{other.m_sampler}
             {
                 if(m_started && plugin::activated())
-                    plugin::start_range(m_handle);
+                    plugin::start_range(handle(), m_payload);
             }
 
             /**
              * \brief The copy assignment operator.
              *
-             * Copies the properties of the \a rhs Range. If \a rhs is already started \a this will be started by the
-             * assignment. Otherwise, \a this will not be started by the assignment.
+             * Copies the properties of the \a rhs Range. If \a this is running it is stopped first. If \a rhs is
+             * already started \a this will be started by the assignment. Otherwise, \a this will not be started by the
+             * assignment.
              *
              * \param rhs The Range to copy from.
              *
@@ -118,15 +156,23 @@ namespace bactria
              */
             auto operator=(Range const& rhs) -> Range&
             {
+                if(plugin::activated())
+                {
+                    stop();
+                    plugin::destroy_range(std::exchange(m_handle, nullptr));
+                    m_created = false;
+                }
+
                 Marker::operator=(rhs);
                 if(plugin::activated())
                 {
-                    m_handle
-                        = plugin::create_range(m_name.c_str(), m_color, m_category.get_c_name(), m_category.get_id());
                     m_started = rhs.m_started;
+                    m_payload = rhs.m_payload;
+                    m_site_sampler = rhs.m_site_sampler;
+                    m_sampler = rhs.m_sampler;
 
                     if(m_started)
-                        plugin::start_range(m_handle);
+                        plugin::start_range(handle(), m_payload);
                 }
 
                 return *this;
@@ -145,15 +191,20 @@ namespace bactria
             Range(Range&& other) noexcept
                 : Marker(std::move(other))
                 , m_handle{std::exchange(other.m_handle, nullptr)}
+                , m_created{std::exchange(other.m_created, bool{})}
                 , m_started{std::exchange(other.m_started, bool{})}
+                , m_payload{other.m_payload}
+                , m_site_sampler{other.m_site_sampler}
+                , m_sampler{other.m_sampler}
             {
             }
 
             /**
              * \brief The move assignment operator.
              *
-             * Moves the properties of the \a other Range into \a this. If \a other is already started \a this will
-             * keep running. Otherwise, \a this will not be started by the assignment.
+             * Moves the properties of the \a other Range into \a this. If \a this is running it is stopped first. If
+             * \a other is already started \a this will keep running. Otherwise, \a this will not be started by the
+             * assignment.
              *
              * After the assignment \a other will be in an undefined state.
              *
@@ -161,9 +212,19 @@ namespace bactria
              */
             auto operator=(Range&& rhs) noexcept -> Range&
             {
+                if(plugin::activated())
+                {
+                    stop();
+                    plugin::destroy_range(m_handle);
+                }
+
                 Marker::operator=(std::move(rhs));
                 m_handle = std::exchange(rhs.m_handle, nullptr);
+                m_created = std::exchange(rhs.m_created, bool{});
                 m_started = std::exchange(rhs.m_started, bool{});
+                m_payload = rhs.m_payload;
+                m_site_sampler = rhs.m_site_sampler;
+                m_sampler = rhs.m_sampler;
 
                 return *this;
             }
@@ -187,13 +248,19 @@ namespace bactria
             /**
              * \brief Manual start.
              *
-             * Manually starts the Range. If \a this was already started before the method will do nothing.
+             * Manually starts the Range. If \a this was already started before the method will do nothing. An optional
+             * Payload attaches a numeric value to this run of the Range. Runs which are not sampled by the Range's
+             * Sampler are not started; the following stop() does nothing. The plugin's handle for the Range is created
+             * by the first sampled run, so a Range whose runs are never sampled doesn't reach the plugin at all.
+             *
+             * \param payload The value attached to the Range. Default: no value.
              */
-            auto start() noexcept -> void
+            auto start(Payload payload = Payload{}) noexcept -> void
             {
-                if(!m_started && plugin::activated())
+                if(!m_started && plugin::activated() && is_enabled() && sample())
                 {
-                    plugin::start_range(m_handle);
+                    m_payload = payload;
+                    plugin::start_range(handle(), m_payload);
                     m_started = true;
                 }
             }
@@ -222,12 +289,45 @@ namespace bactria
                 return m_started;
             }
 
+            /**
+             * \brief Replace the Range's Sampler.
+             *
+             * By default a Range shares the Sampler of its site, which applies the configuration of its Category, see
+             * site_sampler() and sampler_for(). The new Sampler belongs to \a this alone.
+             *
+             * \param sampler The new Sampler.
+             */
+            auto set_sampler(Sampler sampler) noexcept -> void
+            {
+                m_site_sampler = nullptr;
+                m_sampler = sampler;
+            }
+
         private:
-            void* m_handle{
-                plugin::activated()
-                    ? plugin::create_range(m_name.c_str(), m_color, m_category.get_c_name(), m_category.get_id())
-                    : nullptr};
+            auto sample() noexcept -> bool
+            {
+                return (m_site_sampler != nullptr) ? m_site_sampler->sample() : m_sampler.sample();
+            }
+
+            auto handle() noexcept -> void*
+            {
+                // Filtered Ranges get a null handle, which must not be requested again on every run
+                if(!m_created)
+                {
+                    m_handle
+                        = plugin::create_range(m_name.c_str(), m_color, m_category.get_c_name(), m_category.get_id());
+                    m_created = true;
+                }
+
+                return m_handle;
+            }
+
+            void* m_handle{nullptr};
+            bool m_created{false};
             bool m_started{false};
+            Payload m_payload{};
+            shared_sampler* m_site_sampler{site_sampler(m_name.c_str(), m_category.get_c_name())};
+            Sampler m_sampler{};
         };
     } // namespace ranges
 } // namespace bactria
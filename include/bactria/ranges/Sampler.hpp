@@ -0,0 +1,439 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+/**
+ * \file Sampler.hpp
+ * \brief Sampler definitions.
+ *
+ * This file contains the definition of the Sampler class which thins out high-frequency Ranges and Events before they
+ * reach the plugin. It should not be included directly by the user.
+ */
+
+#pragma once
+
+#include <bactria/core/Filter.hpp>
+#include <bactria/core/SiteCache.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace bactria
+{
+    namespace ranges
+    {
+        /**
+         * \brief The sampling modes.
+         * \ingroup bactria_ranges_user
+         */
+        enum class sampling_mode : std::uint32_t
+        {
+            all = 0u, /**< Every occurrence is recorded. */
+            every_nth = 1u, /**< Every Nth occurrence is recorded. */
+            interval = 2u, /**< At most one occurrence per time interval is recorded. */
+            probability = 3u /**< Every occurrence is recorded with a fixed probability. */
+        };
+
+        /**
+         * \brief Return a pseudo-random number.
+         * \ingroup bactria_ranges_user
+         *
+         * A xorshift64* generator with one state per thread. It is fast, not cryptographically secure and seeded from
+         * the address of the state and the steady clock.
+         *
+         * \return A uniformly distributed 64 bit number.
+         */
+        inline auto sampling_random() noexcept -> std::uint64_t
+        {
+            thread_local std::uint64_t state
+                = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count())
+                  ^ reinterpret_cast<std::uintptr_t>(&state) ^ 0x9e3779b97f4a7c15ull;
+
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545f4914f6cdd1dull;
+        }
+
+        /**
+         * \brief The sampler class.
+         * \ingroup bactria_ranges_user
+         *
+         * A Sampler decides which occurrences of a Range or an Event are passed on to the plugin. The decision is made
+         * in the header before any plugin call: for every Nth sampling an unsampled occurrence costs a counter
+         * increment, for probabilistic sampling a few arithmetic operations on a thread-local generator and for
+         * interval sampling a read of the steady clock.
+         *
+         * By default, all Ranges and Events with the same name and Category share the sampling state of their site,
+         * see site_sampler(), so markers which are constructed anew on every occurrence are sampled like a single
+         * one. A Sampler passed to a marker explicitly belongs to that marker alone; markers which are constructed
+         * anew on every occurrence then need a Sampler which outlives them, for example a `static thread_local` one
+         * as used by the bactria_Event macros. Samplers are not thread-safe.
+         *
+         * \sa sampler_for, Range::set_sampler, Event::set_sampler
+         */
+        class Sampler
+        {
+        public:
+            /**
+             * \brief The default constructor.
+             *
+             * Constructs a Sampler which records every occurrence.
+             */
+            Sampler() noexcept = default;
+
+            /**
+             * \brief Record every Nth occurrence, starting with the Nth one.
+             *
+             * \param n The sampling period. 0 and 1 record every occurrence.
+             */
+            static auto every(std::uint64_t n) noexcept -> Sampler
+            {
+                auto s = Sampler{};
+                if(n > 1u)
+                {
+                    s.m_mode = sampling_mode::every_nth;
+                    s.m_period = n;
+                }
+                return s;
+            }
+
+            /**
+             * \brief Record at most one occurrence per \a interval, starting with the first one.
+             *
+             * \param interval The minimum time between two recorded occurrences.
+             */
+            static auto at_most_every(std::chrono::nanoseconds interval) noexcept -> Sampler
+            {
+                auto s = Sampler{};
+                if(interval.count() > 0)
+                {
+                    s.m_mode = sampling_mode::interval;
+                    s.m_interval = interval;
+                }
+                return s;
+            }
+
+            /**
+             * \brief Record every occurrence with the probability \a p.
+             *
+             * \param p The probability. Values of 1 or more record every occurrence, values of 0 or less none.
+             */
+            static auto with_probability(double p) noexcept -> Sampler
+            {
+                auto s = Sampler{};
+                if(!(p >= 1.0))
+                {
+                    s.m_mode = sampling_mode::probability;
+                    // 2^64 * p, compared against the generator's output
+                    s.m_period = (p > 0.0) ? static_cast<std::uint64_t>(p * 18446744073709551616.0) : 0u;
+                }
+                return s;
+            }
+
+            /**
+             * \brief Decide whether the current occurrence is recorded.
+             *
+             * \return true If the occurrence should be passed on to the plugin.
+             */
+            auto sample() noexcept -> bool
+            {
+                switch(m_mode)
+                {
+                case sampling_mode::every_nth:
+                    if(++m_count != m_period)
+                        return false;
+                    m_count = 0u;
+                    return true;
+
+                case sampling_mode::interval:
+                {
+                    auto const now = std::chrono::steady_clock::now();
+                    if(m_count != 0u && now - m_last < m_interval)
+                        return false;
+                    m_last = now;
+                    m_count = 1u;
+                    return true;
+                }
+
+                case sampling_mode::probability:
+                    return sampling_random() < m_period;
+
+                default:
+                    return true;
+                }
+            }
+
+            /**
+             * \brief Return the sampling mode.
+             */
+            auto get_mode() const noexcept -> sampling_mode
+            {
+                return m_mode;
+            }
+
+        private:
+            friend class shared_sampler;
+
+            sampling_mode m_mode{sampling_mode::all};
+            // The period of every_nth or the threshold of probability
+            std::uint64_t m_period{1u};
+            // Occurrences since the last recorded one; for interval: whether anything has been recorded yet
+            std::uint64_t m_count{0u};
+            std::chrono::nanoseconds m_interval{0};
+            std::chrono::steady_clock::time_point m_last{};
+        };
+
+        /**
+         * \brief A Sampler shared by all markers of a site.
+         * \ingroup bactria_core_internal
+         *
+         * Applies the policy of a Sampler to the occurrences of all Ranges and Events with the same name and Category,
+         * on all threads. The state is kept in atomics, so an unsampled occurrence costs an atomic increment (or a
+         * clock read and an atomic load, or a random number).
+         *
+         * \sa site_sampler
+         */
+        class shared_sampler
+        {
+        public:
+            /**
+             * \brief The constructor.
+             *
+             * \param policy The Sampler whose policy is applied. Its state is not taken over.
+             */
+            explicit shared_sampler(Sampler const& policy) noexcept
+                : m_mode{policy.m_mode}
+                , m_period{policy.m_period}
+                , m_interval{policy.m_interval.count()}
+            {
+            }
+
+            /**
+             * \brief Decide whether the current occurrence is recorded.
+             *
+             * \return true If the occurrence should be passed on to the plugin.
+             */
+            auto sample() noexcept -> bool
+            {
+                switch(m_mode)
+                {
+                case sampling_mode::every_nth:
+                    return (m_count.fetch_add(1u, std::memory_order_relaxed) + 1u) % m_period == 0u;
+
+                case sampling_mode::interval:
+                {
+                    auto const now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count();
+                    auto last = m_last.load(std::memory_order_relaxed);
+                    if(last != never && now - last < m_interval)
+                        return false;
+
+                    // Of several threads seeing the interval expire only one records
+                    return m_last.compare_exchange_strong(last, now, std::memory_order_relaxed);
+                }
+
+                case sampling_mode::probability:
+                    return sampling_random() < m_period;
+
+                default:
+                    return true;
+                }
+            }
+
+        private:
+            static constexpr auto never = std::numeric_limits<std::int64_t>::min();
+
+            sampling_mode const m_mode;
+            std::uint64_t const m_period;
+            std::int64_t const m_interval;
+            std::atomic<std::uint64_t> m_count{0u};
+            std::atomic<std::int64_t> m_last{never};
+        };
+
+        /**
+         * \brief Parse a sampling policy.
+         * \ingroup bactria_ranges_user
+         *
+         * \param policy `all`, `every:<N>`, `interval:<microseconds>` or `probability:<p>`.
+         * \param sampler The parsed Sampler.
+         * \return false If \a policy is malformed. \a sampler is left unchanged in this case.
+         */
+        inline auto parse_sampler(std::string const& policy, Sampler& sampler) -> bool
+        {
+            auto const colon = policy.find(':');
+            auto const mode = policy.substr(0u, colon);
+            if(mode == "all" && colon == std::string::npos)
+            {
+                sampler = Sampler{};
+                return true;
+            }
+            if(colon == std::string::npos)
+                return false;
+
+            auto const value = policy.c_str() + colon + 1u;
+            auto end = static_cast<char*>(nullptr);
+            if(mode == "every")
+            {
+                auto const n = std::strtoull(value, &end, 10);
+                if(end != value && *end == '\0')
+                {
+                    sampler = Sampler::every(n);
+                    return true;
+                }
+            }
+            else if(mode == "interval")
+            {
+                auto const us = std::strtoll(value, &end, 10);
+                if(end != value && *end == '\0')
+                {
+                    sampler = Sampler::at_most_every(std::chrono::microseconds{us});
+                    return true;
+                }
+            }
+            else if(mode == "probability")
+            {
+                auto const p = std::strtod(value, &end);
+                if(end != value && *end == '\0')
+                {
+                    sampler = Sampler::with_probability(p);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /**
+         * \brief Return the configured Sampler for a category.
+         * \ingroup bactria_ranges_user
+         *
+         * The configuration is read once from the environment variable `BACTRIA_RANGES_SAMPLING`. It holds a
+         * comma-separated list of policies (see parse_sampler()). A policy without a prefix applies to all categories,
+         * a policy prefixed with `<glob>=` only to the categories whose names match the glob pattern. The first
+         * matching category policy wins; if none matches, the global policy applies. Example:
+         *
+         *     BACTRIA_RANGES_SAMPLING="every:100,io*=interval:1000,BACTRIA_GENERIC_CATEGORY=all"
+         *
+         * Malformed policies are ignored. Without configuration every occurrence is recorded.
+         *
+         * \param cat_name The name of the category.
+         * \return A Sampler with the category's policy and a fresh state.
+         */
+        inline auto sampler_for(char const* cat_name) -> Sampler
+        {
+            struct configuration
+            {
+                Sampler global{};
+                std::vector<std::pair<std::string, Sampler>> categories{};
+            };
+
+            static auto const config = []() {
+                auto c = configuration{};
+                auto const env = std::getenv("BACTRIA_RANGES_SAMPLING");
+                if(env == nullptr)
+                    return c;
+
+                auto const list = std::string{env};
+                auto begin = std::string::size_type{0u};
+                while(begin <= list.size())
+                {
+                    auto end = list.find(',', begin);
+                    if(end == std::string::npos)
+                        end = list.size();
+
+                    auto const entry = list.substr(begin, end - begin);
+                    auto const equals = entry.find('=');
+                    auto sampler = Sampler{};
+                    if(equals == std::string::npos)
+                    {
+                        if(parse_sampler(entry, sampler))
+                            c.global = sampler;
+                    }
+                    else if(parse_sampler(entry.substr(equals + 1u), sampler))
+                        c.categories.emplace_back(entry.substr(0u, equals), sampler);
+
+                    begin = end + 1u;
+                }
+
+                return c;
+            }();
+
+            for(auto const& category : config.categories)
+            {
+                if(glob_match(category.first.c_str(), cat_name))
+                    return category.second;
+            }
+
+            return config.global;
+        }
+
+        /**
+         * \brief Return the shared Sampler of a site.
+         * \ingroup bactria_core_internal
+         *
+         * Called once when a Range or an Event is constructed. All markers with the same name and Category share the
+         * returned Sampler, which applies the configuration of the Category, see sampler_for(). If sampling is not
+         * configured this function returns immediately. Otherwise every thread remembers the sites it has looked up
+         * before, so repeated lookups of a site neither lock nor allocate.
+         *
+         * \param name The marker's name.
+         * \param cat_name The name of the marker's category.
+         * \return The site's Sampler or `nullptr` if the Category records every occurrence.
+         */
+        inline auto site_sampler(char const* name, char const* cat_name) -> shared_sampler*
+        {
+            static auto const configured = std::getenv("BACTRIA_RANGES_SAMPLING") != nullptr;
+            if(!configured)
+                return nullptr;
+
+            thread_local auto cache = site_cache<shared_sampler*>{};
+            auto cached = static_cast<shared_sampler*>(nullptr);
+            if(cache.find(name, cat_name, cached))
+                return cached;
+
+            auto site = static_cast<shared_sampler*>(nullptr);
+            auto const policy = sampler_for(cat_name);
+            if(policy.get_mode() != sampling_mode::all)
+            {
+                static std::mutex mutex;
+                static std::unordered_map<std::string, std::unique_ptr<shared_sampler>> sites;
+
+                auto key = std::string{cat_name};
+                key += '\0';
+                key += name;
+
+                std::lock_guard<std::mutex> const lock{mutex};
+                auto& entry = sites[std::move(key)];
+                if(entry == nullptr)
+                    entry.reset(new shared_sampler{policy});
+
+                site = entry.get();
+            }
+
+            cache.insert(name, cat_name, site);
+            return site;
+        }
+    } // namespace ranges
+} // namespace bactria
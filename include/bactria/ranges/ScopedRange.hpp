@@ -0,0 +1,236 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+/**
+ * \file ScopedRange.hpp
+ * \brief ScopedRange definitions.
+ *
+ * This file contains the definition of the ScopedRange class. It should not be included directly by the user.
+ */
+
+#pragma once
+
+#include <bactria/core/Control.hpp>
+#include <bactria/ranges/Category.hpp>
+#include <bactria/ranges/Colors.hpp>
+#include <bactria/ranges/Plugin.hpp>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace bactria
+{
+    namespace ranges
+    {
+        /**
+         * \brief The scoped range class.
+         * \ingroup bactria_ranges_user
+         *
+         * A ScopedRange is a lightweight alternative to Range for time spans that are strictly nested on a single
+         * thread. It is pushed onto the calling thread's range stack on construction and popped on destruction. In
+         * contrast to Range no plugin-specific handle is created or destroyed and no name is stored, which makes
+         * ScopedRange suitable for frequently executed code.
+         *
+         * ScopedRanges must be destroyed on the thread that created them and in reverse order of construction. Use
+         * Range or AsyncRange for time spans that overlap freely or cross threads.
+         *
+         * \sa Range, AsyncRange, bactria_Range
+         */
+        class ScopedRange
+        {
+        public:
+            /**
+             * \brief The constructor.
+             *
+             * Constructs a ScopedRange with the name \a name, the color \a color and the Category \a category and
+             * pushes it onto the calling thread's range stack. ScopedRanges have no plugin handle, so the name and
+             * category filters (see is_filtered()) and the runtime control site are resolved on every construction;
+             * filtered ScopedRanges are never pushed. #bactria_Range resolves them only once per call site.
+             *
+             * \param name The name of the range as it should be shown on the visualizer.
+             * \param color The range's color in ARGB format as it should be shown on the visualizer.
+             *              Default: bactria::ranges::color::bactria_cyan.
+             * \param category The range's category. Default: bactria's default category.
+             *
+             * \sa ~ScopedRange, Category
+             */
+            ScopedRange(
+                char const* name,
+                std::uint32_t color = color::bactria_cyan,
+                Category const& category = default_category())
+                : ScopedRange(name, color, category, resolve_site(name, category))
+            {
+            }
+
+            /**
+             * \brief The constructor.
+             *
+             * \overload
+             */
+            ScopedRange(
+                std::string const& name,
+                std::uint32_t color = color::bactria_cyan,
+                Category const& category = default_category())
+                : ScopedRange(name.c_str(), color, category)
+            {
+            }
+
+            /**
+             * \brief The constructor.
+             *
+             * Constructs a ScopedRange for a call site that has already been resolved by resolve_site().
+             * #bactria_Range uses this constructor to resolve every call site only once.
+             *
+             * \param name The name of the range as it should be shown on the visualizer.
+             * \param color The range's color in ARGB format as it should be shown on the visualizer.
+             * \param category The range's category.
+             * \param site The result of resolve_site() for \a name and \a category. ScopedRanges without a site are
+             *             never pushed.
+             */
+            ScopedRange(
+                char const* name,
+                std::uint32_t color,
+                Category const& category,
+                control::site_flag const* site) noexcept
+            {
+                if(site != nullptr && control::is_enabled(*site))
+                {
+                    plugin::push_range(name, color, category.get_c_name(), category.get_id());
+                    m_pushed = true;
+                }
+            }
+
+            /**
+             * \brief The constructor.
+             *
+             * \overload
+             */
+            ScopedRange(
+                std::string const& name,
+                std::uint32_t color,
+                Category const& category,
+                control::site_flag const* site) noexcept
+                : ScopedRange(name.c_str(), color, category, site)
+            {
+            }
+
+            /**
+             * \brief Resolves a call site.
+             *
+             * Checks the name and category filters and looks up the runtime control flag of the site. This may
+             * allocate when the site is seen for the first time.
+             *
+             * \param name The name of the range.
+             * \param category The range's category.
+             * \return The site's runtime control flag or `nullptr` if the plugin is not activated or the range has
+             *         been filtered out.
+             */
+            static auto resolve_site(char const* name, Category const& category) -> control::site_flag const*
+            {
+                if(!plugin::activated() || is_filtered(name, category.get_c_name()))
+                    return nullptr;
+
+                return &control::site(name, category.get_c_name());
+            }
+
+            /**
+             * \brief Resolves a call site.
+             *
+             * \overload
+             */
+            static auto resolve_site(std::string const& name, Category const& category) -> control::site_flag const*
+            {
+                return resolve_site(name.c_str(), category);
+            }
+
+            /**
+             * \brief The copy constructor (deleted).
+             *
+             * A pushed range can only be popped once. Thus, the copy constructor is deleted.
+             */
+            ScopedRange(ScopedRange const&) = delete;
+
+            /**
+             * \brief The copy assignment operator (deleted).
+             *
+             * A pushed range can only be popped once. Thus, the copy assignment operator is deleted.
+             */
+            auto operator=(ScopedRange const&) -> ScopedRange& = delete;
+
+            /**
+             * \brief The move constructor.
+             *
+             * Transfers the responsibility for popping the range from \a other to \a this. \a this must be destroyed
+             * on the same thread and at the same nesting level as \a other would have been.
+             */
+            ScopedRange(ScopedRange&& other) noexcept : m_pushed{std::exchange(other.m_pushed, false)}
+            {
+            }
+
+            /**
+             * \brief The move assignment operator (deleted).
+             *
+             * Assigning would pop a range out of order. Thus, the move assignment operator is deleted.
+             */
+            auto operator=(ScopedRange&&) -> ScopedRange& = delete;
+
+            /**
+             * \brief The destructor.
+             *
+             * Pops the range from the calling thread's range stack.
+             */
+            ~ScopedRange()
+            {
+                if(m_pushed)
+                    plugin::pop_range();
+            }
+
+        private:
+            // The default argument would otherwise construct (and allocate) a new Category on every construction
+            static auto default_category() -> Category const&
+            {
+                static Category const category{};
+                return category;
+            }
+
+            bool m_pushed{false};
+        };
+    } // namespace ranges
+} // namespace bactria
+
+/**
+ * \brief A macro that creates a ScopedRange.
+ * \ingroup bactria_ranges_user
+ *
+ * A macro that creates a ScopedRange which is pushed immediately and popped at the end of the enclosing scope when
+ * it is bound to a variable:
+ *
+ *     auto r = bactria_Range("Hot loop", bactria::ranges::color::red, bactria::ranges::Category{});
+ *
+ * The name and category filters and the runtime control site are resolved only once per call site, so the name and
+ * category must not change between executions of the same call site.
+ *
+ * \param[in] name     The name of the range as it should later appear on the visualizer.
+ * \param[in] color    The color of the range as it should later appear on the visualizer.
+ * \param[in] category The Category of the range.
+ * \sa ScopedRange
+ */
+#define bactria_Range(name, color, category)                                                                          \
+    [&]() -> ::bactria::ranges::ScopedRange                                                                           \
+    {                                                                                                                 \
+        static auto const bactria_site = ::bactria::ranges::ScopedRange::resolve_site(name, category);                \
+        return ::bactria::ranges::ScopedRange{name, color, category, bactria_site};                                   \
+    }()
@@ -0,0 +1,57 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+/**
+ * \file Span.hpp
+ * \brief Span definitions.
+ *
+ * This file contains the definition of the Span record which is used for submitting retroactive ranges to plugins.
+ * It should not be included directly by the user.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+namespace bactria
+{
+    namespace ranges
+    {
+        /**
+         * \brief A retroactive range record.
+         * \ingroup bactria_ranges_user
+         *
+         * A Span describes a time span which has already happened. The timestamps are given in bactria's time base
+         * (nanoseconds of `std::chrono::steady_clock`) once they are passed to the plugin; Timeline converts them
+         * from the user's clock domain before submission.
+         *
+         * The layout is part of the plugin interface and must not change.
+         *
+         * \sa Timeline, ClockDomain
+         */
+        struct Span
+        {
+            std::uint32_t name_id; /**< Index into the span names of the Timeline. */
+            std::uint32_t track; /**< User-defined track (e.g. a device stream or a worker thread). */
+            std::int64_t start; /**< Start timestamp. */
+            std::int64_t end; /**< End timestamp. */
+        };
+
+        static_assert(std::is_standard_layout<Span>::value, "Span must be passable to plugins");
+        static_assert(std::is_trivially_copyable<Span>::value, "Span must be passable to plugins");
+    } // namespace ranges
+} // namespace bactria
@@ -0,0 +1,244 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+/**
+ * \file Timeline.hpp
+ * \brief Timeline definitions.
+ *
+ * This file contains the definition of the Timeline class. It should not be included directly by the user.
+ */
+
+#pragma once
+
+#include <bactria/ranges/Category.hpp>
+#include <bactria/ranges/ClockDomain.hpp>
+#include <bactria/ranges/Colors.hpp>
+#include <bactria/ranges/Marker.hpp>
+#include <bactria/ranges/Plugin.hpp>
+#include <bactria/ranges/Span.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bactria
+{
+    namespace ranges
+    {
+        /**
+         * \brief The timeline class.
+         * \ingroup bactria_ranges_user
+         *
+         * A Timeline collects retroactive ranges: time spans which have been measured elsewhere, for example device
+         * timestamps read back in bulk, simulation logs or timings collected in a hot loop. In contrast to Range,
+         * the start and end of a span are given explicitly.
+         *
+         * Spans are recorded as `{name ID, start, end, track}` records, where the name ID indexes the span names
+         * passed to the constructor and the track is a user-defined number (such as a device stream or a worker
+         * thread). Recording only appends to a buffer. The buffer is converted from the Timeline's ClockDomain into
+         * bactria's time base and handed to the plugin in a single call when it is full, when submit() is called or
+         * when the Timeline is destroyed.
+         *
+         * Timelines are not thread-safe. Use one Timeline per thread or synchronize the accesses.
+         *
+         * \sa Span, ClockDomain, Range
+         */
+        class Timeline : public Marker
+        {
+        public:
+            /**
+             * \brief The constructor.
+             *
+             * \param name The name of the timeline as it should be shown on the visualizer.
+             * \param span_names The names of the spans. Spans refer to them by their index.
+             * \param color The timeline's color in ARGB format. Default: bactria::ranges::color::bactria_blue.
+             * \param category The timeline's category. Default: bactria's default category.
+             * \param clock The clock domain of the recorded timestamps. Default: bactria's time base.
+             * \param batch_size The number of spans which are buffered before they are submitted. Default: 4096.
+             */
+            Timeline(
+                std::string name,
+                std::vector<std::string> span_names,
+                std::uint32_t color = color::bactria_blue,
+                Category category = Category{},
+                ClockDomain clock = ClockDomain{},
+                std::size_t batch_size = 4096u)
+                : Marker(std::move(name), color, std::move(category))
+                , m_span_names{std::move(span_names)}
+                , m_clock{clock}
+                , m_batch_size{batch_size > 0u ? batch_size : 1u}
+            {
+                if(plugin::activated())
+                {
+                    auto c_names = std::vector<char const*>{};
+                    c_names.reserve(m_span_names.size());
+                    for(auto const& n : m_span_names)
+                        c_names.push_back(n.c_str());
+
+                    m_handle = plugin::create_timeline(
+                        m_name.c_str(),
+                        c_names.data(),
+                        static_cast<std::uint32_t>(c_names.size()),
+                        m_color,
+                        m_category.get_c_name(),
+                        m_category.get_id());
+
+                    m_spans.reserve(m_batch_size);
+                }
+            }
+
+            /**
+             * \brief The copy constructor (deleted).
+             *
+             * Two Timelines would submit to the same tracks. Thus, the copy constructor is deleted.
+             */
+            Timeline(Timeline const&) = delete;
+
+            /**
+             * \brief The copy assignment operator (deleted).
+             *
+             * Two Timelines would submit to the same tracks. Thus, the copy assignment operator is deleted.
+             */
+            auto operator=(Timeline const&) -> Timeline& = delete;
+
+            /**
+             * \brief The move constructor.
+             *
+             * Moves the properties and the buffered spans of \a other into \a this. After construction \a other will
+             * be in an undefined state.
+             */
+            Timeline(Timeline&& other) noexcept
+                : Marker(std::move(other))
+                , m_span_names{std::move(other.m_span_names)}
+                , m_clock{other.m_clock}
+                , m_batch_size{other.m_batch_size}
+                , m_spans{std::move(other.m_spans)}
+                , m_handle{std::exchange(other.m_handle, nullptr)}
+            {
+            }
+
+            /**
+             * \brief The move assignment operator.
+             *
+             * Submits the buffered spans of \a this and moves the properties and the buffered spans of \a rhs into
+             * \a this. After the assignment \a rhs will be in an undefined state.
+             */
+            auto operator=(Timeline&& rhs) noexcept -> Timeline&
+            {
+                if(plugin::activated())
+                {
+                    submit();
+                    plugin::destroy_timeline(m_handle);
+                }
+
+                Marker::operator=(std::move(rhs));
+                m_span_names = std::move(rhs.m_span_names);
+                m_clock = rhs.m_clock;
+                m_batch_size = rhs.m_batch_size;
+                m_spans = std::move(rhs.m_spans);
+                m_handle = std::exchange(rhs.m_handle, nullptr);
+
+                return *this;
+            }
+
+            /**
+             * \brief The destructor.
+             *
+             * Submits the buffered spans and destroys the Timeline.
+             */
+            ~Timeline() override
+            {
+                if(plugin::activated())
+                {
+                    submit();
+                    plugin::destroy_timeline(m_handle);
+                }
+            }
+
+            /**
+             * \brief Record a span.
+             *
+             * \param name_id The index of the span's name.
+             * \param start The start timestamp in the Timeline's clock domain.
+             * \param end The end timestamp in the Timeline's clock domain.
+             * \param track The track of the span. Default: 0.
+             */
+            auto record(std::uint32_t name_id, std::uint64_t start, std::uint64_t end, std::uint32_t track = 0u)
+                -> void
+            {
+                if(m_handle == nullptr || !is_enabled())
+                    return;
+
+                // The timestamps are converted into bactria's time base on submission
+                m_spans.push_back(
+                    Span{name_id, track, static_cast<std::int64_t>(start), static_cast<std::int64_t>(end)});
+                if(m_spans.size() >= m_batch_size)
+                    submit();
+            }
+
+            /**
+             * \brief Record many spans at once.
+             *
+             * \param spans The spans. Their timestamps are given in the Timeline's clock domain.
+             * \param count The number of spans.
+             */
+            auto record(Span const* spans, std::size_t count) -> void
+            {
+                if(m_handle == nullptr || !is_enabled())
+                    return;
+
+                m_spans.insert(m_spans.end(), spans, spans + count);
+                if(m_spans.size() >= m_batch_size)
+                    submit();
+            }
+
+            /**
+             * \brief Submit the buffered spans to the plugin.
+             */
+            auto submit() noexcept -> void
+            {
+                if(m_handle == nullptr || m_spans.empty())
+                    return;
+
+                for(auto& s : m_spans)
+                {
+                    s.start = m_clock.to_time_base(static_cast<std::uint64_t>(s.start));
+                    s.end = m_clock.to_time_base(static_cast<std::uint64_t>(s.end));
+                }
+
+                plugin::submit_spans(m_handle, m_spans.data(), m_spans.size());
+                m_spans.clear();
+            }
+
+            /**
+             * \brief Return the Timeline's clock domain.
+             */
+            auto get_clock_domain() const noexcept -> ClockDomain const&
+            {
+                return m_clock;
+            }
+
+        private:
+            std::vector<std::string> m_span_names;
+            ClockDomain m_clock;
+            std::size_t m_batch_size;
+            std::vector<Span> m_spans{};
+            void* m_handle{nullptr};
+        };
+    } // namespace ranges
+} // namespace bactria
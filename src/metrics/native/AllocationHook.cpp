@@ -0,0 +1,159 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+#include "Allocations.hpp"
+
+#include <malloc.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+/* The allocation hook of the native metrics plugin. Preload it (LD_PRELOAD=libbactria_alloc.so) or link it into the
+ * application to replace malloc and friends with thin wrappers around glibc's implementation. The wrappers only update
+ * a thread-local allocation_stats, so they neither lock nor allocate; the plugin reads the statistics at every
+ * enter and leave and attributes the deltas to the innermost sector or phase. */
+
+extern "C"
+{
+    // glibc's allocator. Calling it directly avoids resolving the next malloc with dlsym(), which allocates itself.
+    auto __libc_malloc(std::size_t size) -> void*;
+    auto __libc_free(void* ptr) -> void;
+    auto __libc_calloc(std::size_t count, std::size_t size) -> void*;
+    auto __libc_realloc(void* ptr, std::size_t size) -> void*;
+    auto __libc_memalign(std::size_t alignment, std::size_t size) -> void*;
+    auto __libc_valloc(std::size_t size) -> void*;
+    auto __libc_pvalloc(std::size_t size) -> void*;
+}
+
+namespace
+{
+    // Constant-initialized in the static TLS block, so no allocation happens on the first access of a thread
+    [[gnu::tls_model("initial-exec")]] thread_local bactria::metrics::native::allocation_stats stats{};
+
+    auto count_allocation(void* ptr) noexcept -> void
+    {
+        if(ptr == nullptr || stats.paused != 0u)
+            return;
+
+        auto const size = malloc_usable_size(ptr);
+        ++stats.allocations;
+        stats.allocated_bytes += size;
+        stats.live_bytes += static_cast<std::int64_t>(size);
+        if(stats.live_bytes > stats.peak_bytes)
+            stats.peak_bytes = stats.live_bytes;
+    }
+
+    auto count_free(std::size_t size) noexcept -> void
+    {
+        if(stats.paused != 0u)
+            return;
+
+        ++stats.frees;
+        stats.freed_bytes += size;
+        stats.live_bytes -= static_cast<std::int64_t>(size);
+    }
+
+    auto is_valid_alignment(std::size_t alignment) noexcept -> bool
+    {
+        return alignment != 0u && (alignment & (alignment - 1u)) == 0u && alignment % sizeof(void*) == 0u;
+    }
+} // namespace
+
+extern "C"
+{
+    auto bactria_alloc_thread_stats() noexcept -> bactria::metrics::native::allocation_stats*
+    {
+        return &stats;
+    }
+
+    auto malloc(std::size_t size) noexcept -> void*
+    {
+        auto const ptr = __libc_malloc(size);
+        count_allocation(ptr);
+        return ptr;
+    }
+
+    auto free(void* ptr) noexcept -> void
+    {
+        if(ptr == nullptr)
+            return;
+
+        count_free(malloc_usable_size(ptr));
+        __libc_free(ptr);
+    }
+
+    auto calloc(std::size_t count, std::size_t size) noexcept -> void*
+    {
+        auto const ptr = __libc_calloc(count, size);
+        count_allocation(ptr);
+        return ptr;
+    }
+
+    auto realloc(void* ptr, std::size_t size) noexcept -> void*
+    {
+        auto const old_size = (ptr != nullptr) ? malloc_usable_size(ptr) : std::size_t{0u};
+        auto const new_ptr = __libc_realloc(ptr, size);
+
+        // On failure the old block stays valid, unless it was freed by realloc(ptr, 0)
+        if(ptr != nullptr && (new_ptr != nullptr || size == 0u))
+            count_free(old_size);
+        count_allocation(new_ptr);
+        return new_ptr;
+    }
+
+    auto posix_memalign(void** memptr, std::size_t alignment, std::size_t size) noexcept -> int
+    {
+        if(!is_valid_alignment(alignment))
+            return EINVAL;
+
+        auto const ptr = __libc_memalign(alignment, size);
+        if(ptr == nullptr)
+            return ENOMEM;
+
+        count_allocation(ptr);
+        *memptr = ptr;
+        return 0;
+    }
+
+    auto aligned_alloc(std::size_t alignment, std::size_t size) noexcept -> void*
+    {
+        auto const ptr = __libc_memalign(alignment, size);
+        count_allocation(ptr);
+        return ptr;
+    }
+
+    auto memalign(std::size_t alignment, std::size_t size) noexcept -> void*
+    {
+        auto const ptr = __libc_memalign(alignment, size);
+        count_allocation(ptr);
+        return ptr;
+    }
+
+    auto valloc(std::size_t size) noexcept -> void*
+    {
+        auto const ptr = __libc_valloc(size);
+        count_allocation(ptr);
+        return ptr;
+    }
+
+    auto pvalloc(std::size_t size) noexcept -> void*
+    {
+        auto const ptr = __libc_pvalloc(size);
+        count_allocation(ptr);
+        return ptr;
+    }
+}
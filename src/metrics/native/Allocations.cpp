@@ -0,0 +1,45 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+#include "Allocations.hpp"
+
+#include <dlfcn.h>
+
+namespace
+{
+    using stats_func_t = bactria::metrics::native::allocation_stats* (*) () noexcept;
+
+    auto stats_func() noexcept -> stats_func_t
+    {
+        // The hook has to be loaded before the plugin, so it is either there now or never
+        static auto const func = reinterpret_cast<stats_func_t>(dlsym(RTLD_DEFAULT, "bactria_alloc_thread_stats"));
+        return func;
+    }
+} // namespace
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            auto thread_allocation_stats() noexcept -> allocation_stats*
+            {
+                auto const func = stats_func();
+                return (func != nullptr) ? func() : nullptr;
+            }
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
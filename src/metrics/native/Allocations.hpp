@@ -0,0 +1,73 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            /* The per-thread heap statistics kept by the allocation hook (libbactria_alloc.so). The hook exports
+             * them as
+             *
+             *     extern "C" auto bactria_alloc_thread_stats() noexcept -> allocation_stats*;
+             *
+             * so this struct is shared between two libraries and must only be extended at the end. Sizes are the
+             * usable sizes reported by malloc_usable_size(). */
+            struct allocation_stats
+            {
+                std::uint64_t allocations;
+                std::uint64_t frees;
+                std::uint64_t allocated_bytes;
+                std::uint64_t freed_bytes;
+                // Memory freed by other threads makes these negative
+                std::int64_t live_bytes;
+                std::int64_t peak_bytes;
+                // Allocations are not counted while this is non-zero
+                std::uint32_t paused;
+            };
+
+            // The calling thread's statistics, or nullptr if the hook isn't loaded
+            auto thread_allocation_stats() noexcept -> allocation_stats*;
+
+            // Hides the plugin's own bookkeeping from the statistics
+            class allocation_guard
+            {
+            public:
+                allocation_guard() noexcept : m_stats{thread_allocation_stats()}
+                {
+                    if(m_stats != nullptr)
+                        ++m_stats->paused;
+                }
+
+                allocation_guard(allocation_guard const&) = delete;
+                auto operator=(allocation_guard const&) -> allocation_guard& = delete;
+
+                ~allocation_guard()
+                {
+                    if(m_stats != nullptr)
+                        --m_stats->paused;
+                }
+
+            private:
+                allocation_stats* m_stats;
+            };
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
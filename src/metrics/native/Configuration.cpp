@@ -0,0 +1,274 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#include "Configuration.hpp"
+
+#include <toml.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    auto from_env(char const* env, bool) -> bool
+    {
+        return (std::strcmp(env, "true") == 0) || (std::strcmp(env, "TRUE") == 0) || (std::strcmp(env, "1") == 0);
+    }
+
+    auto from_env(char const* env, std::int64_t) -> std::int64_t
+    {
+        return std::strtoll(env, nullptr, 10);
+    }
+
+    auto from_env(char const* env, double) -> double
+    {
+        return std::strtod(env, nullptr);
+    }
+
+    auto from_env(char const* env, std::string const&) -> std::string
+    {
+        return std::string{env};
+    }
+
+    // Lists are comma-separated, like Score-P's list variables
+    auto from_env(char const* env, std::vector<std::string> const&) -> std::vector<std::string>
+    {
+        auto list = std::vector<std::string>{};
+        auto const str = std::string{env};
+        auto begin = std::string::size_type{0u};
+        while(begin <= str.size())
+        {
+            auto end = str.find(',', begin);
+            if(end == std::string::npos)
+                end = str.size();
+
+            if(end > begin)
+                list.emplace_back(str.substr(begin, end - begin));
+
+            begin = end + 1u;
+        }
+
+        return list;
+    }
+
+    template<typename T>
+    auto get(toml::value const& section, char const* table, char const* key, char const* env_var, T const& fallback)
+        -> T
+    {
+        auto const env = std::getenv(env_var);
+        if(env != nullptr)
+            return from_env(env, fallback);
+
+        try
+        {
+            auto const empty = toml::value{};
+            auto const& sub = toml::find_or(section, table, empty);
+            return toml::find_or(sub, key, fallback);
+        }
+        catch(toml::type_error const& err)
+        {
+            std::cerr << err.what() << std::endl;
+            std::cerr << "WARNING: Ignoring metrics.native." << table << '.' << key << " in your configuration."
+                      << std::endl;
+            return fallback;
+        }
+    }
+
+    auto load_section() -> toml::value
+    {
+        // Most users won't have a configuration file for the native plugin. That's fine.
+        if(!std::ifstream{"bactriaConfig.toml"}.good())
+            return toml::value{};
+
+        try
+        {
+            auto const config_file = toml::parse("bactriaConfig.toml");
+            auto const metrics = toml::find(config_file, "metrics");
+            return toml::find(metrics, "native");
+        }
+        catch(std::out_of_range const&)
+        {
+            // No [metrics.native] section
+        }
+        catch(toml::syntax_error const& err)
+        {
+            std::cerr << err.what() << std::endl;
+            std::cerr << "WARNING: Your native metrics configuration will be ignored." << std::endl;
+        }
+        catch(std::runtime_error const& err)
+        {
+            std::cerr << err.what() << std::endl;
+            std::cerr << "WARNING: Your native metrics configuration will be ignored." << std::endl;
+        }
+
+        return toml::value{};
+    }
+
+    // The sketch's bucket width is undefined outside of (0, 1)
+    auto validate_accuracy(char const* table, double& accuracy) -> void
+    {
+        if(!(accuracy > 0.0 && accuracy < 1.0))
+        {
+            std::cerr << "WARNING: metrics.native." << table << ".relative_accuracy must be in (0, 1). Using 0.01."
+                      << std::endl;
+            accuracy = 0.01;
+        }
+    }
+
+    auto load() -> bactria::metrics::native::configuration
+    {
+        auto const section = load_section();
+        auto config = bactria::metrics::native::configuration{};
+
+        config.profile_enable
+            = get(section, "profile", "enable", "BACTRIA_NATIVE_PROFILE_ENABLE", config.profile_enable);
+        config.profile_base_name
+            = get(section, "profile", "base_name", "BACTRIA_NATIVE_PROFILE_BASE_NAME", config.profile_base_name);
+
+        config.summary_enable
+            = get(section, "summary", "enable", "BACTRIA_NATIVE_SUMMARY_ENABLE", config.summary_enable);
+        config.summary_file = get(section, "summary", "file", "BACTRIA_NATIVE_SUMMARY_FILE", config.summary_file);
+        config.summary_relative_accuracy = get(
+            section,
+            "summary",
+            "relative_accuracy",
+            "BACTRIA_NATIVE_SUMMARY_RELATIVE_ACCURACY",
+            config.summary_relative_accuracy);
+
+        config.sketch_enable = get(section, "sketch", "enable", "BACTRIA_NATIVE_SKETCH_ENABLE", config.sketch_enable);
+        config.sketch_relative_accuracy = get(
+            section,
+            "sketch",
+            "relative_accuracy",
+            "BACTRIA_NATIVE_SKETCH_RELATIVE_ACCURACY",
+            config.sketch_relative_accuracy);
+
+        config.perf_enable = get(section, "perf", "enable", "BACTRIA_NATIVE_PERF_ENABLE", config.perf_enable);
+        config.perf_thread_counters = get(
+            section,
+            "perf",
+            "thread_counters",
+            "BACTRIA_NATIVE_PERF_THREAD_COUNTERS",
+            config.perf_thread_counters);
+
+        config.rusage_thread_counters = get(
+            section,
+            "rusage",
+            "thread_counters",
+            "BACTRIA_NATIVE_RUSAGE_THREAD_COUNTERS",
+            config.rusage_thread_counters);
+        config.rusage_process_counters = get(
+            section,
+            "rusage",
+            "process_counters",
+            "BACTRIA_NATIVE_RUSAGE_PROCESS_COUNTERS",
+            config.rusage_process_counters);
+
+        config.alloc_enable = get(section, "alloc", "enable", "BACTRIA_NATIVE_ALLOC_ENABLE", config.alloc_enable);
+
+        config.phases_compare
+            = get(section, "phases", "compare", "BACTRIA_NATIVE_PHASES_COMPARE", config.phases_compare);
+        config.phases_per_instance = get(
+            section,
+            "phases",
+            "per_instance",
+            "BACTRIA_NATIVE_PHASES_PER_INSTANCE",
+            config.phases_per_instance);
+
+        config.throttle_enable
+            = get(section, "throttle", "enable", "BACTRIA_NATIVE_THROTTLE_ENABLE", config.throttle_enable);
+        config.throttle_overhead_factor = get(
+            section,
+            "throttle",
+            "overhead_factor",
+            "BACTRIA_NATIVE_THROTTLE_OVERHEAD_FACTOR",
+            config.throttle_overhead_factor);
+        config.throttle_min_calls
+            = get(section, "throttle", "min_calls", "BACTRIA_NATIVE_THROTTLE_MIN_CALLS", config.throttle_min_calls);
+        config.throttle_period
+            = get(section, "throttle", "period", "BACTRIA_NATIVE_THROTTLE_PERIOD", config.throttle_period);
+
+        config.snapshot_enable
+            = get(section, "snapshot", "enable", "BACTRIA_NATIVE_SNAPSHOT_ENABLE", config.snapshot_enable);
+        config.snapshot_interval
+            = get(section, "snapshot", "interval", "BACTRIA_NATIVE_SNAPSHOT_INTERVAL", config.snapshot_interval);
+        config.snapshot_mode = get(section, "snapshot", "mode", "BACTRIA_NATIVE_SNAPSHOT_MODE", config.snapshot_mode);
+        config.snapshot_base_name = get(
+            section,
+            "snapshot",
+            "base_name",
+            "BACTRIA_NATIVE_SNAPSHOT_BASE_NAME",
+            config.snapshot_base_name);
+
+        config.live_enable = get(section, "live", "enable", "BACTRIA_NATIVE_LIVE_ENABLE", config.live_enable);
+        config.live_capacity
+            = get(section, "live", "capacity", "BACTRIA_NATIVE_LIVE_CAPACITY", config.live_capacity);
+
+        validate_accuracy("summary", config.summary_relative_accuracy);
+        validate_accuracy("sketch", config.sketch_relative_accuracy);
+
+        if(config.throttle_min_calls < 1 || config.throttle_period < 0 || config.throttle_period > 0xffffffff)
+        {
+            std::cerr << "WARNING: metrics.native.throttle.min_calls must be positive and throttle.period must be "
+                         "in [0, 2^32). Using 1000 and 100."
+                      << std::endl;
+            config.throttle_min_calls = 1000;
+            config.throttle_period = 100;
+        }
+
+        if(!(config.snapshot_interval > 0.0))
+        {
+            std::cerr << "WARNING: metrics.native.snapshot.interval must be positive. Using 60 seconds." << std::endl;
+            config.snapshot_interval = 60.0;
+        }
+        if(config.snapshot_mode != "cumulative" && config.snapshot_mode != "delta")
+        {
+            std::cerr << "WARNING: metrics.native.snapshot.mode must be \"cumulative\" or \"delta\". Using "
+                         "\"cumulative\"."
+                      << std::endl;
+            config.snapshot_mode = "cumulative";
+        }
+
+        if(config.live_capacity < 1 || config.live_capacity > (1 << 20))
+        {
+            std::cerr << "WARNING: metrics.native.live.capacity must be in [1, 2^20]. Using 1024." << std::endl;
+            config.live_capacity = 1024;
+        }
+
+        return config;
+    }
+} // namespace
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            auto get_configuration() -> configuration const&
+            {
+                static auto const config = load();
+                return config;
+            }
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
@@ -0,0 +1,104 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            /* The [metrics.native] section of bactriaConfig.toml. Every key can be overridden by an environment
+             * variable which takes precedence over the file, just like Score-P's variables do for the Score-P
+             * plugin. */
+            struct configuration
+            {
+                // profile.enable / BACTRIA_NATIVE_PROFILE_ENABLE
+                bool profile_enable{true};
+                // profile.base_name / BACTRIA_NATIVE_PROFILE_BASE_NAME; the file is <base_name>_<pid>.txt
+                std::string profile_base_name{"bactria_profile"};
+
+                // summary.enable / BACTRIA_NATIVE_SUMMARY_ENABLE
+                bool summary_enable{true};
+                // summary.file / BACTRIA_NATIVE_SUMMARY_FILE; summaries are appended, an empty name means stderr
+                std::string summary_file{};
+                // summary.relative_accuracy / BACTRIA_NATIVE_SUMMARY_RELATIVE_ACCURACY of the quantiles
+                double summary_relative_accuracy{0.01};
+
+                // sketch.enable / BACTRIA_NATIVE_SKETCH_ENABLE; keeps a quantile sketch per call path
+                bool sketch_enable{false};
+                // sketch.relative_accuracy / BACTRIA_NATIVE_SKETCH_RELATIVE_ACCURACY of the call path quantiles
+                double sketch_relative_accuracy{0.01};
+
+                // perf.enable / BACTRIA_NATIVE_PERF_ENABLE; opens a perf_event counter group per thread
+                bool perf_enable{false};
+                // perf.thread_counters / BACTRIA_NATIVE_PERF_THREAD_COUNTERS; the event names of perf list
+                std::vector<std::string> perf_thread_counters{
+                    "cycles",
+                    "instructions",
+                    "cache-references",
+                    "cache-misses",
+                    "branches",
+                    "branch-misses"};
+
+                // rusage.thread_counters / BACTRIA_NATIVE_RUSAGE_THREAD_COUNTERS; rusage names, cpu_time or all
+                std::vector<std::string> rusage_thread_counters{};
+                // rusage.process_counters / BACTRIA_NATIVE_RUSAGE_PROCESS_COUNTERS; the same for the whole process
+                std::vector<std::string> rusage_process_counters{};
+
+                // alloc.enable / BACTRIA_NATIVE_ALLOC_ENABLE; only has an effect if libbactria_alloc.so is loaded
+                bool alloc_enable{true};
+
+                // phases.compare / BACTRIA_NATIVE_PHASES_COMPARE; compares the sectors' cost across phases
+                bool phases_compare{true};
+                // phases.per_instance / BACTRIA_NATIVE_PHASES_PER_INSTANCE; every entry of a phase is a new instance
+                bool phases_per_instance{false};
+
+                // throttle.enable / BACTRIA_NATIVE_THROTTLE_ENABLE; stops timing sectors that are too short to time
+                bool throttle_enable{false};
+                /* throttle.overhead_factor / BACTRIA_NATIVE_THROTTLE_OVERHEAD_FACTOR; a sector is throttled if its
+                 * mean duration is below this multiple of the thread's enter / leave overhead */
+                double throttle_overhead_factor{10.0};
+                // throttle.min_calls / BACTRIA_NATIVE_THROTTLE_MIN_CALLS; timed calls before a sector is judged
+                std::int64_t throttle_min_calls{1000};
+                // throttle.period / BACTRIA_NATIVE_THROTTLE_PERIOD; time every Nth call of throttled sectors, 0: none
+                std::int64_t throttle_period{100};
+
+                // snapshot.enable / BACTRIA_NATIVE_SNAPSHOT_ENABLE; writes the statistics periodically while running
+                bool snapshot_enable{false};
+                // snapshot.interval / BACTRIA_NATIVE_SNAPSHOT_INTERVAL in seconds
+                double snapshot_interval{60.0};
+                // snapshot.mode / BACTRIA_NATIVE_SNAPSHOT_MODE; "cumulative" or "delta" since the previous snapshot
+                std::string snapshot_mode{"cumulative"};
+                // snapshot.base_name / BACTRIA_NATIVE_SNAPSHOT_BASE_NAME; appended to <base_name>_<pid>.txt
+                std::string snapshot_base_name{"bactria_snapshots"};
+
+                // live.enable / BACTRIA_NATIVE_LIVE_ENABLE; publishes the statistics in shared memory for bactria-top
+                bool live_enable{false};
+                // live.capacity / BACTRIA_NATIVE_LIVE_CAPACITY; the number of sector and phase names in the table
+                std::int64_t live_capacity{1024};
+            };
+
+            // Reads the configuration once; missing files, sections and keys fall back to the defaults above
+            auto get_configuration() -> configuration const&;
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
@@ -0,0 +1,437 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+#include "Counters.hpp"
+
+#include "Allocations.hpp"
+#include "Configuration.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct perf_counter
+    {
+        char const* name;
+        std::uint32_t type;
+        std::uint64_t config;
+    };
+
+    // The names are the ones perf list uses
+    constexpr perf_counter known_counters[] = {
+        {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+        {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {"branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+        {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {"bus-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BUS_CYCLES},
+        {"stalled-cycles-frontend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+        {"stalled-cycles-backend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+        {"ref-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES},
+        {"task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+        {"cpu-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK},
+        {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+        {"minor-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN},
+        {"major-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ},
+        {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+        {"cpu-migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS}};
+
+    // Used if none of the configured counters is available, e.g. in virtual machines without a virtual PMU
+    constexpr char const* fallback_counters[] = {"task-clock", "page-faults"};
+
+    auto find_counter(std::string const& name) noexcept -> perf_counter const*
+    {
+        auto const it = std::find_if(
+            std::begin(known_counters),
+            std::end(known_counters),
+            [&name](perf_counter const& c) { return name == c.name; });
+        return (it != std::end(known_counters)) ? it : nullptr;
+    }
+
+    // Counts the calling thread in user space on any CPU. The group is read with a single read() on the leader.
+    auto open_counter(perf_counter const& counter, int group_fd) noexcept -> int
+    {
+        auto attr = perf_event_attr{};
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counter.type;
+        attr.config = counter.config;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = 1u;
+        attr.exclude_hv = 1u;
+
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+    }
+
+    auto close_all(std::vector<int>& fds) noexcept -> void
+    {
+        // Members first, the leader last
+        for(auto it = fds.rbegin(); it != fds.rend(); ++it)
+            close(*it);
+        fds.clear();
+    }
+
+    auto open_group(std::vector<perf_counter> const& counters, std::vector<int>& fds) noexcept -> bool
+    {
+        for(auto const& counter : counters)
+        {
+            auto const fd = open_counter(counter, fds.empty() ? -1 : fds.front());
+            if(fd < 0)
+            {
+                close_all(fds);
+                return false;
+            }
+
+            fds.push_back(fd);
+        }
+
+        return true;
+    }
+
+    auto can_open(perf_counter const& counter) noexcept -> bool
+    {
+        auto const fd = open_counter(counter, -1);
+        if(fd < 0)
+            return false;
+
+        close(fd);
+        return true;
+    }
+
+    auto can_open_group(std::vector<perf_counter> const& counters) -> bool
+    {
+        auto fds = std::vector<int>{};
+        auto const ok = open_group(counters, fds);
+        close_all(fds);
+        return ok;
+    }
+
+    auto resolve(std::vector<std::string> const& names) -> std::vector<perf_counter>
+    {
+        auto counters = std::vector<perf_counter>{};
+        for(auto const& name : names)
+        {
+            auto const counter = find_counter(name);
+            if(counter == nullptr)
+            {
+                std::cerr << "WARNING: bactria's native metrics plugin doesn't know the counter " << name << '.'
+                          << std::endl;
+            }
+            else if(counters.size() == bactria::metrics::native::max_counters)
+            {
+                std::cerr << "WARNING: bactria's native metrics plugin supports at most "
+                          << bactria::metrics::native::max_counters << " counters. Ignoring " << name << '.'
+                          << std::endl;
+            }
+            else if(!can_open(*counter))
+            {
+                std::cerr << "WARNING: bactria's native metrics plugin can't open the counter " << name << " ("
+                          << std::strerror(errno) << ")." << std::endl;
+            }
+            else
+                counters.push_back(*counter);
+        }
+
+        // Hardware counters can't always be scheduled together. Keep the software counters in that case.
+        if(!counters.empty() && !can_open_group(counters))
+        {
+            std::cerr << "WARNING: bactria's native metrics plugin can't count all configured counters at once ("
+                      << std::strerror(errno) << "). Only software counters will be collected." << std::endl;
+            counters.erase(
+                std::remove_if(
+                    counters.begin(),
+                    counters.end(),
+                    [](perf_counter const& c) { return c.type != PERF_TYPE_SOFTWARE; }),
+                counters.end());
+        }
+
+        if(counters.empty() && !names.empty())
+        {
+            std::cerr << "WARNING: bactria's native metrics plugin falls back to software counters." << std::endl;
+            for(auto const name : fallback_counters)
+            {
+                if(can_open(*find_counter(name)))
+                    counters.push_back(*find_counter(name));
+            }
+        }
+
+        return counters;
+    }
+
+    // Resource usage of the thread (RUSAGE_THREAD, CLOCK_THREAD_CPUTIME_ID) or of the whole process
+    enum class usage_field
+    {
+        cpu_time,
+        utime,
+        stime,
+        minflt,
+        majflt,
+        inblock,
+        oublock,
+        nvcsw,
+        nivcsw
+    };
+
+    struct usage_counter
+    {
+        char const* name;
+        usage_field field;
+    };
+
+    // The names are the ones Score-P uses for its rusage metrics. Times are in nanoseconds.
+    constexpr usage_counter known_usage_counters[] = {
+        {"cpu_time", usage_field::cpu_time},
+        {"ru_utime", usage_field::utime},
+        {"ru_stime", usage_field::stime},
+        {"ru_minflt", usage_field::minflt},
+        {"ru_majflt", usage_field::majflt},
+        {"ru_inblock", usage_field::inblock},
+        {"ru_oublock", usage_field::oublock},
+        {"ru_nvcsw", usage_field::nvcsw},
+        {"ru_nivcsw", usage_field::nivcsw}};
+
+    auto to_ns(timeval const& tv) noexcept -> std::uint64_t
+    {
+        return static_cast<std::uint64_t>(tv.tv_sec) * 1000000000u + static_cast<std::uint64_t>(tv.tv_usec) * 1000u;
+    }
+
+    auto to_ns(timespec const& ts) noexcept -> std::uint64_t
+    {
+        return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000u + static_cast<std::uint64_t>(ts.tv_nsec);
+    }
+
+    auto usage_value(rusage const& usage, std::uint64_t cpu_time, usage_field field) noexcept -> std::uint64_t
+    {
+        switch(field)
+        {
+        case usage_field::cpu_time:
+            return cpu_time;
+        case usage_field::utime:
+            return to_ns(usage.ru_utime);
+        case usage_field::stime:
+            return to_ns(usage.ru_stime);
+        case usage_field::minflt:
+            return static_cast<std::uint64_t>(usage.ru_minflt);
+        case usage_field::majflt:
+            return static_cast<std::uint64_t>(usage.ru_majflt);
+        case usage_field::inblock:
+            return static_cast<std::uint64_t>(usage.ru_inblock);
+        case usage_field::oublock:
+            return static_cast<std::uint64_t>(usage.ru_oublock);
+        case usage_field::nvcsw:
+            return static_cast<std::uint64_t>(usage.ru_nvcsw);
+        case usage_field::nivcsw:
+            return static_cast<std::uint64_t>(usage.ru_nivcsw);
+        }
+        return 0u;
+    }
+
+    // "all" selects every known counter, like in Score-P
+    auto resolve_usage(std::vector<std::string> const& names) -> std::vector<usage_counter>
+    {
+        auto counters = std::vector<usage_counter>{};
+        for(auto const& name : names)
+        {
+            if(name == "all")
+            {
+                counters.assign(std::begin(known_usage_counters), std::end(known_usage_counters));
+                break;
+            }
+
+            auto const it = std::find_if(
+                std::begin(known_usage_counters),
+                std::end(known_usage_counters),
+                [&name](usage_counter const& c) { return name == c.name; });
+            if(it != std::end(known_usage_counters))
+                counters.push_back(*it);
+            else
+            {
+                std::cerr << "WARNING: bactria's native metrics plugin doesn't know the rusage counter " << name
+                          << '.' << std::endl;
+            }
+        }
+
+        return counters;
+    }
+
+    // Filled from the allocation hook's statistics
+    constexpr char const* allocation_counters[] = {"allocations", "frees", "allocated_bytes", "freed_bytes"};
+
+    // The slots are filled in this order: perf counters, thread usage, process usage, allocations
+    struct counter_set
+    {
+        std::vector<perf_counter> perf;
+        std::vector<usage_counter> thread_usage;
+        std::vector<usage_counter> process_usage;
+        bool allocations{false};
+        std::vector<std::string> names;
+    };
+
+    auto get_counter_set() -> counter_set const&
+    {
+        static auto const set = []() {
+            auto s = counter_set{};
+            auto const& config = bactria::metrics::native::get_configuration();
+            if(config.perf_enable)
+                s.perf = resolve(config.perf_thread_counters);
+            s.thread_usage = resolve_usage(config.rusage_thread_counters);
+            s.process_usage = resolve_usage(config.rusage_process_counters);
+            s.allocations = config.alloc_enable && bactria::metrics::native::thread_allocation_stats() != nullptr;
+
+            for(auto const& counter : s.perf)
+                s.names.emplace_back(counter.name);
+            for(auto const& counter : s.thread_usage)
+                s.names.emplace_back(counter.name);
+            for(auto const& counter : s.process_usage)
+                s.names.emplace_back(std::string{"process:"} + counter.name);
+            if(s.allocations)
+                s.names.insert(s.names.end(), std::begin(allocation_counters), std::end(allocation_counters));
+
+            if(s.names.size() > bactria::metrics::native::max_counters)
+            {
+                std::cerr << "WARNING: bactria's native metrics plugin supports at most "
+                          << bactria::metrics::native::max_counters
+                          << " counters. Ignoring the rusage and allocation counters." << std::endl;
+                s.thread_usage.clear();
+                s.process_usage.clear();
+                s.allocations = false;
+                s.names.resize(s.perf.size());
+            }
+
+            return s;
+        }();
+        return set;
+    }
+
+    auto read_allocations(bactria::metrics::native::counter_values& values, std::size_t first) noexcept -> void
+    {
+        auto const stats = bactria::metrics::native::thread_allocation_stats();
+        values[first] = stats->allocations;
+        values[first + 1u] = stats->frees;
+        values[first + 2u] = stats->allocated_bytes;
+        values[first + 3u] = stats->freed_bytes;
+    }
+
+    auto read_usage(
+        std::vector<usage_counter> const& counters,
+        int who,
+        clockid_t clock,
+        bactria::metrics::native::counter_values& values,
+        std::size_t first) noexcept -> void
+    {
+        if(counters.empty())
+            return;
+
+        auto usage = rusage{};
+        if(getrusage(who, &usage) != 0)
+            return;
+
+        auto cpu_time = timespec{};
+        clock_gettime(clock, &cpu_time);
+
+        for(auto i = std::size_t{0u}; i < counters.size(); ++i)
+            values[first + i] = usage_value(usage, to_ns(cpu_time), counters[i].field);
+    }
+} // namespace
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            auto counter_names() -> std::vector<std::string> const&
+            {
+                return get_counter_set().names;
+            }
+
+            thread_counters::thread_counters()
+            {
+                auto const& set = get_counter_set();
+                m_perf = set.perf.size();
+                m_size = set.names.size();
+
+                // If the group can't be opened on this thread its counters stay zero
+                if(!set.perf.empty() && !open_group(set.perf, m_fds))
+                {
+                    std::cerr << "WARNING: bactria's native metrics plugin can't open the counters of a thread ("
+                              << std::strerror(errno) << ")." << std::endl;
+                }
+            }
+
+            thread_counters::~thread_counters()
+            {
+                close_all(m_fds);
+            }
+
+            auto thread_counters::read(counter_values& values) const noexcept -> void
+            {
+                read_perf(values);
+
+                auto const& set = get_counter_set();
+                read_usage(set.thread_usage, RUSAGE_THREAD, CLOCK_THREAD_CPUTIME_ID, values, m_perf);
+                read_usage(
+                    set.process_usage,
+                    RUSAGE_SELF,
+                    CLOCK_PROCESS_CPUTIME_ID,
+                    values,
+                    m_perf + set.thread_usage.size());
+
+                if(set.allocations)
+                    read_allocations(values, m_perf + set.thread_usage.size() + set.process_usage.size());
+            }
+
+            auto thread_counters::read_perf(counter_values& values) const noexcept -> void
+            {
+                if(m_fds.empty())
+                    return;
+
+                // nr, time_enabled, time_running, values...
+                auto buffer = std::array<std::uint64_t, 3u + max_counters>{};
+                if(::read(m_fds.front(), buffer.data(), sizeof(buffer)) < 0)
+                    return;
+
+                auto const nr = std::min(static_cast<std::size_t>(buffer[0]), m_perf);
+                auto const enabled = buffer[1];
+                auto const running = buffer[2];
+
+                // Scale the counts up if the kernel had to multiplex the group with other events
+                auto const scale = (running != 0u && running < enabled)
+                                       ? static_cast<double>(enabled) / static_cast<double>(running)
+                                       : 1.0;
+                for(auto i = std::size_t{0u}; i < nr; ++i)
+                {
+                    values[i] = (scale == 1.0)
+                                    ? buffer[3u + i]
+                                    : static_cast<std::uint64_t>(static_cast<double>(buffer[3u + i]) * scale);
+                }
+            }
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
@@ -0,0 +1,66 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            /* Counters (perf_event counters and resource usage) are read at every enter and leave and their deltas
+             * are added to the call path, just like the durations. A fixed number of slots keeps the call stack free
+             * of allocations. */
+            constexpr auto max_counters = std::size_t{16u};
+            using counter_values = std::array<std::uint64_t, max_counters>;
+
+            /* The names of the counters which are actually collected, in slot order. The configured list is checked
+             * once per process; counters which can't be opened are dropped. */
+            auto counter_names() -> std::vector<std::string> const&;
+
+            // The calling thread's counters
+            class thread_counters
+            {
+            public:
+                thread_counters();
+                thread_counters(thread_counters const&) = delete;
+                auto operator=(thread_counters const&) -> thread_counters& = delete;
+                ~thread_counters();
+
+                auto size() const noexcept -> std::size_t
+                {
+                    return m_size;
+                }
+
+                // Slots without a counter are left untouched
+                auto read(counter_values& values) const noexcept -> void;
+
+            private:
+                auto read_perf(counter_values& values) const noexcept -> void;
+
+                std::vector<int> m_fds{};
+                std::size_t m_perf{0u};
+                std::size_t m_size{0u};
+            };
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
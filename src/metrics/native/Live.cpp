@@ -0,0 +1,242 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#include "Live.hpp"
+
+#include "Configuration.hpp"
+#include "LiveTable.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using bactria::metrics::native::live_entry;
+    using bactria::metrics::native::live_header;
+
+    /* Creates the segment when the first handle is created and removes it when the plugin is unloaded. If the process
+     * crashes the segment stays in /dev/shm until it is removed by hand; bactria-top reports such orphans. */
+    class live_segment
+    {
+    public:
+        live_segment()
+        {
+            auto const& config = bactria::metrics::native::get_configuration();
+            if(!config.live_enable)
+                return;
+
+            m_name = bactria::metrics::native::live_segment_name(static_cast<long>(getpid()));
+            auto const capacity = static_cast<std::uint32_t>(config.live_capacity);
+            m_size = bactria::metrics::native::live_segment_size(capacity);
+
+            auto const fd = shm_open(m_name.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0600);
+            if(fd == -1)
+            {
+                warn("create");
+                return;
+            }
+
+            auto const mapping = (ftruncate(fd, static_cast<off_t>(m_size)) == 0)
+                                     ? mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                                     : MAP_FAILED;
+            close(fd);
+            if(mapping == MAP_FAILED)
+            {
+                warn("map");
+                shm_unlink(m_name.c_str());
+                return;
+            }
+
+            // The pages are zero-filled, which is a valid state for all atomics
+            m_header = new(mapping) live_header{};
+            m_header->capacity = capacity;
+            m_header->start = bactria::metrics::native::now();
+            m_entries = bactria::metrics::native::live_entries(m_header);
+            for(auto i = std::uint32_t{0u}; i < capacity; ++i)
+                new(m_entries + i) live_entry{};
+            m_registered.resize(capacity, false);
+
+            // bactria-top rejects the segment until the magic number is visible
+            std::atomic_thread_fence(std::memory_order_release);
+            m_header->magic = bactria::metrics::native::live_magic;
+        }
+
+        live_segment(live_segment const&) = delete;
+        auto operator=(live_segment const&) -> live_segment& = delete;
+
+        // Threads may still leave sectors while the process exits, so the mapping is left to the operating system
+        ~live_segment()
+        {
+            if(m_header != nullptr)
+                shm_unlink(m_name.c_str());
+        }
+
+        auto entry(std::uint32_t region_id) const noexcept -> live_entry*
+        {
+            return (m_header != nullptr && region_id < m_header->capacity) ? m_entries + region_id : nullptr;
+        }
+
+        auto add(bactria::metrics::native::region const& r) -> void
+        {
+            if(m_header == nullptr)
+                return;
+
+            std::lock_guard<std::mutex> const lock{m_mutex};
+            if(r.id >= m_header->capacity)
+            {
+                if(r.id >= m_dropped)
+                {
+                    m_dropped = r.id + 1u;
+                    m_header->dropped.fetch_add(1u, std::memory_order_relaxed);
+                }
+                return;
+            }
+            if(m_registered[r.id])
+                return;
+
+            auto& e = m_entries[r.id];
+            std::strncpy(e.type, bactria::metrics::native::type_name(r.type), sizeof(e.type) - 1u);
+            auto const length = std::min(r.name.size(), bactria::metrics::native::live_name_size - 1u);
+            std::memcpy(e.name, r.name.data(), length);
+            e.name[length] = '\0';
+            m_registered[r.id] = true;
+
+            // Regions are interned concurrently, so a smaller id may be published after a larger one
+            if(r.id + 1u > m_header->size.load(std::memory_order_relaxed))
+                m_header->size.store(r.id + 1u, std::memory_order_release);
+        }
+
+    private:
+        auto warn(char const* what) const -> void
+        {
+            std::fprintf(
+                stderr,
+                "WARNING: bactria's native metrics plugin failed to %s %s: %s. The live table is disabled.\n",
+                what,
+                m_name.c_str(),
+                std::strerror(errno));
+        }
+
+        std::string m_name{};
+        std::size_t m_size{0u};
+        live_header* m_header{nullptr};
+        live_entry* m_entries{nullptr};
+        std::vector<bool> m_registered{};
+        std::uint32_t m_dropped{0u};
+        std::mutex m_mutex{};
+    };
+
+    auto segment() -> live_segment&
+    {
+        static live_segment s;
+        return s;
+    }
+
+    // Waits for concurrent writers of the same entry. Returns the odd sequence which unlock() makes even again.
+    auto lock(live_entry& e) noexcept -> std::uint64_t
+    {
+        auto sequence = e.sequence.load(std::memory_order_relaxed);
+        while(sequence % 2u != 0u
+              || !e.sequence.compare_exchange_weak(sequence, sequence + 1u, std::memory_order_acquire))
+            sequence = e.sequence.load(std::memory_order_relaxed);
+
+        // The statistics must not become visible before the odd sequence
+        std::atomic_thread_fence(std::memory_order_release);
+        return sequence + 1u;
+    }
+
+    auto unlock(live_entry& e, std::uint64_t sequence) noexcept -> void
+    {
+        e.sequence.store(sequence + 1u, std::memory_order_release);
+    }
+
+    // Only the writer holding the lock modifies the statistics, so loads and stores suffice
+    auto increment(std::atomic<std::uint64_t>& value, std::uint64_t amount) noexcept -> void
+    {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+} // namespace
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            auto live_register(region const& r) -> void
+            {
+                segment().add(r);
+            }
+
+            auto live_enter(std::uint32_t region_id) noexcept -> void
+            {
+                auto const e = segment().entry(region_id);
+                if(e == nullptr)
+                    return;
+
+                auto const sequence = lock(*e);
+                e->in_flight.store(e->in_flight.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                unlock(*e, sequence);
+            }
+
+            auto live_leave(std::uint32_t region_id, std::int64_t duration) noexcept -> void
+            {
+                auto const e = segment().entry(region_id);
+                if(e == nullptr)
+                    return;
+
+                auto const d = static_cast<std::uint64_t>(std::max(duration, std::int64_t{0}));
+                auto const sequence = lock(*e);
+                increment(e->calls, 1u);
+                increment(e->timed, 1u);
+                increment(e->total, d);
+                if(d > e->max.load(std::memory_order_relaxed))
+                    e->max.store(d, std::memory_order_relaxed);
+                e->in_flight.store(e->in_flight.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+                unlock(*e, sequence);
+            }
+
+            auto live_count(std::uint32_t region_id) noexcept -> void
+            {
+                auto const e = segment().entry(region_id);
+                if(e == nullptr)
+                    return;
+
+                auto const sequence = lock(*e);
+                increment(e->calls, 1u);
+                unlock(*e, sequence);
+            }
+
+            auto live_close(std::uint32_t region_id, std::int64_t duration) noexcept -> void
+            {
+                if(duration >= 0)
+                    live_leave(region_id, duration);
+                else
+                    live_count(region_id);
+            }
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
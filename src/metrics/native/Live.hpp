@@ -0,0 +1,47 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#pragma once
+
+#include "Profile.hpp"
+
+#include <cstdint>
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            /* Publishes the process-wide statistics of every sector and phase in the shared-memory table described in
+             * LiveTable.hpp if live.enable is set. All functions do nothing otherwise. */
+
+            // Called whenever a handle is created; every region is added to the table once
+            auto live_register(region const& r) -> void;
+
+            auto live_enter(std::uint32_t region_id) noexcept -> void;
+
+            // Ends a live_enter()
+            auto live_leave(std::uint32_t region_id, std::int64_t duration) noexcept -> void;
+
+            // Counts a throttled call which wasn't timed and didn't call live_enter()
+            auto live_count(std::uint32_t region_id) noexcept -> void;
+
+            // The call_tree::close_hook: leaves timed entries and counts untimed ones
+            auto live_close(std::uint32_t region_id, std::int64_t duration) noexcept -> void;
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
@@ -0,0 +1,128 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            /* The layout of the shared-memory segment /bactria_live_<pid> which the native plugin creates if
+             * live.enable is set and bactria-top reads. The segment is a live_header followed by capacity entries,
+             * one per sector or phase name. Everything in it is either written once before it is published or an
+             * address-free atomic, so the plugin and bactria-top may be built by different compilers. */
+            static_assert(
+                ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+                "The live table requires lock-free atomics");
+
+            // "bactria" followed by the layout version. Readers refuse segments with a different value.
+            constexpr auto live_magic = std::uint64_t{0x6261637472696101u};
+            constexpr auto live_name_size = std::size_t{64u};
+
+            struct live_header
+            {
+                std::uint64_t magic;
+                // The number of entries following the header
+                std::uint32_t capacity;
+                // The entries in use. Raised with release semantics after an entry's name has been written.
+                std::atomic<std::uint32_t> size;
+                // Regions which didn't fit into the table
+                std::atomic<std::uint64_t> dropped;
+                // The steady clock (CLOCK_MONOTONIC) in nanoseconds when the segment was created
+                std::int64_t start;
+            };
+
+            /* The statistics are guarded by a seqlock: a writer makes the sequence odd, updates the statistics and
+             * makes it even again. Readers retry if the sequence was odd or changed while they read. Concurrent
+             * writers serialize on the odd sequence. The statistics are atomics so that racing reads are defined;
+             * all accesses to them are relaxed. */
+            struct alignas(64) live_entry
+            {
+                std::atomic<std::uint64_t> sequence;
+                std::atomic<std::uint64_t> calls;
+                // Calls which were timed; throttled calls are only counted
+                std::atomic<std::uint64_t> timed;
+                // The duration of the timed calls in nanoseconds
+                std::atomic<std::uint64_t> total;
+                std::atomic<std::uint64_t> max;
+                // Entries which haven't been left yet, summed over all threads
+                std::atomic<std::int64_t> in_flight;
+                // Written once before the entry is published
+                char name[live_name_size];
+                // "Phase" or the name of the sector tag
+                char type[16];
+            };
+
+            // A consistent copy of an entry's statistics
+            struct live_statistics
+            {
+                std::uint64_t calls{0u};
+                std::uint64_t timed{0u};
+                std::uint64_t total{0u};
+                std::uint64_t max{0u};
+                std::int64_t in_flight{0};
+            };
+
+            inline auto live_segment_name(long pid) -> std::string
+            {
+                return "/bactria_live_" + std::to_string(pid);
+            }
+
+            inline auto live_segment_size(std::uint32_t capacity) noexcept -> std::size_t
+            {
+                // The entries start at the first cache line after the header
+                return (sizeof(live_header) + alignof(live_entry) - 1u) / alignof(live_entry) * alignof(live_entry)
+                       + capacity * sizeof(live_entry);
+            }
+
+            inline auto live_entries(live_header* header) noexcept -> live_entry*
+            {
+                auto const offset = live_segment_size(0u);
+                return reinterpret_cast<live_entry*>(reinterpret_cast<unsigned char*>(header) + offset);
+            }
+
+            // Returns false if no consistent copy could be taken, e.g. because the writer died while updating
+            inline auto live_read(live_entry const& entry, live_statistics& stats) noexcept -> bool
+            {
+                for(auto attempt = 0; attempt < 1000; ++attempt)
+                {
+                    auto const before = entry.sequence.load(std::memory_order_acquire);
+                    if(before % 2u != 0u)
+                        continue;
+
+                    stats.calls = entry.calls.load(std::memory_order_relaxed);
+                    stats.timed = entry.timed.load(std::memory_order_relaxed);
+                    stats.total = entry.total.load(std::memory_order_relaxed);
+                    stats.max = entry.max.load(std::memory_order_relaxed);
+                    stats.in_flight = entry.in_flight.load(std::memory_order_relaxed);
+
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if(entry.sequence.load(std::memory_order_relaxed) == before)
+                        return true;
+                }
+
+                return false;
+            }
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
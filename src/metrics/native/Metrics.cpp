@@ -0,0 +1,209 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#include "Allocations.hpp"
+#include "Configuration.hpp"
+#include "Live.hpp"
+#include "Profile.hpp"
+#include "Snapshot.hpp"
+#include "Summary.hpp"
+
+#include <bactria/metrics/PluginInterface.hpp>
+
+#include <cstdint>
+#include <limits>
+
+/* The native plugin needs no external tool chain. Every thread builds its own call-path tree from the sectors and
+ * phases it enters; the trees are merged when the threads exit and written as a profile when the plugin is
+ * unloaded. Loop and Body sectors additionally collect duration statistics which are written by
+ * bactria_metrics_sector_summary(). If sketch.enable is set every call path keeps a quantile sketch of its durations
+ * as well, and if perf.enable is set the deltas of the thread's perf_event counters are added to the call paths.
+ * The same holds for resource usage and, if libbactria_alloc.so is loaded, heap allocations. The plugin's own
+ * allocations are hidden from the allocation hook. If sectors are annotated with work the profile reports their
+ * throughput, and it ends with a comparison of every sector's cost in the phases (or phase instances) enclosing it.
+ * If throttle.enable is set, sectors which are too short to be timed reliably are only counted (or sampled) once
+ * their mean duration is known. If snapshot.enable is set a background thread periodically collects the totals which
+ * the threads publish when they leave a sector or phase, see Snapshot.hpp. If live.enable is set the process-wide
+ * statistics are kept up to date in shared memory for bactria-top, see LiveTable.hpp. See Configuration.hpp for the
+ * available settings. */
+
+namespace native = bactria::metrics::native;
+
+namespace
+{
+    // Counters are read after the clock on enter and before it on leave, so they don't see their own overhead
+    auto read_counters() noexcept -> native::counter_values
+    {
+        auto values = native::counter_values{};
+        native::this_thread_counters().read(values);
+        return values;
+    }
+
+    // Publishes the thread's totals if the snapshot thread has asked for them since the last time
+    auto poll_snapshot(native::call_tree const& tree, std::int64_t timestamp) -> void
+    {
+        auto& slot = native::this_thread_snapshot();
+        if(slot.requested())
+            slot.publish(tree, timestamp);
+    }
+} // namespace
+
+extern "C"
+{
+    // Handles are shared between all sectors with the same name and type, so they are never destroyed individually
+    auto bactria_metrics_create_sector(char const* name, std::uint32_t type) noexcept -> void*
+    {
+        native::allocation_guard const guard;
+        auto const r = native::intern_region(name, type);
+        native::live_register(*r);
+        return const_cast<native::region*>(r);
+    }
+
+    auto bactria_metrics_destroy_sector(void* /* sector_handle */) noexcept -> void
+    {
+    }
+
+    auto bactria_metrics_enter_sector(
+        void* sector_handle,
+        char const* /* source */,
+        std::uint32_t /* lineno */,
+        char const* /* caller */) noexcept -> void
+    {
+        native::allocation_guard const guard;
+        auto const id = static_cast<native::region const*>(sector_handle)->id;
+        auto& tree = native::thread_tree();
+
+        // Throttled sectors skip the clock and the counters
+        auto const weight = tree.weight(id);
+        if(weight == 0u)
+        {
+            tree.enter_untimed(id);
+            return;
+        }
+
+        native::live_enter(id);
+        auto const timestamp = native::now();
+        auto const counters = read_counters();
+        tree.enter(id, timestamp, counters, 0u, weight);
+    }
+
+    auto bactria_metrics_leave_sector(
+        void* sector_handle,
+        char const* /* source */,
+        std::uint32_t /* lineno */,
+        char const* /* caller */) noexcept -> void
+    {
+        native::allocation_guard const guard;
+        auto const& r = *static_cast<native::region const*>(sector_handle);
+        auto& tree = native::thread_tree();
+        if(tree.leave_untimed(r.id))
+        {
+            native::live_count(r.id);
+            return;
+        }
+
+        auto const counters = read_counters();
+        auto const timestamp = native::now();
+        auto const duration = tree.leave(r.id, timestamp, counters, native::live_close);
+
+        auto const& config = native::get_configuration();
+        if(config.throttle_enable && duration >= 0)
+            tree.observe(r.id, duration);
+
+        if(native::is_summarized(r.type) && duration >= 0 && config.summary_enable)
+            native::record_duration(r, duration);
+
+        poll_snapshot(tree, timestamp);
+    }
+
+    // Reports the durations of the calling thread's Body iterations or Loop executions since the last summary
+    auto bactria_metrics_sector_summary(void* sector_handle) noexcept -> void
+    {
+        native::allocation_guard const guard;
+        auto const& r = *static_cast<native::region const*>(sector_handle);
+        if(native::is_summarized(r.type) && native::get_configuration().summary_enable)
+            native::write_summary(r);
+    }
+
+    // Queries the calling thread's sketches; the process-wide quantiles are written to the profile
+    auto bactria_metrics_sector_quantile(void* sector_handle, double q) noexcept -> double
+    {
+        native::allocation_guard const guard;
+        auto& tree = native::thread_tree();
+        if(!tree.sketches() || !(q >= 0.0 && q <= 1.0))
+            return std::numeric_limits<double>::quiet_NaN();
+
+        try
+        {
+            return tree.quantile(static_cast<native::region const*>(sector_handle)->id, q) * 1e-9;
+        }
+        catch(...)
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+
+    // Work is added to the node of the sector's innermost entry, which already exists
+    auto bactria_metrics_sector_work(void* sector_handle, std::uint32_t type, std::uint64_t amount) noexcept -> void
+    {
+        native::allocation_guard const guard;
+        native::thread_tree().add_work(static_cast<native::region const*>(sector_handle)->id, type, amount);
+    }
+
+    auto bactria_metrics_create_phase(char const* name) noexcept -> void*
+    {
+        native::allocation_guard const guard;
+        auto const r = native::intern_region(name, native::phase_type);
+        native::live_register(*r);
+        return const_cast<native::region*>(r);
+    }
+
+    auto bactria_metrics_destroy_phase(void* /* phase_handle */) noexcept -> void
+    {
+    }
+
+    auto bactria_metrics_enter_phase(
+        void* phase_handle,
+        char const* /* source */,
+        std::uint32_t /* lineno */,
+        char const* /* caller */) noexcept -> void
+    {
+        native::allocation_guard const guard;
+        auto const timestamp = native::now();
+        auto const counters = read_counters();
+        auto const id = static_cast<native::region const*>(phase_handle)->id;
+        auto& tree = native::thread_tree();
+        auto const instance = native::get_configuration().phases_per_instance ? tree.next_instance(id) : 0u;
+        tree.enter(id, timestamp, counters, instance);
+        native::live_enter(id);
+    }
+
+    auto bactria_metrics_leave_phase(
+        void* phase_handle,
+        char const* /* source */,
+        std::uint32_t /* lineno */,
+        char const* /* caller */) noexcept -> void
+    {
+        native::allocation_guard const guard;
+        auto const counters = read_counters();
+        auto const timestamp = native::now();
+        auto& tree = native::thread_tree();
+        auto const id = static_cast<native::region const*>(phase_handle)->id;
+        tree.leave(id, timestamp, counters, native::live_close);
+
+        poll_snapshot(tree, timestamp);
+    }
+}
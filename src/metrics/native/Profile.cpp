@@ -0,0 +1,989 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#include "Profile.hpp"
+
+#include "Allocations.hpp"
+#include "Configuration.hpp"
+#include "Live.hpp"
+#include "Snapshot.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    using bactria::metrics::native::call_tree;
+    using bactria::metrics::native::node;
+    using bactria::metrics::native::region;
+    using bactria::metrics::native::type_name;
+
+    // Denominator of ratios relative to the inclusive wall time
+    constexpr auto wall_time = bactria::metrics::native::max_counters;
+
+    // A metric derived from two counters, e.g. instructions per cycle
+    struct ratio
+    {
+        char const* name;
+        std::size_t numerator;
+        std::size_t denominator;
+        double factor;
+    };
+
+    auto derived_ratios(std::vector<std::string> const& names) -> std::vector<ratio>
+    {
+        auto const slot = [&names](char const* name) {
+            return static_cast<std::size_t>(std::find(names.begin(), names.end(), name) - names.begin());
+        };
+        auto const none = names.size();
+        auto const cycles = slot("cycles");
+        auto const instructions = slot("instructions");
+        auto const cache_references = slot("cache-references");
+        auto const cache_misses = slot("cache-misses");
+        auto const branches = slot("branches");
+        auto const branch_misses = slot("branch-misses");
+        auto const cpu_time = slot("cpu_time");
+
+        auto ratios = std::vector<ratio>{};
+        if(instructions != none && cycles != none)
+            ratios.push_back(ratio{"IPC", instructions, cycles, 1.0});
+
+        // Miss rates relative to the accesses, or per thousand instructions if the accesses aren't counted
+        if(cache_misses != none && cache_references != none)
+            ratios.push_back(ratio{"cache-miss%", cache_misses, cache_references, 100.0});
+        else if(cache_misses != none && instructions != none)
+            ratios.push_back(ratio{"cache-MPKI", cache_misses, instructions, 1000.0});
+
+        if(branch_misses != none && branches != none)
+            ratios.push_back(ratio{"branch-miss%", branch_misses, branches, 100.0});
+        else if(branch_misses != none && instructions != none)
+            ratios.push_back(ratio{"branch-MPKI", branch_misses, instructions, 1000.0});
+
+        // A thread which spends less CPU time than wall time in a region was blocked or descheduled
+        if(cpu_time != none)
+            ratios.push_back(ratio{"cpu%", cpu_time, wall_time, 100.0});
+
+        return ratios;
+    }
+
+    auto instance_suffix(std::uint32_t instance) -> std::string
+    {
+        return (instance != 0u) ? " #" + std::to_string(instance) : std::string{};
+    }
+
+    auto column_width(std::string const& name) noexcept -> int
+    {
+        return static_cast<int>(std::max(name.size(), std::size_t{16u}));
+    }
+
+    class region_registry
+    {
+    public:
+        auto intern(char const* name, std::uint32_t type) -> region const*
+        {
+            std::lock_guard<std::mutex> const lock{m_mutex};
+
+            auto const key = std::make_pair(std::string{name}, type);
+            auto const it = m_ids.find(key);
+            if(it != m_ids.end())
+                return &m_regions[it->second];
+
+            auto const id = static_cast<std::uint32_t>(m_regions.size());
+            m_regions.push_back(region{key.first, type, id});
+            m_ids.emplace(key, id);
+            return &m_regions.back();
+        }
+
+        // Regions are only appended, so their addresses stay valid
+        auto get(std::uint32_t id) -> region const&
+        {
+            std::lock_guard<std::mutex> const lock{m_mutex};
+            return m_regions[id];
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::deque<region> m_regions;
+        std::map<std::pair<std::string, std::uint32_t>, std::uint32_t> m_ids;
+    };
+
+    region_registry regions;
+
+    class process_profile
+    {
+    public:
+        process_profile() = default;
+        process_profile(process_profile const&) = delete;
+        auto operator=(process_profile const&) -> process_profile& = delete;
+
+        ~process_profile()
+        {
+            auto const& config = bactria::metrics::native::get_configuration();
+            if(config.profile_enable && m_threads != 0u)
+                write(config.profile_base_name + "_" + std::to_string(getpid()) + ".txt");
+        }
+
+        // peak_bytes is the thread's peak of live heap memory or negative if allocations aren't tracked
+        auto add(call_tree const& tree, std::int64_t peak_bytes) -> void
+        {
+            std::lock_guard<std::mutex> const lock{m_mutex};
+            m_tree.merge(tree);
+            m_peak_bytes = std::max(m_peak_bytes, peak_bytes);
+            m_overhead += tree.overhead().total;
+            ++m_threads;
+        }
+
+        auto accumulate(std::vector<bactria::metrics::native::region_totals>& totals) -> std::size_t
+        {
+            std::lock_guard<std::mutex> const lock{m_mutex};
+            m_tree.accumulate(totals, 0);
+            return m_threads;
+        }
+
+    private:
+        auto write(std::string const& path) const -> void
+        {
+            auto const file = std::fopen(path.c_str(), "w");
+            if(file == nullptr)
+            {
+                std::fprintf(stderr, "WARNING: bactria's native metrics plugin failed to open %s.\n", path.c_str());
+                return;
+            }
+
+            std::fprintf(file, "# bactria call-path profile\n");
+            std::fprintf(
+                file,
+                "# pid %d, %zu thread(s). Times are in seconds and summed over all threads.\n",
+                static_cast<int>(getpid()),
+                m_threads);
+            std::fprintf(file, "# %12s %16s %16s", "calls", "inclusive", "exclusive");
+            if(m_tree.sketches())
+                std::fprintf(file, " %14s %14s %14s %14s", "p50", "p90", "p99", "p99.9");
+            for(auto const& name : m_counter_names)
+                std::fprintf(file, " %*s", column_width(name), name.c_str());
+            for(auto const& r : m_ratios)
+                std::fprintf(file, " %12s", r.name);
+            std::fprintf(file, "  %s\n", "region");
+            write_children(file, call_tree::root, 0u);
+
+            auto const allocations = static_cast<std::size_t>(
+                std::find(m_counter_names.begin(), m_counter_names.end(), "allocations") - m_counter_names.begin());
+            if(allocations != m_counter_names.size())
+                write_allocations(file, allocations);
+
+            write_work(file);
+
+            if(bactria::metrics::native::get_configuration().throttle_enable)
+                write_throttling(file);
+
+            if(bactria::metrics::native::get_configuration().phases_compare)
+                write_phase_comparison(file);
+
+            std::fclose(file);
+        }
+
+        auto write_children(std::FILE* file, std::uint32_t parent, std::size_t depth) const -> void
+        {
+            auto const& nodes = m_tree.nodes();
+
+            // The most expensive call paths come first
+            auto kids = nodes[parent].kids;
+            std::sort(kids.begin(), kids.end(), [&nodes](std::uint32_t lhs, std::uint32_t rhs) {
+                return nodes[lhs].inclusive > nodes[rhs].inclusive;
+            });
+
+            for(auto const kid : kids)
+            {
+                auto const& n = nodes[kid];
+                auto const& r = regions.get(n.region);
+                std::fprintf(
+                    file,
+                    "  %12" PRIu64 " %16.9f %16.9f",
+                    n.calls,
+                    static_cast<double>(n.inclusive) * 1e-9,
+                    static_cast<double>(n.inclusive - n.children) * 1e-9);
+
+                // The quantiles of a single call (not summed over threads)
+                if(m_tree.sketches())
+                {
+                    for(auto const q : {0.5, 0.9, 0.99, 0.999})
+                        std::fprintf(file, " %14.9f", n.latencies ? n.latencies->quantile(q) * 1e-9 : 0.0);
+                }
+
+                // Inclusive counts, summed over all threads
+                for(auto i = std::size_t{0u}; i < m_counter_names.size(); ++i)
+                    std::fprintf(file, " %*" PRIu64, column_width(m_counter_names[i]), n.counters[i]);
+                for(auto const& r : m_ratios)
+                {
+                    auto const numerator = static_cast<double>(n.counters[r.numerator]);
+                    auto const denominator = static_cast<double>(
+                        r.denominator == wall_time ? static_cast<std::uint64_t>(n.inclusive)
+                                                   : n.counters[r.denominator]);
+                    std::fprintf(file, " %12.3f", denominator != 0.0 ? r.factor * numerator / denominator : 0.0);
+                }
+
+                std::fprintf(
+                    file,
+                    "  %*s%s [%s]%s\n",
+                    static_cast<int>(2u * depth),
+                    "",
+                    r.name.c_str(),
+                    type_name(r.type),
+                    (instance_suffix(n.instance) + (n.timed < n.calls ? " (throttled)" : "")).c_str());
+
+                write_children(file, kid, depth + 1u);
+            }
+        }
+
+        // Allocations, frees and bytes are attributed to the innermost region, i.e. they are exclusive counts
+        auto write_allocations(std::FILE* file, std::size_t first) const -> void
+        {
+            struct allocation_summary
+            {
+                std::uint32_t region;
+                std::uint64_t calls;
+                std::array<std::uint64_t, 4u> counts;
+            };
+
+            auto const& nodes = m_tree.nodes();
+            auto summaries = std::map<std::uint32_t, allocation_summary>{};
+            for(auto i = std::size_t{1u}; i < nodes.size(); ++i)
+            {
+                auto const& n = nodes[i];
+                auto& summary = summaries.emplace(n.region, allocation_summary{n.region, 0u, {}}).first->second;
+                summary.calls += n.calls;
+                for(auto k = std::size_t{0u}; k < summary.counts.size(); ++k)
+                {
+                    auto exclusive = n.counters[first + k];
+                    for(auto const kid : n.kids)
+                        exclusive -= nodes[kid].counters[first + k];
+                    summary.counts[k] += exclusive;
+                }
+            }
+
+            auto sorted = std::vector<allocation_summary>{};
+            for(auto const& entry : summaries)
+            {
+                if(entry.second.counts[0] != 0u || entry.second.counts[1] != 0u)
+                    sorted.push_back(entry.second);
+            }
+            std::sort(sorted.begin(), sorted.end(), [](allocation_summary const& lhs, allocation_summary const& rhs) {
+                return lhs.counts[2] > rhs.counts[2];
+            });
+
+            std::fprintf(file, "\n# Heap allocations of the innermost sector or phase, summed over all threads.\n");
+            std::fprintf(
+                file,
+                "# Largest peak of live heap memory of a single thread: %" PRId64 " bytes\n",
+                m_peak_bytes);
+            std::fprintf(
+                file,
+                "# %14s %14s %18s %18s %14s  %s\n",
+                "allocations",
+                "frees",
+                "allocated_bytes",
+                "freed_bytes",
+                "allocs/call",
+                "region");
+            for(auto const& summary : sorted)
+            {
+                auto const& r = regions.get(summary.region);
+                std::fprintf(
+                    file,
+                    "  %14" PRIu64 " %14" PRIu64 " %18" PRIu64 " %18" PRIu64 " %14.3f  %s [%s]\n",
+                    summary.counts[0],
+                    summary.counts[1],
+                    summary.counts[2],
+                    summary.counts[3],
+                    static_cast<double>(summary.counts[0]) / static_cast<double>(summary.calls),
+                    r.name.c_str(),
+                    type_name(r.type));
+            }
+        }
+
+        /* Work is related to the time spent in the region, summed over all threads. The rates are thus the average
+         * rates of a single thread. Recursive calls are only counted once. */
+        auto write_work(std::FILE* file) const -> void
+        {
+            struct work_summary
+            {
+                std::uint64_t calls{0u};
+                std::int64_t inclusive{0};
+                std::array<std::uint64_t, bactria::metrics::native::work_types> work{};
+            };
+
+            auto const& nodes = m_tree.nodes();
+            auto summaries = std::map<std::uint32_t, work_summary>{};
+            for(auto i = std::size_t{1u}; i < nodes.size(); ++i)
+            {
+                auto const& n = nodes[i];
+                auto recursive = false;
+                for(auto parent = n.parent; parent != call_tree::root && !recursive; parent = nodes[parent].parent)
+                    recursive = nodes[parent].region == n.region;
+
+                auto& summary = summaries[n.region];
+                for(auto k = std::size_t{0u}; k < n.work.size(); ++k)
+                    summary.work[k] += n.work[k];
+                if(!recursive)
+                {
+                    summary.calls += n.calls;
+                    summary.inclusive += n.inclusive;
+                }
+            }
+
+            auto const has_work = [](work_summary const& summary) {
+                return std::any_of(summary.work.begin(), summary.work.end(), [](std::uint64_t w) { return w != 0u; });
+            };
+            if(std::none_of(summaries.begin(), summaries.end(), [&](auto const& entry) {
+                   return has_work(entry.second);
+               }))
+                return;
+
+            std::fprintf(file, "\n# Work per region. Rates are per thread: the work divided by the inclusive time.\n");
+            std::fprintf(
+                file,
+                "# %18s %18s %18s %18s %12s %12s %12s %12s  %s\n",
+                "bytes_read",
+                "bytes_written",
+                "flops",
+                "items",
+                "GB/s",
+                "GFLOP/s",
+                "Mitems/s",
+                "FLOP/byte",
+                "region");
+
+            for(auto const& entry : summaries)
+            {
+                auto const& summary = entry.second;
+                if(!has_work(summary))
+                    continue;
+
+                auto const bytes = static_cast<double>(summary.work[0] + summary.work[1]);
+                auto const flops = static_cast<double>(summary.work[2]);
+                auto const items = static_cast<double>(summary.work[3]);
+                auto const seconds = static_cast<double>(summary.inclusive) * 1e-9;
+                auto const rate = [seconds](double amount, double unit) {
+                    return seconds > 0.0 ? amount / seconds / unit : 0.0;
+                };
+
+                auto const& r = regions.get(entry.first);
+                std::fprintf(
+                    file,
+                    "  %18" PRIu64 " %18" PRIu64 " %18" PRIu64 " %18" PRIu64 " %12.3f %12.3f %12.3f %12.3f  %s [%s]\n",
+                    summary.work[0],
+                    summary.work[1],
+                    summary.work[2],
+                    summary.work[3],
+                    rate(bytes, 1e9),
+                    rate(flops, 1e9),
+                    rate(items, 1e6),
+                    bytes > 0.0 ? flops / bytes : 0.0,
+                    r.name.c_str(),
+                    type_name(r.type));
+            }
+        }
+
+        /* Throttled regions are reported with the calls and timed calls summed over all threads and call paths. The
+         * overhead estimate assumes that untimed calls are free. */
+        auto write_throttling(std::FILE* file) const -> void
+        {
+            struct throttle_summary
+            {
+                std::uint64_t calls{0u};
+                std::uint64_t timed{0u};
+                std::int64_t inclusive{0};
+            };
+
+            auto const& nodes = m_tree.nodes();
+            auto summaries = std::map<std::uint32_t, throttle_summary>{};
+            auto timed = std::uint64_t{0u};
+            auto calls = std::uint64_t{0u};
+            for(auto i = std::size_t{1u}; i < nodes.size(); ++i)
+            {
+                auto const& n = nodes[i];
+                timed += n.timed;
+                calls += n.calls;
+                if(n.timed == n.calls)
+                    continue;
+
+                auto& summary = summaries[n.region];
+                summary.calls += n.calls;
+                summary.timed += n.timed;
+                summary.inclusive += n.inclusive;
+            }
+
+            auto const& config = bactria::metrics::native::get_configuration();
+            auto const overhead = static_cast<double>(m_overhead) / static_cast<double>(m_threads) * 1e-9;
+            std::fprintf(
+                file,
+                "\n# Throttling: sectors with a mean duration below %.1f times the overhead of %.9f s per call.\n",
+                config.throttle_overhead_factor,
+                overhead);
+            std::fprintf(
+                file,
+                "# Overhead of the timed calls: %.9f s, %.9f s if all calls had been timed.\n",
+                static_cast<double>(timed) * overhead,
+                static_cast<double>(calls) * overhead);
+            if(summaries.empty())
+                return;
+
+            // Sampled times are extrapolated to all calls, otherwise they only cover the calls before throttling
+            if(config.throttle_period != 0)
+                std::fprintf(
+                    file,
+                    "# Every %" PRId64 "th call of a throttled sector is timed.\n",
+                    config.throttle_period);
+            else
+                std::fprintf(file, "# Throttled sectors are only counted; their times cover the timed calls.\n");
+            std::fprintf(file, "# %12s %12s %16s  %s\n", "calls", "timed", "mean", "region");
+            for(auto const& entry : summaries)
+            {
+                auto const& summary = entry.second;
+                auto const divisor = config.throttle_period != 0 ? summary.calls : summary.timed;
+                auto const& r = regions.get(entry.first);
+                std::fprintf(
+                    file,
+                    "  %12" PRIu64 " %12" PRIu64 " %16.9f  %s [%s]\n",
+                    summary.calls,
+                    summary.timed,
+                    divisor != 0u ? static_cast<double>(summary.inclusive) / static_cast<double>(divisor) * 1e-9 : 0.0,
+                    r.name.c_str(),
+                    type_name(r.type));
+            }
+        }
+
+        /* Every sector is attributed to its innermost enclosing phase (or phase instance). Recursive calls of a
+         * sector are only counted once. */
+        auto write_phase_comparison(std::FILE* file) const -> void
+        {
+            struct cell
+            {
+                std::uint64_t calls{0u};
+                std::int64_t inclusive{0};
+            };
+
+            using phase_key = std::pair<std::uint32_t, std::uint32_t>; // region, instance
+            auto const no_phase = phase_key{call_tree::no_region, 0u};
+
+            auto const& nodes = m_tree.nodes();
+            auto cells = std::map<std::uint32_t, std::map<phase_key, cell>>{};
+            auto phases = std::map<phase_key, std::string>{};
+            for(auto i = std::size_t{1u}; i < nodes.size(); ++i)
+            {
+                auto const& n = nodes[i];
+                if(regions.get(n.region).type == bactria::metrics::native::phase_type)
+                    continue;
+
+                auto parent = n.parent;
+                auto recursive = false;
+                while(parent != call_tree::root
+                      && regions.get(nodes[parent].region).type != bactria::metrics::native::phase_type)
+                {
+                    recursive = recursive || nodes[parent].region == n.region;
+                    parent = nodes[parent].parent;
+                }
+                if(recursive)
+                    continue;
+
+                auto const key = (parent == call_tree::root)
+                                     ? no_phase
+                                     : phase_key{nodes[parent].region, nodes[parent].instance};
+                if(key == no_phase)
+                    phases.emplace(key, "(no phase)");
+                else
+                    phases.emplace(key, regions.get(key.first).name + instance_suffix(key.second));
+
+                auto& c = cells[n.region][key];
+                c.calls += n.calls;
+                c.inclusive += n.inclusive;
+            }
+
+            // Without phases there is nothing to compare
+            if(phases.empty() || (phases.size() == 1u && phases.begin()->first == no_phase))
+                return;
+
+            // The most expensive sectors come first
+            auto rows = std::vector<std::pair<std::int64_t, std::uint32_t>>{};
+            for(auto const& row : cells)
+            {
+                auto total = std::int64_t{0};
+                for(auto const& c : row.second)
+                    total += c.second.inclusive;
+                rows.emplace_back(total, row.first);
+            }
+            std::sort(rows.begin(), rows.end(), [](auto const& lhs, auto const& rhs) {
+                return lhs.first > rhs.first;
+            });
+
+            auto const write_table = [&](char const* title, bool calls) {
+                std::fprintf(file, "\n# Phase comparison: %s of every sector in its innermost phase.\n", title);
+                std::fprintf(file, "#");
+                for(auto const& phase : phases)
+                    std::fprintf(file, " %*s", column_width(phase.second), phase.second.c_str());
+                std::fprintf(file, "  %s\n", "region");
+
+                for(auto const& row : rows)
+                {
+                    auto const& row_cells = cells.at(row.second);
+                    std::fprintf(file, " ");
+                    for(auto const& phase : phases)
+                    {
+                        auto const width = column_width(phase.second);
+                        auto const it = row_cells.find(phase.first);
+                        if(it == row_cells.end())
+                            std::fprintf(file, " %*s", width, "-");
+                        else if(calls)
+                            std::fprintf(file, " %*" PRIu64, width, it->second.calls);
+                        else
+                            std::fprintf(file, " %*.9f", width, static_cast<double>(it->second.inclusive) * 1e-9);
+                    }
+
+                    auto const& r = regions.get(row.second);
+                    std::fprintf(file, "  %s [%s]\n", r.name.c_str(), type_name(r.type));
+                }
+            };
+
+            write_table("inclusive seconds", false);
+            write_table("calls", true);
+        }
+
+        std::mutex m_mutex;
+        call_tree m_tree;
+        std::size_t m_threads{0u};
+        std::int64_t m_peak_bytes{-1};
+        // Summed over all threads
+        std::int64_t m_overhead{0};
+        std::vector<std::string> m_counter_names{bactria::metrics::native::counter_names()};
+        std::vector<ratio> m_ratios{derived_ratios(m_counter_names)};
+    };
+
+    process_profile profile;
+
+    // Merges the thread's tree into the process profile on thread exit
+    struct thread_state
+    {
+        bactria::metrics::native::thread_counters counters;
+        call_tree tree;
+        bactria::metrics::native::snapshot_slot snapshot;
+
+        thread_state()
+        {
+            if(bactria::metrics::native::get_configuration().throttle_enable)
+                tree.set_overhead(bactria::metrics::native::calibrate(counters));
+        }
+
+        thread_state(thread_state const&) = delete;
+        auto operator=(thread_state const&) -> thread_state& = delete;
+
+        ~thread_state()
+        {
+            bactria::metrics::native::allocation_guard const guard;
+            auto values = bactria::metrics::native::counter_values{};
+            counters.read(values);
+            tree.leave_all(bactria::metrics::native::now(), values, bactria::metrics::native::live_close);
+
+            // Snapshots must see the tree either in the thread's slot or in the profile, never in both or neither
+            auto const stats = bactria::metrics::native::thread_allocation_stats();
+            std::lock_guard<std::mutex> const lock{bactria::metrics::native::snapshot_mutex()};
+            profile.add(tree, stats != nullptr ? stats->peak_bytes : -1);
+            snapshot.detach();
+        }
+    };
+
+    auto this_thread_state() -> thread_state&
+    {
+        thread_local thread_state state;
+        return state;
+    }
+} // namespace
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            auto intern_region(char const* name, std::uint32_t type) -> region const*
+            {
+                return regions.intern(name, type);
+            }
+
+            auto get_region(std::uint32_t id) -> region const&
+            {
+                return regions.get(id);
+            }
+
+            auto type_name(std::uint32_t type) noexcept -> char const*
+            {
+                // See Tags.hpp
+                switch(type)
+                {
+                case phase_type:
+                    return "Phase";
+                case 1u:
+                    return "Generic";
+                case 2u:
+                    return "Function";
+                case 3u:
+                    return "Loop";
+                case 4u:
+                    return "Body";
+                default:
+                    return "User";
+                }
+            }
+
+            auto now() noexcept -> std::int64_t
+            {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+            }
+
+            call_tree::call_tree()
+                : m_counters{counter_names().size()}
+                , m_sketches{get_configuration().sketch_enable}
+                , m_sketch_accuracy{get_configuration().sketch_relative_accuracy}
+                , m_throttle_factor{get_configuration().throttle_overhead_factor}
+                , m_throttle_min_calls{static_cast<std::uint64_t>(get_configuration().throttle_min_calls)}
+                , m_throttle_period{static_cast<std::uint32_t>(get_configuration().throttle_period)}
+            {
+                // Nodes are move-only, so they can't be put into an initializer list
+                m_nodes.push_back(node{no_region, root});
+                m_stack.reserve(64u);
+            }
+
+            auto call_tree::enter(
+                std::uint32_t region_id,
+                std::int64_t timestamp,
+                counter_values const& counters,
+                std::uint32_t instance,
+                std::uint32_t weight) -> void
+            {
+                auto const parent = m_stack.empty() ? root : m_stack.back().node;
+                m_stack.push_back(frame{child(parent, region_id, instance), weight, timestamp, counters});
+            }
+
+            auto call_tree::enter_untimed(std::uint32_t region_id) -> void
+            {
+                auto const parent = m_stack.empty() ? root : m_stack.back().node;
+                m_stack.push_back(frame{child(parent, region_id, 0u), 0u, 0, counter_values{}});
+            }
+
+            auto call_tree::leave_untimed(std::uint32_t region_id) noexcept -> bool
+            {
+                if(m_stack.empty() || m_stack.back().weight != 0u || m_nodes[m_stack.back().node].region != region_id)
+                    return false;
+
+                ++m_nodes[m_stack.back().node].calls;
+                m_stack.pop_back();
+                return true;
+            }
+
+            auto call_tree::observe(std::uint32_t region_id, std::int64_t duration) -> void
+            {
+                if(region_id >= m_throttles.size())
+                    m_throttles.resize(region_id + 1u);
+
+                auto& t = m_throttles[region_id];
+                if(t.throttled)
+                    return;
+
+                ++t.timed;
+                t.total += duration;
+                if(t.timed < m_throttle_min_calls)
+                    return;
+
+                // The decision is final: a throttled sector no longer has unbiased durations to reconsider it
+                auto const mean = static_cast<double>(t.total) / static_cast<double>(t.timed);
+                if(mean < m_throttle_factor * static_cast<double>(m_overhead.total))
+                {
+                    t.throttled = true;
+                    t.countdown = m_throttle_period;
+                }
+                else
+                {
+                    t.timed = 0u;
+                    t.total = 0;
+                }
+            }
+
+            auto call_tree::next_instance(std::uint32_t region_id) -> std::uint32_t
+            {
+                if(region_id >= m_instances.size())
+                    m_instances.resize(region_id + 1u, 0u);
+
+                return ++m_instances[region_id];
+            }
+
+            auto call_tree::leave(
+                std::uint32_t region_id,
+                std::int64_t timestamp,
+                counter_values const& counters,
+                close_hook on_close) -> std::int64_t
+            {
+                // Regions entered after region_id which haven't been left yet are closed as well
+                auto const it = std::find_if(
+                    m_stack.rbegin(),
+                    m_stack.rend(),
+                    [this, region_id](frame const& f) { return m_nodes[f.node].region == region_id; });
+                if(it == m_stack.rend())
+                    return -1;
+
+                auto const depth = static_cast<std::size_t>(std::distance(it, m_stack.rend())) - 1u;
+                return unwind(depth, timestamp, counters, on_close);
+            }
+
+            auto call_tree::add_work(std::uint32_t region_id, std::uint32_t type, std::uint64_t amount) noexcept
+                -> bool
+            {
+                if(type >= work_types)
+                    return false;
+
+                for(auto it = m_stack.rbegin(); it != m_stack.rend(); ++it)
+                {
+                    auto& n = m_nodes[it->node];
+                    if(n.region == region_id)
+                    {
+                        n.work[type] += amount;
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            auto call_tree::leave_all(std::int64_t timestamp, counter_values const& counters, close_hook on_close)
+                -> void
+            {
+                unwind(0u, timestamp, counters, on_close);
+            }
+
+            auto call_tree::unwind(
+                std::size_t depth,
+                std::int64_t timestamp,
+                counter_values const& counters,
+                close_hook on_close) -> std::int64_t
+            {
+                auto duration = std::int64_t{-1};
+                while(m_stack.size() > depth)
+                {
+                    auto const f = m_stack.back();
+                    m_stack.pop_back();
+
+                    auto& n = m_nodes[f.node];
+                    ++n.calls;
+
+                    // Untimed entries of throttled regions are only counted
+                    if(f.weight == 0u)
+                    {
+                        duration = -1;
+                        if(on_close != nullptr)
+                            on_close(n.region, duration);
+                        continue;
+                    }
+
+                    /* A throttled region's sample stands for all entries since the previous sample. Those didn't pay
+                     * for the clock and counter reads within the sample. */
+                    duration = timestamp - f.start;
+                    auto const scaled
+                        = duration + std::max(duration - m_overhead.inclusive, std::int64_t{0}) * (f.weight - 1u);
+                    ++n.timed;
+                    n.inclusive += scaled;
+                    m_nodes[n.parent].children += scaled;
+
+                    for(auto i = std::size_t{0u}; i < m_counters; ++i)
+                        n.counters[i] += (counters[i] - f.counters[i]) * f.weight;
+
+                    if(m_sketches)
+                    {
+                        if(!n.latencies)
+                            n.latencies = std::make_unique<duration_stats>(m_sketch_accuracy);
+                        n.latencies->add(duration);
+                    }
+
+                    if(on_close != nullptr)
+                        on_close(n.region, duration);
+                }
+
+                return duration;
+            }
+
+            auto call_tree::merge(call_tree const& other) -> void
+            {
+                merge(root, other, root);
+            }
+
+            auto call_tree::accumulate(std::vector<region_totals>& totals, std::int64_t timestamp) const -> void
+            {
+                auto const at = [&totals](std::uint32_t region_id) -> region_totals& {
+                    if(region_id >= totals.size())
+                        totals.resize(region_id + 1u);
+                    return totals[region_id];
+                };
+
+                for(auto i = std::size_t{1u}; i < m_nodes.size(); ++i)
+                {
+                    auto const& n = m_nodes[i];
+                    auto recursive = false;
+                    for(auto parent = n.parent; parent != root && !recursive; parent = m_nodes[parent].parent)
+                        recursive = m_nodes[parent].region == n.region;
+
+                    auto& t = at(n.region);
+                    t.calls += n.calls;
+                    t.exclusive += n.inclusive - n.children;
+                    if(!recursive)
+                        t.inclusive += n.inclusive;
+                }
+
+                /* Long-running regions such as phases would otherwise only show up after they have been left. The
+                 * time of an entered region is exclusive until its entered child region begins. */
+                for(auto f = m_stack.begin(); f != m_stack.end(); ++f)
+                {
+                    if(f->weight == 0u)
+                        continue;
+
+                    auto const region_id = m_nodes[f->node].region;
+                    auto const elapsed = timestamp - f->start;
+                    auto const outer = std::find_if(m_stack.begin(), f, [this, region_id](frame const& g) {
+                        return m_nodes[g.node].region == region_id;
+                    });
+                    if(outer == f)
+                        at(region_id).inclusive += elapsed;
+
+                    at(region_id).exclusive += elapsed;
+                    if(f != m_stack.begin() && std::prev(f)->weight != 0u)
+                        at(m_nodes[std::prev(f)->node].region).exclusive -= elapsed;
+                }
+            }
+
+            auto call_tree::quantile(std::uint32_t region_id, double q) const -> double
+            {
+                // A region can appear on several call paths
+                auto stats = duration_stats{m_sketch_accuracy};
+                for(auto const& n : m_nodes)
+                {
+                    if(n.region == region_id && n.latencies)
+                        stats.merge(*n.latencies);
+                }
+
+                return stats.count() != 0u ? stats.quantile(q) : std::numeric_limits<double>::quiet_NaN();
+            }
+
+            auto call_tree::child(std::uint32_t parent, std::uint32_t region_id, std::uint32_t instance)
+                -> std::uint32_t
+            {
+                // Call trees are narrow, a linear search is faster than any map
+                for(auto const kid : m_nodes[parent].kids)
+                {
+                    if(m_nodes[kid].region == region_id && m_nodes[kid].instance == instance)
+                        return kid;
+                }
+
+                auto const kid = static_cast<std::uint32_t>(m_nodes.size());
+                m_nodes.push_back(node{region_id, parent, instance});
+                m_nodes[parent].kids.push_back(kid);
+                return kid;
+            }
+
+            auto call_tree::merge(std::uint32_t dst, call_tree const& other, std::uint32_t src) -> void
+            {
+                for(auto const src_kid : other.m_nodes[src].kids)
+                {
+                    auto const& from = other.m_nodes[src_kid];
+                    auto const dst_kid = child(dst, from.region, from.instance);
+
+                    auto& to = m_nodes[dst_kid];
+                    to.calls += from.calls;
+                    to.timed += from.timed;
+                    to.inclusive += from.inclusive;
+                    to.children += from.children;
+                    for(auto i = std::size_t{0u}; i < m_counters; ++i)
+                        to.counters[i] += from.counters[i];
+                    for(auto i = std::size_t{0u}; i < work_types; ++i)
+                        to.work[i] += from.work[i];
+
+                    if(from.latencies)
+                    {
+                        if(to.latencies)
+                            to.latencies->merge(*from.latencies);
+                        else
+                            to.latencies = std::make_unique<duration_stats>(*from.latencies);
+                    }
+
+                    merge(dst_kid, other, src_kid);
+                }
+            }
+
+            auto calibrate(thread_counters const& counters) -> instrumentation_overhead
+            {
+                constexpr auto rounds = std::int64_t{1000};
+
+                // A scratch tree keeps the calibration out of the profile. The sector is empty like in the plugin.
+                auto tree = call_tree{};
+                auto values = counter_values{};
+                auto inclusive = std::int64_t{0};
+                auto const start = now();
+                for(auto i = std::int64_t{0}; i < rounds; ++i)
+                {
+                    auto const timestamp = now();
+                    counters.read(values);
+                    tree.enter(0u, timestamp, values);
+                    counters.read(values);
+                    inclusive += tree.leave(0u, now(), values);
+                }
+
+                return instrumentation_overhead{(now() - start) / rounds, inclusive / rounds};
+            }
+
+            auto thread_tree() -> call_tree&
+            {
+                return this_thread_state().tree;
+            }
+
+            auto this_thread_snapshot() -> snapshot_slot&
+            {
+                return this_thread_state().snapshot;
+            }
+
+            auto accumulate_exited_threads(std::vector<region_totals>& totals) -> std::size_t
+            {
+                return profile.accumulate(totals);
+            }
+
+            auto this_thread_counters() -> thread_counters const&
+            {
+                return this_thread_state().counters;
+            }
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
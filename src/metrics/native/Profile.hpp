@@ -0,0 +1,248 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#pragma once
+
+#include "Counters.hpp"
+#include "Sketch.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            // bytes_read, bytes_written, flops, items; see Work.hpp
+            constexpr auto work_types = std::size_t{4u};
+
+            // Phases share the call path with sectors; they are told apart by this pseudo tag
+            constexpr auto phase_type = std::uint32_t{0u};
+
+            /* All sectors (and phases) with the same name and type are the same region, no matter how many bactria
+             * objects refer to them. The region's address is the plugin handle. Regions live until the plugin is
+             * unloaded. */
+            struct region
+            {
+                std::string name;
+                std::uint32_t type;
+                std::uint32_t id;
+            };
+
+            auto intern_region(char const* name, std::uint32_t type) -> region const*;
+
+            auto get_region(std::uint32_t id) -> region const&;
+
+            // The name of a sector tag or "Phase"
+            auto type_name(std::uint32_t type) noexcept -> char const*;
+
+            // Nanoseconds of the steady clock
+            auto now() noexcept -> std::int64_t;
+
+            struct node
+            {
+                std::uint32_t region;
+                std::uint32_t parent;
+                // Non-zero for phases which are profiled per instance, see call_tree::next_instance()
+                std::uint32_t instance{0u};
+                std::uint64_t calls{0u};
+                // Calls whose duration was measured; less than calls if the region was throttled
+                std::uint64_t timed{0u};
+                std::int64_t inclusive{0};
+                std::int64_t children{0};
+                std::vector<std::uint32_t> kids{};
+                // Inclusive deltas, in the order of counter_names()
+                counter_values counters{};
+                // Work added by Sector::add_work(), indexed by bactria::metrics::work_type
+                std::array<std::uint64_t, work_types> work{};
+                // Only allocated if sketch.enable is set
+                std::unique_ptr<duration_stats> latencies{};
+            };
+
+            /* The cost of entering and leaving a sector in nanoseconds, including the clock and counter reads. Part of
+             * it falls between the two clock reads and is thus included in the sector's own time. */
+            struct instrumentation_overhead
+            {
+                std::int64_t total{0};
+                std::int64_t inclusive{0};
+            };
+
+            // The statistics of a region summed over all of its call paths. Recursive calls add to the time once.
+            struct region_totals
+            {
+                std::uint64_t calls{0u};
+                std::int64_t inclusive{0};
+                std::int64_t exclusive{0};
+            };
+
+            /* One call-path tree per thread. Entering a region descends to the child node of the current node for
+             * that region, leaving it ascends again. The root node doesn't belong to any region. */
+            class call_tree
+            {
+            public:
+                static constexpr auto root = std::uint32_t{0u};
+                static constexpr auto no_region = ~std::uint32_t{0u};
+
+                call_tree();
+
+                /* Entries of the same region with different instances get separate nodes. The time and counter
+                 * deltas of the entry are multiplied by weight, see weight(). */
+                auto enter(
+                    std::uint32_t region_id,
+                    std::int64_t timestamp,
+                    counter_values const& counters,
+                    std::uint32_t instance = 0u,
+                    std::uint32_t weight = 1u) -> void;
+
+                // Enters the region without measuring it, the entry is only counted
+                auto enter_untimed(std::uint32_t region_id) -> void;
+
+                // Leaves the region if its innermost entry is untimed and on top of the stack
+                auto leave_untimed(std::uint32_t region_id) noexcept -> bool;
+
+                /* Called for every region closed by leave() or leave_all() with the time spent in it, or a negative
+                 * value if the entry wasn't timed. */
+                using close_hook = void (*)(std::uint32_t region_id, std::int64_t duration);
+
+                /* Returns the time spent in the region or a negative value if the region wasn't entered. Regions
+                 * entered after it are closed as well and reported to on_close, like the region itself. */
+                auto leave(
+                    std::uint32_t region_id,
+                    std::int64_t timestamp,
+                    counter_values const& counters,
+                    close_hook on_close = nullptr) -> std::int64_t;
+
+                // Adds the work to the innermost entry of the region. Returns false if the region isn't entered.
+                auto add_work(std::uint32_t region_id, std::uint32_t type, std::uint64_t amount) noexcept -> bool;
+
+                // Closes all regions which are still entered
+                auto leave_all(std::int64_t timestamp, counter_values const& counters, close_hook on_close = nullptr)
+                    -> void;
+
+                // Adds the nodes of other to the nodes with the same call path in this
+                auto merge(call_tree const& other) -> void;
+
+                /* Adds the tree's statistics to totals, which is indexed by region ID and grown as needed. Regions
+                 * which are still entered add their time up to timestamp to the inclusive time. */
+                auto accumulate(std::vector<region_totals>& totals, std::int64_t timestamp) const -> void;
+
+                /* The q quantile of the region's durations in nanoseconds, over all call paths of this tree. NaN if
+                 * sketches are disabled or the region hasn't been left yet. */
+                auto quantile(std::uint32_t region_id, double q) const -> double;
+
+                // Counts the entries of the region on this tree's thread, starting at 1
+                auto next_instance(std::uint32_t region_id) -> std::uint32_t;
+
+                /* The weight of the region's next entry: 1 if it is timed as usual, 0 if the region is throttled and
+                 * the entry is only counted, and throttle.period if it is a throttled region's sample which stands
+                 * for the untimed entries since the previous one. */
+                auto weight(std::uint32_t region_id) noexcept -> std::uint32_t
+                {
+                    if(region_id >= m_throttles.size() || !m_throttles[region_id].throttled)
+                        return 1u;
+
+                    auto& t = m_throttles[region_id];
+                    if(m_throttle_period == 0u || --t.countdown != 0u)
+                        return 0u;
+
+                    t.countdown = m_throttle_period;
+                    return m_throttle_period;
+                }
+
+                /* Feeds a duration of an unthrottled entry of the region into the throttling decision. Only called
+                 * for sectors; phases are never throttled. */
+                auto observe(std::uint32_t region_id, std::int64_t duration) -> void;
+
+                // Measured by calibrate(); zero unless throttle.enable is set
+                auto overhead() const noexcept -> instrumentation_overhead const&
+                {
+                    return m_overhead;
+                }
+
+                auto set_overhead(instrumentation_overhead const& overhead) noexcept -> void
+                {
+                    m_overhead = overhead;
+                }
+
+                auto sketches() const noexcept -> bool
+                {
+                    return m_sketches;
+                }
+
+                auto nodes() const noexcept -> std::vector<node> const&
+                {
+                    return m_nodes;
+                }
+
+            private:
+                auto child(std::uint32_t parent, std::uint32_t region_id, std::uint32_t instance) -> std::uint32_t;
+                auto merge(std::uint32_t dst, call_tree const& other, std::uint32_t src) -> void;
+                auto unwind(
+                    std::size_t depth,
+                    std::int64_t timestamp,
+                    counter_values const& counters,
+                    close_hook on_close) -> std::int64_t;
+
+                struct frame
+                {
+                    std::uint32_t node;
+                    std::uint32_t weight;
+                    std::int64_t start;
+                    counter_values counters;
+                };
+
+                struct throttle
+                {
+                    std::uint64_t timed{0u};
+                    std::int64_t total{0};
+                    std::uint32_t countdown{0u};
+                    bool throttled{false};
+                };
+
+                std::vector<node> m_nodes;
+                std::vector<frame> m_stack;
+                std::vector<std::uint32_t> m_instances;
+                // Indexed by region ID, only grown if throttle.enable is set
+                std::vector<throttle> m_throttles;
+                std::size_t m_counters;
+                bool m_sketches;
+                double m_sketch_accuracy;
+                instrumentation_overhead m_overhead{};
+                double m_throttle_factor;
+                std::uint64_t m_throttle_min_calls;
+                std::uint32_t m_throttle_period;
+            };
+
+            // Measures the calling thread's overhead by entering and leaving a sector repeatedly
+            auto calibrate(thread_counters const& counters) -> instrumentation_overhead;
+
+            // The calling thread's tree. It is merged into the process profile when the thread exits.
+            auto thread_tree() -> call_tree&;
+
+            // Adds the trees of the threads which have already exited to totals and returns their number
+            auto accumulate_exited_threads(std::vector<region_totals>& totals) -> std::size_t;
+
+            // The calling thread's counters. They outlive the thread's tree.
+            auto this_thread_counters() -> thread_counters const&;
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
@@ -0,0 +1,210 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#include "Sketch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            sketch::sketch(double relative_accuracy)
+                : m_gamma{(1.0 + relative_accuracy) / (1.0 - relative_accuracy)}
+                , m_log_gamma{std::log(m_gamma)}
+            {
+            }
+
+            auto sketch::add(double value) -> void
+            {
+                ++m_count;
+
+                // Durations below one nanosecond can't be measured anyway
+                if(value < 1.0)
+                {
+                    ++m_zeros;
+                    return;
+                }
+
+                auto const k = key(value);
+                grow(k);
+                ++m_buckets[static_cast<std::size_t>(std::max(k - m_offset, 0))];
+            }
+
+            auto sketch::merge(sketch const& other) -> void
+            {
+                m_count += other.m_count;
+                m_zeros += other.m_zeros;
+
+                if(other.m_buckets.empty())
+                    return;
+
+                grow(other.m_offset);
+                grow(other.m_offset + static_cast<std::int32_t>(other.m_buckets.size()) - 1);
+                for(auto i = std::size_t{0u}; i < other.m_buckets.size(); ++i)
+                {
+                    auto const k = other.m_offset + static_cast<std::int32_t>(i);
+                    m_buckets[static_cast<std::size_t>(std::max(k - m_offset, 0))] += other.m_buckets[i];
+                }
+            }
+
+            auto sketch::clear() noexcept -> void
+            {
+                // Keep the buckets' memory for the next series
+                std::fill(m_buckets.begin(), m_buckets.end(), std::uint64_t{0u});
+                m_zeros = 0u;
+                m_count = 0u;
+            }
+
+            auto sketch::quantile(double q) const noexcept -> double
+            {
+                if(m_count == 0u)
+                    return 0.0;
+
+                auto const rank = static_cast<std::uint64_t>(q * static_cast<double>(m_count - 1u));
+                if(rank < m_zeros)
+                    return 0.0;
+
+                auto seen = m_zeros;
+                for(auto i = std::size_t{0u}; i < m_buckets.size(); ++i)
+                {
+                    seen += m_buckets[i];
+                    if(seen > rank)
+                        return value(m_offset + static_cast<std::int32_t>(i));
+                }
+
+                return value(m_offset + static_cast<std::int32_t>(m_buckets.size()) - 1);
+            }
+
+            auto sketch::key(double value) const noexcept -> std::int32_t
+            {
+                return static_cast<std::int32_t>(std::ceil(std::log(value) / m_log_gamma));
+            }
+
+            // The estimate with the smallest relative error for all values in the bucket
+            auto sketch::value(std::int32_t key) const noexcept -> double
+            {
+                return 2.0 * std::pow(m_gamma, static_cast<double>(key)) / (m_gamma + 1.0);
+            }
+
+            auto sketch::grow(std::int32_t key) -> void
+            {
+                if(m_buckets.empty())
+                {
+                    m_offset = key;
+                    m_buckets.resize(1u, 0u);
+                    return;
+                }
+
+                auto const last = m_offset + static_cast<std::int32_t>(m_buckets.size()) - 1;
+                if(key > last)
+                    m_buckets.resize(m_buckets.size() + static_cast<std::size_t>(key - last), 0u);
+                else if(key < m_offset)
+                {
+                    m_buckets.insert(m_buckets.begin(), static_cast<std::size_t>(m_offset - key), 0u);
+                    m_offset = key;
+                }
+
+                // Collapse the lowest buckets into one if the range becomes too wide
+                if(m_buckets.size() > max_buckets)
+                {
+                    auto const excess = m_buckets.size() - max_buckets;
+                    auto collapsed = std::uint64_t{0u};
+                    for(auto i = std::size_t{0u}; i <= excess; ++i)
+                        collapsed += m_buckets[i];
+
+                    m_buckets.erase(m_buckets.begin(), m_buckets.begin() + static_cast<std::ptrdiff_t>(excess));
+                    m_buckets.front() = collapsed;
+                    m_offset += static_cast<std::int32_t>(excess);
+                }
+            }
+
+            auto duration_stats::add(std::int64_t ns) -> void
+            {
+                auto const x = static_cast<double>(ns);
+
+                ++m_count;
+                if(m_count == 1u)
+                {
+                    m_min = x;
+                    m_max = x;
+                }
+                else
+                {
+                    m_min = std::min(m_min, x);
+                    m_max = std::max(m_max, x);
+                }
+
+                auto const delta = x - m_mean;
+                m_mean += delta / static_cast<double>(m_count);
+                m_m2 += delta * (x - m_mean);
+
+                m_sketch.add(x);
+            }
+
+            auto duration_stats::merge(duration_stats const& other) -> void
+            {
+                if(other.m_count == 0u)
+                    return;
+
+                if(m_count == 0u)
+                {
+                    *this = other;
+                    return;
+                }
+
+                auto const n_a = static_cast<double>(m_count);
+                auto const n_b = static_cast<double>(other.m_count);
+                auto const n = n_a + n_b;
+                auto const delta = other.m_mean - m_mean;
+
+                m_mean += delta * n_b / n;
+                m_m2 += other.m_m2 + delta * delta * n_a * n_b / n;
+                m_count += other.m_count;
+                m_min = std::min(m_min, other.m_min);
+                m_max = std::max(m_max, other.m_max);
+
+                m_sketch.merge(other.m_sketch);
+            }
+
+            auto duration_stats::clear() noexcept -> void
+            {
+                m_sketch.clear();
+                m_count = 0u;
+                m_min = 0.0;
+                m_max = 0.0;
+                m_mean = 0.0;
+                m_m2 = 0.0;
+            }
+
+            auto duration_stats::stddev() const noexcept -> double
+            {
+                return m_count > 1u ? std::sqrt(m_m2 / static_cast<double>(m_count - 1u)) : 0.0;
+            }
+
+            auto duration_stats::quantile(double q) const noexcept -> double
+            {
+                return std::min(std::max(m_sketch.quantile(q), m_min), m_max);
+            }
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
@@ -0,0 +1,114 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            /* A quantile sketch in the spirit of DDSketch (Masson et al., VLDB 2019). Values are counted in
+             * logarithmically sized buckets, so every quantile is reported with a relative error of at most
+             * relative_accuracy. Memory depends on the range of the values, not on their number; it is capped at
+             * max_buckets by merging the lowest buckets, which only affects the lowest quantiles. Sketches with the
+             * same accuracy can be merged. */
+            class sketch
+            {
+            public:
+                static constexpr auto max_buckets = std::size_t{2048u};
+
+                explicit sketch(double relative_accuracy = 0.01);
+
+                // Negative values are counted as zero
+                auto add(double value) -> void;
+                auto merge(sketch const& other) -> void;
+                auto clear() noexcept -> void;
+
+                auto count() const noexcept -> std::uint64_t
+                {
+                    return m_count;
+                }
+
+                // q in [0, 1]. Returns 0 for empty sketches.
+                auto quantile(double q) const noexcept -> double;
+
+            private:
+                auto key(double value) const noexcept -> std::int32_t;
+                auto value(std::int32_t key) const noexcept -> double;
+                auto grow(std::int32_t key) -> void;
+
+                double m_gamma;
+                double m_log_gamma;
+                std::vector<std::uint64_t> m_buckets{};
+                std::int32_t m_offset{0}; // key of m_buckets[0]
+                std::uint64_t m_zeros{0u};
+                std::uint64_t m_count{0u};
+            };
+
+            /* Streaming statistics of a series of durations: moments (Welford's algorithm, merged with Chan's
+             * formula) and a sketch for the quantiles. */
+            class duration_stats
+            {
+            public:
+                explicit duration_stats(double relative_accuracy = 0.01) : m_sketch{relative_accuracy}
+                {
+                }
+
+                auto add(std::int64_t ns) -> void;
+                auto merge(duration_stats const& other) -> void;
+                auto clear() noexcept -> void;
+
+                auto count() const noexcept -> std::uint64_t
+                {
+                    return m_count;
+                }
+
+                auto min() const noexcept -> double
+                {
+                    return m_min;
+                }
+
+                auto max() const noexcept -> double
+                {
+                    return m_max;
+                }
+
+                auto mean() const noexcept -> double
+                {
+                    return m_mean;
+                }
+
+                auto stddev() const noexcept -> double;
+
+                // Clamped to [min, max], which are exact
+                auto quantile(double q) const noexcept -> double;
+
+            private:
+                sketch m_sketch;
+                std::uint64_t m_count{0u};
+                double m_min{0.0};
+                double m_max{0.0};
+                double m_mean{0.0};
+                double m_m2{0.0};
+            };
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
@@ -0,0 +1,268 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#include "Snapshot.hpp"
+
+#include "Allocations.hpp"
+#include "Configuration.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    using bactria::metrics::native::region_totals;
+    using bactria::metrics::native::snapshot_slot;
+
+    auto attached_slots() -> std::vector<snapshot_slot*>&
+    {
+        static auto slots = std::vector<snapshot_slot*>{};
+        return slots;
+    }
+
+    auto add(std::vector<region_totals>& totals, std::vector<region_totals> const& other) -> void
+    {
+        if(other.size() > totals.size())
+            totals.resize(other.size());
+
+        for(auto i = std::size_t{0u}; i < other.size(); ++i)
+        {
+            totals[i].calls += other[i].calls;
+            totals[i].inclusive += other[i].inclusive;
+            totals[i].exclusive += other[i].exclusive;
+        }
+    }
+
+    /* Wakes up every snapshot.interval seconds, starts a new epoch, gives the threads a short grace period to publish
+     * their totals and appends the sum to the snapshot file. Threads which haven't left a sector or phase during the
+     * grace period contribute the totals they published last. */
+    class snapshot_writer
+    {
+    public:
+        snapshot_writer()
+            : m_path{
+                bactria::metrics::native::get_configuration().snapshot_base_name + "_" + std::to_string(getpid())
+                + ".txt"}
+            , m_thread{[this]() { run(); }}
+        {
+        }
+
+        snapshot_writer(snapshot_writer const&) = delete;
+        auto operator=(snapshot_writer const&) -> snapshot_writer& = delete;
+
+        ~snapshot_writer()
+        {
+            {
+                std::lock_guard<std::mutex> const lock{m_mutex};
+                m_stop = true;
+            }
+            m_cv.notify_one();
+            m_thread.join();
+        }
+
+    private:
+        auto run() -> void
+        {
+            bactria::metrics::native::allocation_guard const guard;
+
+            auto const& config = bactria::metrics::native::get_configuration();
+            auto const interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>{config.snapshot_interval});
+            auto const grace
+                = std::min<std::chrono::steady_clock::duration>(interval / 10, std::chrono::milliseconds{100});
+            auto const stopped = [this]() { return m_stop; };
+
+            auto lock = std::unique_lock<std::mutex>{m_mutex};
+            auto next = m_start + interval - grace;
+            while(!m_cv.wait_until(lock, next, stopped))
+            {
+                auto const epoch
+                    = bactria::metrics::native::snapshot_epoch().fetch_add(1u, std::memory_order_relaxed) + 1u;
+                if(m_cv.wait_for(lock, grace, stopped))
+                    break;
+
+                write(epoch, config.snapshot_mode == "delta");
+                next += interval;
+            }
+        }
+
+        auto write(std::uint64_t epoch, bool delta) -> void
+        {
+            auto totals = std::vector<region_totals>{};
+            auto threads = std::size_t{0u};
+            {
+                std::lock_guard<std::mutex> const lock{bactria::metrics::native::snapshot_mutex()};
+                threads = bactria::metrics::native::accumulate_exited_threads(totals);
+
+                // Only keep the cache of the slots which are still attached
+                auto cache = std::map<std::uint64_t, std::vector<region_totals>>{};
+                for(auto const slot : attached_slots())
+                {
+                    auto const published = slot->published(epoch);
+                    auto& cached = cache[slot->id()];
+                    if(published != nullptr)
+                        cached = *published;
+                    else
+                        cached = std::move(m_cache[slot->id()]);
+
+                    add(totals, cached);
+                    ++threads;
+                }
+                m_cache = std::move(cache);
+            }
+
+            auto const now = std::chrono::steady_clock::now();
+            auto const elapsed = std::chrono::duration<double>{now - m_start}.count();
+            auto const since = std::chrono::duration<double>{now - m_last}.count();
+            m_last = now;
+
+            auto rows = std::vector<std::pair<std::uint32_t, region_totals>>{};
+            for(auto i = std::size_t{0u}; i < totals.size(); ++i)
+            {
+                auto row = totals[i];
+                if(delta && i < m_previous.size())
+                {
+                    row.calls -= m_previous[i].calls;
+                    row.inclusive -= m_previous[i].inclusive;
+                    row.exclusive -= m_previous[i].exclusive;
+                }
+
+                if(row.calls != 0u || row.inclusive != 0)
+                    rows.emplace_back(static_cast<std::uint32_t>(i), row);
+            }
+            m_previous = std::move(totals);
+
+            // The most expensive regions come first
+            std::sort(rows.begin(), rows.end(), [](auto const& lhs, auto const& rhs) {
+                return lhs.second.inclusive > rhs.second.inclusive;
+            });
+
+            auto const file = std::fopen(m_path.c_str(), "a");
+            if(file == nullptr)
+            {
+                std::fprintf(stderr, "WARNING: bactria's native metrics plugin failed to open %s.\n", m_path.c_str());
+                return;
+            }
+
+            std::fprintf(file, "# snapshot %" PRIu64 " after %.3f s, %zu thread(s), ", epoch, elapsed, threads);
+            if(delta)
+                std::fprintf(file, "delta over the last %.3f s\n", since);
+            else
+                std::fprintf(file, "cumulative\n");
+            std::fprintf(file, "# %12s %16s %16s  %s\n", "calls", "inclusive", "exclusive", "region");
+            for(auto const& row : rows)
+            {
+                auto const& r = bactria::metrics::native::get_region(row.first);
+                std::fprintf(
+                    file,
+                    "  %12" PRIu64 " %16.9f %16.9f  %s [%s]\n",
+                    row.second.calls,
+                    static_cast<double>(row.second.inclusive) * 1e-9,
+                    static_cast<double>(row.second.exclusive) * 1e-9,
+                    r.name.c_str(),
+                    bactria::metrics::native::type_name(r.type));
+            }
+            std::fprintf(file, "\n");
+            std::fclose(file);
+        }
+
+        std::chrono::steady_clock::time_point const m_start{std::chrono::steady_clock::now()};
+        std::chrono::steady_clock::time_point m_last{m_start};
+        std::string m_path;
+        std::map<std::uint64_t, std::vector<region_totals>> m_cache{};
+        std::vector<region_totals> m_previous{};
+        std::mutex m_mutex{};
+        std::condition_variable m_cv{};
+        bool m_stop{false};
+        // Started last, after all members it uses have been initialized
+        std::thread m_thread;
+    };
+
+    // Started by the first thread which enters a sector or phase, stopped when the plugin is unloaded
+    auto start_writer() -> void
+    {
+        static snapshot_writer writer;
+    }
+} // namespace
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            auto snapshot_mutex() -> std::mutex&
+            {
+                static std::mutex mutex;
+                return mutex;
+            }
+
+            snapshot_slot::snapshot_slot()
+            {
+                if(!get_configuration().snapshot_enable)
+                    return;
+
+                static auto next_id = std::uint64_t{0u};
+
+                {
+                    std::lock_guard<std::mutex> const lock{snapshot_mutex()};
+                    m_id = ++next_id;
+                    attached_slots().push_back(this);
+                    m_attached = true;
+                }
+
+                start_writer();
+            }
+
+            snapshot_slot::~snapshot_slot()
+            {
+                if(m_attached)
+                {
+                    std::lock_guard<std::mutex> const lock{snapshot_mutex()};
+                    detach();
+                }
+            }
+
+            auto snapshot_slot::publish(call_tree const& tree, std::int64_t timestamp) -> void
+            {
+                auto const epoch = snapshot_epoch().load(std::memory_order_relaxed);
+                m_seen = epoch;
+
+                auto& buffer = m_buffers[epoch % 2u];
+                std::fill(buffer.begin(), buffer.end(), region_totals{});
+                tree.accumulate(buffer, timestamp);
+                m_published.store(epoch, std::memory_order_release);
+            }
+
+            auto snapshot_slot::detach() -> void
+            {
+                auto& slots = attached_slots();
+                slots.erase(std::remove(slots.begin(), slots.end(), this), slots.end());
+                m_attached = false;
+            }
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
@@ -0,0 +1,94 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#pragma once
+
+#include "Profile.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            // Incremented by the snapshot thread to ask every thread to publish its totals
+            inline auto snapshot_epoch() noexcept -> std::atomic<std::uint64_t>&
+            {
+                static std::atomic<std::uint64_t> epoch{0u};
+                return epoch;
+            }
+
+            /* Guards the set of attached slots. Exiting threads hold it while they hand their tree over from their
+             * slot to the process profile. Sectors and phases never take it. */
+            auto snapshot_mutex() -> std::mutex&;
+
+            /* The totals a thread publishes for the snapshot thread. The thread publishes into buffer (epoch % 2)
+             * when it notices a new epoch. The snapshot thread reads that buffer only if it has been published for
+             * the current epoch, and it only starts the next epoch (which lets the thread write the other buffer)
+             * once it is done reading. A thread writes a buffer again two epochs later, so neither side ever waits
+             * for the other. */
+            class snapshot_slot
+            {
+            public:
+                // Attaches the slot if snapshot.enable is set and starts the snapshot thread if necessary
+                snapshot_slot();
+                snapshot_slot(snapshot_slot const&) = delete;
+                auto operator=(snapshot_slot const&) -> snapshot_slot& = delete;
+                ~snapshot_slot();
+
+                // Called by the owning thread on every leave. A relaxed load if no snapshot is due.
+                auto requested() const noexcept -> bool
+                {
+                    return snapshot_epoch().load(std::memory_order_relaxed) != m_seen;
+                }
+
+                // Called by the owning thread if requested() is true
+                auto publish(call_tree const& tree, std::int64_t timestamp) -> void;
+
+                // Called by the snapshot thread. The totals published for epoch or nullptr.
+                auto published(std::uint64_t epoch) const noexcept -> std::vector<region_totals> const*
+                {
+                    return (m_published.load(std::memory_order_acquire) == epoch) ? &m_buffers[epoch % 2u] : nullptr;
+                }
+
+                // Unique for the lifetime of the process, unlike the slot's address
+                auto id() const noexcept -> std::uint64_t
+                {
+                    return m_id;
+                }
+
+                // The caller must hold snapshot_mutex(). The slot isn't read by the snapshot thread afterwards.
+                auto detach() -> void;
+
+            private:
+                std::array<std::vector<region_totals>, 2u> m_buffers{};
+                std::atomic<std::uint64_t> m_published{0u};
+                std::uint64_t m_seen{0u};
+                std::uint64_t m_id{0u};
+                bool m_attached{false};
+            };
+
+            // The calling thread's slot
+            auto this_thread_snapshot() -> snapshot_slot&;
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
@@ -0,0 +1,164 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#include "Summary.hpp"
+
+#include "Configuration.hpp"
+#include "Sketch.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    using bactria::metrics::native::duration_stats;
+
+    class summary_file
+    {
+    public:
+        summary_file()
+        {
+            auto const& path = bactria::metrics::native::get_configuration().summary_file;
+            if(path.empty())
+                return;
+
+            m_file = std::fopen(path.c_str(), "a");
+            if(m_file == nullptr)
+            {
+                std::fprintf(
+                    stderr,
+                    "WARNING: bactria's native metrics plugin failed to open %s. Summaries go to stderr instead.\n",
+                    path.c_str());
+            }
+        }
+
+        summary_file(summary_file const&) = delete;
+        auto operator=(summary_file const&) -> summary_file& = delete;
+
+        ~summary_file()
+        {
+            if(m_file != nullptr)
+                std::fclose(m_file);
+        }
+
+        auto write(char const* line) -> void
+        {
+            std::lock_guard<std::mutex> const lock{m_mutex};
+            std::fputs(line, m_file != nullptr ? m_file : stderr);
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::FILE* m_file{nullptr};
+    };
+
+    auto output() -> summary_file&
+    {
+        static summary_file file;
+        return file;
+    }
+
+    // Statistics are collected per thread, so recording a duration never takes a lock
+    auto thread_stats() -> std::unordered_map<std::uint32_t, duration_stats>&
+    {
+        thread_local auto stats = std::unordered_map<std::uint32_t, duration_stats>{};
+        return stats;
+    }
+
+    // One unit for the whole line, chosen by the longest duration
+    struct unit
+    {
+        char const* name;
+        double ns;
+    };
+
+    auto pick_unit(double max_ns) noexcept -> unit
+    {
+        if(max_ns >= 1e9)
+            return unit{"s", 1e9};
+        if(max_ns >= 1e6)
+            return unit{"ms", 1e6};
+        if(max_ns >= 1e3)
+            return unit{"us", 1e3};
+        return unit{"ns", 1.0};
+    }
+} // namespace
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            auto record_duration(region const& r, std::int64_t ns) -> void
+            {
+                auto& stats = thread_stats();
+                auto it = stats.find(r.id);
+                if(it == stats.end())
+                {
+                    auto const accuracy = get_configuration().summary_relative_accuracy;
+                    it = stats.emplace(r.id, duration_stats{accuracy}).first;
+                }
+
+                it->second.add(ns);
+            }
+
+            auto write_summary(region const& r) -> void
+            {
+                auto& stats = thread_stats();
+                auto const it = stats.find(r.id);
+                if(it == stats.end() || it->second.count() == 0u)
+                    return;
+
+                auto& s = it->second;
+                auto const u = pick_unit(s.max());
+                auto line = std::array<char, 1024u>{};
+                std::snprintf(
+                    line.data(),
+                    line.size(),
+                    "bactria: %s [%s] %llu %s: min %.3f %s, mean %.3f %s, max %.3f %s, stddev %.3f %s, "
+                    "p50 %.3f %s, p90 %.3f %s, p99 %.3f %s, p99.9 %.3f %s\n",
+                    r.name.c_str(),
+                    r.type == 4u ? "Body" : "Loop",
+                    static_cast<unsigned long long>(s.count()),
+                    r.type == 4u ? (s.count() == 1u ? "iteration" : "iterations")
+                                 : (s.count() == 1u ? "execution" : "executions"),
+                    s.min() / u.ns,
+                    u.name,
+                    s.mean() / u.ns,
+                    u.name,
+                    s.max() / u.ns,
+                    u.name,
+                    s.stddev() / u.ns,
+                    u.name,
+                    s.quantile(0.5) / u.ns,
+                    u.name,
+                    s.quantile(0.9) / u.ns,
+                    u.name,
+                    s.quantile(0.99) / u.ns,
+                    u.name,
+                    s.quantile(0.999) / u.ns,
+                    u.name);
+
+                output().write(line.data());
+                s.clear();
+            }
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
@@ -0,0 +1,44 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#pragma once
+
+#include "Profile.hpp"
+
+#include <cstdint>
+
+namespace bactria
+{
+    namespace metrics
+    {
+        namespace native
+        {
+            // Only Loop and Body sectors are summarized, see Tags.hpp
+            constexpr auto is_summarized(std::uint32_t type) noexcept -> bool
+            {
+                return type == 3u || type == 4u;
+            }
+
+            /* Adds one duration of the region to the calling thread's statistics. For Body sectors every duration
+             * is one loop iteration, for Loop sectors one execution of the whole loop. */
+            auto record_duration(region const& r, std::int64_t ns) -> void;
+
+            /* Writes the calling thread's statistics of the region and starts a new series. Nothing is written if
+             * the region hasn't been left since the last summary. */
+            auto write_summary(region const& r) -> void;
+        } // namespace native
+    } // namespace metrics
+} // namespace bactria
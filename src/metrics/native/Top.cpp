@@ -0,0 +1,296 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#include "LiveTable.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* bactria-top attaches to the live table of a process running with the native metrics plugin and live.enable = true
+ * and shows its hottest sectors and phases: those which took the most time since the previous refresh, summed over
+ * all threads. It only reads the shared-memory segment, so the process is neither signalled nor slowed down. */
+
+namespace native = bactria::metrics::native;
+
+namespace
+{
+    volatile std::sig_atomic_t interrupted = 0;
+
+    auto usage(char const* program) -> int
+    {
+        std::fprintf(
+            stderr,
+            "Usage: %s [-d seconds] [-n rows] [-1] <pid>\n"
+            "  -d  The refresh interval. Default: 1 second.\n"
+            "  -n  The number of regions to show. Default: 20.\n"
+            "  -1  Print the table once instead of refreshing the terminal.\n",
+            program);
+        return EXIT_FAILURE;
+    }
+
+    auto steady_now() -> std::int64_t
+    {
+        auto ts = timespec{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    struct row
+    {
+        std::uint32_t index;
+        native::live_statistics stats;
+        // Nanoseconds spent in the region since the previous refresh
+        double recent;
+    };
+
+    // Throttled calls aren't timed; their time is estimated from the mean of the timed calls
+    auto estimated_total(native::live_statistics const& s) -> double
+    {
+        return (s.timed == 0u) ? 0.0
+                               : static_cast<double>(s.total) * static_cast<double>(s.calls)
+                                     / static_cast<double>(s.timed);
+    }
+
+    class attachment
+    {
+    public:
+        explicit attachment(long pid) : m_name{native::live_segment_name(pid)}
+        {
+            auto const fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+            if(fd == -1)
+                return;
+
+            struct stat st{};
+            if(fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= native::live_segment_size(0u))
+            {
+                m_size = static_cast<std::size_t>(st.st_size);
+                auto const mapping = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+                if(mapping != MAP_FAILED)
+                    m_header = static_cast<native::live_header*>(mapping);
+            }
+            close(fd);
+
+            // Segments of a different layout version or with a capacity that doesn't match their size are ignored
+            if(m_header != nullptr
+               && (m_header->magic != native::live_magic
+                   || native::live_segment_size(m_header->capacity) > m_size))
+            {
+                munmap(m_header, m_size);
+                m_header = nullptr;
+            }
+        }
+
+        attachment(attachment const&) = delete;
+        auto operator=(attachment const&) -> attachment& = delete;
+
+        ~attachment()
+        {
+            if(m_header != nullptr)
+                munmap(m_header, m_size);
+        }
+
+        auto header() const noexcept -> native::live_header const*
+        {
+            return m_header;
+        }
+
+        auto entries() const noexcept -> native::live_entry const*
+        {
+            return native::live_entries(m_header);
+        }
+
+        auto name() const noexcept -> std::string const&
+        {
+            return m_name;
+        }
+
+    private:
+        std::string m_name;
+        std::size_t m_size{0u};
+        native::live_header* m_header{nullptr};
+    };
+
+    auto show(
+        attachment const& segment,
+        long pid,
+        std::vector<native::live_statistics>& previous,
+        double elapsed,
+        std::size_t max_rows,
+        bool refresh) -> void
+    {
+        auto const header = segment.header();
+        auto const size = std::min(header->size.load(std::memory_order_acquire), header->capacity);
+        previous.resize(size);
+
+        auto rows = std::vector<row>{};
+        auto inconsistent = std::size_t{0u};
+        for(auto i = std::uint32_t{0u}; i < size; ++i)
+        {
+            auto r = row{i, {}, 0.0};
+            if(!native::live_read(segment.entries()[i], r.stats))
+            {
+                ++inconsistent;
+                continue;
+            }
+
+            r.recent = estimated_total(r.stats) - estimated_total(previous[i]);
+            previous[i] = r.stats;
+            if(r.stats.calls != 0u || r.stats.in_flight != 0)
+                rows.push_back(r);
+        }
+
+        // The hottest regions first. Before the second refresh, "recent" covers the whole run.
+        std::sort(rows.begin(), rows.end(), [](row const& lhs, row const& rhs) { return lhs.recent > rhs.recent; });
+        if(rows.size() > max_rows)
+            rows.resize(max_rows);
+
+        if(refresh)
+            std::printf("\033[H\033[2J");
+
+        auto const uptime = static_cast<double>(steady_now() - header->start) * 1e-9;
+        std::printf(
+            "bactria-top - pid %ld, up %.1f s, %" PRIu32 " region(s)",
+            pid,
+            uptime,
+            size);
+        auto const dropped = header->dropped.load(std::memory_order_relaxed);
+        if(dropped != 0u)
+            std::printf(", %" PRIu64 " not shown (raise live.capacity)", dropped);
+        if(inconsistent != 0u)
+            std::printf(", %zu unreadable", inconsistent);
+        std::printf(
+            "\n\n%8s %14s %12s %12s %12s %12s %9s  %s\n",
+            "%time",
+            "calls",
+            "calls/s",
+            "total [s]",
+            "mean [us]",
+            "max [us]",
+            "in-flight",
+            "region");
+
+        for(auto const& r : rows)
+        {
+            auto const& e = segment.entries()[r.index];
+            auto const& s = r.stats;
+            auto const mean = (s.timed == 0u) ? 0.0 : static_cast<double>(s.total) / static_cast<double>(s.timed);
+            // Summed over all threads, so this exceeds 100 % if several threads are in the region at the same time
+            std::printf(
+                "%8.1f %14" PRIu64 " %12.0f %12.3f %12.3f %12.3f %9" PRId64 "  %.*s [%.*s]\n",
+                r.recent / (elapsed * 1e9) * 100.0,
+                s.calls,
+                static_cast<double>(s.calls) / std::max(uptime, 1e-9),
+                estimated_total(s) * 1e-9,
+                mean * 1e-3,
+                static_cast<double>(s.max) * 1e-3,
+                s.in_flight,
+                static_cast<int>(sizeof(e.name)),
+                e.name,
+                static_cast<int>(sizeof(e.type)),
+                e.type);
+        }
+        std::fflush(stdout);
+    }
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    auto interval = 1.0;
+    auto max_rows = std::size_t{20u};
+    auto once = false;
+
+    auto option = 0;
+    while((option = getopt(argc, argv, "d:n:1")) != -1)
+    {
+        switch(option)
+        {
+        case 'd':
+            interval = std::strtod(optarg, nullptr);
+            break;
+        case 'n':
+            max_rows = static_cast<std::size_t>(std::strtoul(optarg, nullptr, 10));
+            break;
+        case '1':
+            once = true;
+            break;
+        default:
+            return usage(argv[0]);
+        }
+    }
+
+    if(optind + 1 != argc || !(interval > 0.0))
+        return usage(argv[0]);
+
+    auto const pid = std::strtol(argv[optind], nullptr, 10);
+    attachment const segment{pid};
+    if(segment.header() == nullptr)
+    {
+        std::fprintf(
+            stderr,
+            "%s: no live table found for pid %ld. Is it running with the native metrics plugin and "
+            "live.enable = true?\n",
+            argv[0],
+            pid);
+        return EXIT_FAILURE;
+    }
+
+    std::signal(SIGINT, [](int) { interrupted = 1; });
+
+    auto previous = std::vector<native::live_statistics>{};
+    auto last = segment.header()->start;
+    while(interrupted == 0)
+    {
+        auto const now = steady_now();
+        show(segment, pid, previous, static_cast<double>(now - last) * 1e-9, max_rows, !once);
+        last = now;
+
+        // The segment is removed when the process exits; a crashed process leaves it behind
+        if(kill(static_cast<pid_t>(pid), 0) == -1 && errno == ESRCH)
+        {
+            std::fprintf(
+                stderr,
+                "%s: process %ld has exited. Remove /dev/shm%s if it is still there.\n",
+                argv[0],
+                pid,
+                segment.name().c_str());
+            break;
+        }
+
+        if(once)
+            break;
+
+        std::this_thread::sleep_for(std::chrono::duration<double>{interval});
+    }
+
+    return EXIT_SUCCESS;
+}
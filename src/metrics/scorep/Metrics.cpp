@@ -21,6 +21,7 @@
 #include <scorep/SCOREP_User_Variables.h>
 
 #include <cstdint>
+#include <limits>
 
 namespace
 {
@@ -104,6 +105,20 @@ extern "C"
         // TODO
     }
 
+    // Score-P evaluates its profile offline
+    auto bactria_metrics_sector_quantile(void* /* sector_handle */, double /* q */) noexcept -> double
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // Score-P has no notion of work
+    auto bactria_metrics_sector_work(
+        void* /* sector_handle */,
+        std::uint32_t /* type */,
+        std::uint64_t /* amount */) noexcept -> void
+    {
+    }
+
     auto bactria_metrics_create_phase(char const* name) noexcept -> void*
     {
         return new Phase{SCOREP_INVALID_REGION, name};
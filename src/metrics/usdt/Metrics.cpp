@@ -0,0 +1,156 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+#include <bactria/metrics/PluginInterface.hpp>
+
+// Every probe gets a semaphore which is incremented by the tracer (perf, bpftrace, SystemTap, ...) on attachment
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#include <cstdint>
+#include <limits>
+
+/* The semaphore names are dictated by sys/sdt.h: <provider>_<probe>_semaphore. They have to live in the .probes
+ * section so the tracer can find and modify them. */
+#define BACTRIA_USDT_SEMAPHORE(probe)                                                                                 \
+    __extension__ unsigned short bactria_##probe##_semaphore __attribute__((unused, section(".probes")))
+
+// Only evaluate the probe arguments if a tracer is attached to the probe
+#define BACTRIA_USDT_ENABLED(probe) __builtin_expect(bactria_##probe##_semaphore != 0, 0)
+
+extern "C"
+{
+    BACTRIA_USDT_SEMAPHORE(sector_enter);
+    BACTRIA_USDT_SEMAPHORE(sector_leave);
+    BACTRIA_USDT_SEMAPHORE(sector_summary);
+    BACTRIA_USDT_SEMAPHORE(sector_work);
+    BACTRIA_USDT_SEMAPHORE(phase_enter);
+    BACTRIA_USDT_SEMAPHORE(phase_leave);
+}
+
+namespace
+{
+    struct Sector
+    {
+        char const* name;
+        std::uint32_t type;
+    };
+
+    struct Phase
+    {
+        char const* name;
+    };
+} // namespace
+
+extern "C"
+{
+    auto bactria_metrics_create_sector(char const* name, std::uint32_t type) noexcept -> void*
+    {
+        return new Sector{name, type};
+    }
+
+    auto bactria_metrics_destroy_sector(void* sector_handle) noexcept -> void
+    {
+        auto s = static_cast<Sector*>(sector_handle);
+        delete s;
+    }
+
+    auto bactria_metrics_enter_sector(
+        void* sector_handle,
+        char const* source,
+        std::uint32_t lineno,
+        char const* caller) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(sector_enter))
+        {
+            auto const s = static_cast<Sector const*>(sector_handle);
+            STAP_PROBE6(bactria, sector_enter, sector_handle, s->name, s->type, source, lineno, caller);
+        }
+    }
+
+    auto bactria_metrics_leave_sector(
+        void* sector_handle,
+        char const* source,
+        std::uint32_t lineno,
+        char const* caller) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(sector_leave))
+        {
+            auto const s = static_cast<Sector const*>(sector_handle);
+            STAP_PROBE6(bactria, sector_leave, sector_handle, s->name, s->type, source, lineno, caller);
+        }
+    }
+
+    auto bactria_metrics_sector_summary(void* sector_handle) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(sector_summary))
+        {
+            auto const s = static_cast<Sector const*>(sector_handle);
+            STAP_PROBE3(bactria, sector_summary, sector_handle, s->name, s->type);
+        }
+    }
+
+    // Durations are measured by the tracer, not by the plugin
+    auto bactria_metrics_sector_quantile(void* /* sector_handle */, double /* q */) noexcept -> double
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    auto bactria_metrics_sector_work(void* sector_handle, std::uint32_t type, std::uint64_t amount) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(sector_work))
+        {
+            auto const s = static_cast<Sector const*>(sector_handle);
+            STAP_PROBE5(bactria, sector_work, sector_handle, s->name, s->type, type, amount);
+        }
+    }
+
+    auto bactria_metrics_create_phase(char const* name) noexcept -> void*
+    {
+        return new Phase{name};
+    }
+
+    auto bactria_metrics_destroy_phase(void* phase_handle) noexcept -> void
+    {
+        auto p = static_cast<Phase*>(phase_handle);
+        delete p;
+    }
+
+    auto bactria_metrics_enter_phase(
+        void* phase_handle,
+        char const* source,
+        std::uint32_t lineno,
+        char const* caller) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(phase_enter))
+        {
+            auto const p = static_cast<Phase const*>(phase_handle);
+            STAP_PROBE5(bactria, phase_enter, phase_handle, p->name, source, lineno, caller);
+        }
+    }
+
+    auto bactria_metrics_leave_phase(
+        void* phase_handle,
+        char const* source,
+        std::uint32_t lineno,
+        char const* caller) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(phase_leave))
+        {
+            auto const p = static_cast<Phase const*>(phase_handle);
+            STAP_PROBE5(bactria, phase_leave, phase_handle, p->name, source, lineno, caller);
+        }
+    }
+}
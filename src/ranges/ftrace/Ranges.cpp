@@ -0,0 +1,519 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+#include <bactria/ranges/PluginInterface.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace
+{
+    /* Text records follow the atrace format (B/E/S/F/C/I|pid|...) which is understood by trace-cmd, KernelShark and
+     * Perfetto. Binary records for trace_marker_raw start with the mandatory 32 bit id, followed by the fields of
+     * raw_record and the (not NUL-terminated) name. */
+    enum record_type : std::uint32_t
+    {
+        event_record = 1u,
+        range_start_record = 2u,
+        range_stop_record = 3u,
+        async_range_start_record = 4u,
+        async_range_stop_record = 5u,
+        range_push_record = 6u,
+        range_pop_record = 7u,
+        category_record = 8u,
+        counter_record = 9u,
+        span_record = 10u,
+        flow_begin_record = 11u,
+        flow_end_record = 12u
+    };
+
+    struct raw_record
+    {
+        std::uint32_t id;
+        std::uint32_t cat_id;
+        std::uint32_t color;
+        std::uint32_t name_length;
+        std::uint64_t cookie;
+        std::uint32_t payload_type;
+        std::uint32_t reserved;
+        std::uint64_t payload;
+    };
+
+    // Retroactive spans carry their own timestamps (in nanoseconds of CLOCK_MONOTONIC)
+    struct raw_span_record
+    {
+        std::uint32_t id;
+        std::uint32_t cat_id;
+        std::uint32_t color;
+        std::uint32_t name_length;
+        std::uint32_t track;
+        std::uint32_t reserved;
+        std::int64_t start;
+        std::int64_t end;
+    };
+
+    // trace_marker truncates longer writes anyway
+    constexpr auto max_record_size = std::size_t{1024u};
+
+    class marker_file
+    {
+    public:
+        marker_file()
+        {
+            m_raw = (std::getenv("BACTRIA_FTRACE_RAW") != nullptr);
+
+            // A user-supplied file always takes precedence over tracefs
+            auto const user_file = std::getenv("BACTRIA_FTRACE_FILE");
+            if(user_file != nullptr)
+            {
+                open_regular(user_file);
+                return;
+            }
+
+            auto const marker = m_raw ? "trace_marker_raw" : "trace_marker";
+            for(auto const tracefs : {"/sys/kernel/tracing/", "/sys/kernel/debug/tracing/"})
+            {
+                auto path = std::array<char, 64>{};
+                std::snprintf(path.data(), path.size(), "%s%s", tracefs, marker);
+                m_fd = open(path.data(), O_WRONLY | O_CLOEXEC);
+                if(m_fd != -1)
+                    return;
+            }
+
+            std::fprintf(
+                stderr,
+                "WARNING: tracefs is not writable. bactria's ftrace plugin will write to bactria_ftrace.%s instead.\n",
+                m_raw ? "bin" : "txt");
+            open_regular(m_raw ? "bactria_ftrace.bin" : "bactria_ftrace.txt");
+        }
+
+        marker_file(marker_file const&) = delete;
+        auto operator=(marker_file const&) -> marker_file& = delete;
+
+        ~marker_file()
+        {
+            if(m_fd != -1)
+                close(m_fd);
+        }
+
+        auto is_raw() const noexcept
+        {
+            return m_raw;
+        }
+
+        // Each record is written with exactly one write() so records of different threads never interleave
+        auto write_record(void const* data, std::size_t size) const noexcept
+        {
+            if(m_fd != -1)
+            {
+                auto const written = write(m_fd, data, size);
+                static_cast<void>(written); // there is nobody we could report a lost record to
+            }
+        }
+
+    private:
+        auto open_regular(char const* path) -> void
+        {
+            m_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if(m_fd == -1)
+                std::fprintf(
+                    stderr,
+                    "WARNING: bactria's ftrace plugin failed to open %s. No output will be written.\n",
+                    path);
+        }
+
+        int m_fd{-1};
+        bool m_raw{false};
+    };
+
+    auto const pid = getpid();
+    auto const output = marker_file{};
+    auto next_cookie = std::atomic<std::uint64_t>{1u};
+
+    /* atrace matches S and F records by name and cookie only. Range cookies, correlation IDs and flow IDs are all
+     * counted from 1, so each kind gets its own cookie space in the top two bits. */
+    constexpr auto range_cookies = std::uint64_t{0u};
+    constexpr auto async_range_cookies = std::uint64_t{1u} << 62u;
+    constexpr auto flow_cookies = std::uint64_t{2u} << 62u;
+
+    auto text_cookie(std::uint64_t space, std::uint64_t id) noexcept -> unsigned long long
+    {
+        return static_cast<unsigned long long>(space | (id & (~std::uint64_t{0u} >> 2u)));
+    }
+
+    [[gnu::format(printf, 1, 2)]] auto write_text(char const* format, ...) noexcept -> void
+    {
+        auto buf = std::array<char, max_record_size>{};
+
+        va_list args;
+        va_start(args, format);
+        auto const len = std::vsnprintf(buf.data(), buf.size(), format, args);
+        va_end(args);
+
+        if(len <= 0)
+            return;
+
+        // Every record ends with a newline, truncated ones too, so records in a regular file stay on separate lines
+        auto size = static_cast<std::size_t>(len);
+        if(size >= buf.size())
+        {
+            size = buf.size() - 1;
+            buf[size - 1] = '\n';
+        }
+
+        output.write_record(buf.data(), size);
+    }
+
+    auto write_raw(
+        record_type type,
+        std::uint32_t cat_id,
+        std::uint32_t color,
+        std::uint64_t cookie,
+        char const* name,
+        std::uint32_t payload_type = 0u,
+        std::uint64_t payload = 0u) noexcept -> void
+    {
+        auto buf = std::array<char, max_record_size>{};
+
+        auto const name_length = std::min(std::strlen(name), buf.size() - sizeof(raw_record));
+        auto const header = raw_record{
+            type,
+            cat_id,
+            color,
+            static_cast<std::uint32_t>(name_length),
+            cookie,
+            payload_type,
+            0u,
+            payload};
+
+        std::memcpy(buf.data(), &header, sizeof(raw_record));
+        std::memcpy(buf.data() + sizeof(raw_record), name, name_length);
+        output.write_record(buf.data(), sizeof(raw_record) + name_length);
+    }
+
+    // atrace markers can't carry values, so payloads are written as an additional counter sample
+    auto write_counter(char const* name, std::uint32_t type, std::uint64_t bits) noexcept -> void
+    {
+        auto const payload = bactria::ranges::Payload{type, bits};
+        switch(payload.get_type())
+        {
+        case bactria::ranges::payload_type::int64:
+            write_text("C|%d|%s|%lld\n", pid, name, static_cast<long long>(payload.as_int64()));
+            break;
+        case bactria::ranges::payload_type::uint64:
+            write_text("C|%d|%s|%llu\n", pid, name, static_cast<unsigned long long>(payload.as_uint64()));
+            break;
+        case bactria::ranges::payload_type::float64:
+            write_text("C|%d|%s|%.17g\n", pid, name, payload.as_double());
+            break;
+        default:
+            break;
+        }
+    }
+
+    struct event
+    {
+        std::uint32_t color;
+        std::string cat_name;
+        std::uint32_t cat_id;
+    };
+
+    struct range
+    {
+        std::string name;
+        std::uint32_t color;
+        std::string cat_name;
+        std::uint32_t cat_id;
+        std::uint64_t cookie;
+    };
+
+    struct counter
+    {
+        std::string name;
+        std::uint32_t color;
+        std::uint32_t cat_id;
+    };
+
+    struct flow
+    {
+        std::string name;
+        std::uint32_t color;
+        std::uint32_t cat_id;
+    };
+
+    struct timeline
+    {
+        std::vector<std::string> span_names;
+        std::uint32_t color;
+        std::uint32_t cat_id;
+    };
+
+    auto write_raw_span(timeline const& t, bactria::ranges::Span const& s) noexcept -> void
+    {
+        auto buf = std::array<char, max_record_size>{};
+
+        auto const name = (s.name_id < t.span_names.size()) ? t.span_names[s.name_id].c_str() : "";
+        auto const name_length = std::min(std::strlen(name), buf.size() - sizeof(raw_span_record));
+        auto const header = raw_span_record{
+            span_record,
+            t.cat_id,
+            t.color,
+            static_cast<std::uint32_t>(name_length),
+            s.track,
+            0u,
+            s.start,
+            s.end};
+
+        std::memcpy(buf.data(), &header, sizeof(raw_span_record));
+        std::memcpy(buf.data() + sizeof(raw_span_record), name, name_length);
+        output.write_record(buf.data(), sizeof(raw_span_record) + name_length);
+    }
+} // namespace
+
+extern "C"
+{
+    // atrace has no notion of categories, but raw traces need the mapping from ID to name
+    auto bactria_ranges_register_category(std::uint32_t cat_id, char const* cat_name) noexcept -> void
+    {
+        if(output.is_raw())
+            write_raw(category_record, cat_id, 0u, 0u, cat_name);
+    }
+
+    auto bactria_ranges_create_event(std::uint32_t color, char const* cat_name, std::uint32_t cat_id) noexcept -> void*
+    {
+        return new event{color, cat_name, cat_id};
+    }
+
+    auto bactria_ranges_destroy_event(void* event_handle) noexcept -> void
+    {
+        auto ev = static_cast<event*>(event_handle);
+        delete ev;
+    }
+
+    auto bactria_ranges_fire_event(
+        void* event_handle,
+        char const* event_name,
+        std::uint32_t payload_type,
+        std::uint64_t payload,
+        char const* /* source */,
+        std::uint32_t /* lineno */,
+        char const* /* caller */) noexcept -> void
+    {
+        auto const ev = static_cast<event const*>(event_handle);
+
+        if(output.is_raw())
+            write_raw(event_record, ev->cat_id, ev->color, 0u, event_name, payload_type, payload);
+        else
+        {
+            write_text("I|%d|%s\n", pid, event_name);
+            write_counter(event_name, payload_type, payload);
+        }
+    }
+
+    auto bactria_ranges_create_range(
+        char const* name,
+        std::uint32_t color,
+        char const* cat_name,
+        std::uint32_t cat_id) noexcept -> void*
+    {
+        return new range{name, color, cat_name, cat_id, next_cookie.fetch_add(1u, std::memory_order_relaxed)};
+    }
+
+    auto bactria_ranges_destroy_range(void* range_handle) noexcept -> void
+    {
+        auto r = static_cast<range*>(range_handle);
+        delete r;
+    }
+
+    // Ranges may overlap freely, so they are recorded as asynchronous slices instead of B/E pairs
+    auto bactria_ranges_start_range(void* range_handle, std::uint32_t payload_type, std::uint64_t payload) noexcept
+        -> void
+    {
+        auto const r = static_cast<range const*>(range_handle);
+
+        if(output.is_raw())
+            write_raw(range_start_record, r->cat_id, r->color, r->cookie, r->name.c_str(), payload_type, payload);
+        else
+        {
+            write_text("S|%d|%s|%llu\n", pid, r->name.c_str(), text_cookie(range_cookies, r->cookie));
+            write_counter(r->name.c_str(), payload_type, payload);
+        }
+    }
+
+    auto bactria_ranges_stop_range(void* range_handle) noexcept -> void
+    {
+        auto const r = static_cast<range const*>(range_handle);
+
+        if(output.is_raw())
+            write_raw(range_stop_record, r->cat_id, r->color, r->cookie, r->name.c_str());
+        else
+            write_text("F|%d|%s|%llu\n", pid, r->name.c_str(), text_cookie(range_cookies, r->cookie));
+    }
+
+    // The correlation ID replaces the per-handle cookie so the trace viewer can match start and stop
+    auto bactria_ranges_start_async_range(void* range_handle, std::uint64_t correlation_id) noexcept -> void
+    {
+        auto const r = static_cast<range const*>(range_handle);
+
+        if(output.is_raw())
+            write_raw(async_range_start_record, r->cat_id, r->color, correlation_id, r->name.c_str());
+        else
+            write_text("S|%d|%s|%llu\n", pid, r->name.c_str(), text_cookie(async_range_cookies, correlation_id));
+    }
+
+    auto bactria_ranges_stop_async_range(void* range_handle, std::uint64_t correlation_id) noexcept -> void
+    {
+        auto const r = static_cast<range const*>(range_handle);
+
+        if(output.is_raw())
+            write_raw(async_range_stop_record, r->cat_id, r->color, correlation_id, r->name.c_str());
+        else
+            write_text("F|%d|%s|%llu\n", pid, r->name.c_str(), text_cookie(async_range_cookies, correlation_id));
+    }
+
+    // Pushed ranges are strictly nested per thread which is exactly what B/E records describe
+    auto bactria_ranges_push_range(
+        char const* name,
+        std::uint32_t color,
+        char const* /* cat_name */,
+        std::uint32_t cat_id) noexcept -> void
+    {
+        if(output.is_raw())
+            write_raw(range_push_record, cat_id, color, 0u, name);
+        else
+            write_text("B|%d|%s\n", pid, name);
+    }
+
+    auto bactria_ranges_pop_range() noexcept -> void
+    {
+        if(output.is_raw())
+            write_raw(range_pop_record, 0u, 0u, 0u, "");
+        else
+            write_text("E|%d\n", pid);
+    }
+
+    auto bactria_ranges_create_counter(
+        char const* name,
+        std::uint32_t color,
+        char const* /* cat_name */,
+        std::uint32_t cat_id) noexcept -> void*
+    {
+        return new counter{name, color, cat_id};
+    }
+
+    auto bactria_ranges_destroy_counter(void* counter_handle) noexcept -> void
+    {
+        auto c = static_cast<counter*>(counter_handle);
+        delete c;
+    }
+
+    auto bactria_ranges_sample_counter(void* counter_handle, std::uint32_t value_type, std::uint64_t value) noexcept
+        -> void
+    {
+        auto const c = static_cast<counter const*>(counter_handle);
+
+        if(output.is_raw())
+            write_raw(counter_record, c->cat_id, c->color, 0u, c->name.c_str(), value_type, value);
+        else
+            write_counter(c->name.c_str(), value_type, value);
+    }
+
+    // The kernel timestamps trace_marker writes itself, so only raw records can carry retroactive spans
+    auto bactria_ranges_create_timeline(
+        char const* name,
+        char const* const* span_names,
+        std::uint32_t span_name_count,
+        std::uint32_t color,
+        char const* /* cat_name */,
+        std::uint32_t cat_id) noexcept -> void*
+    {
+        if(!output.is_raw())
+        {
+            std::fprintf(
+                stderr,
+                "WARNING: bactria's ftrace plugin can't record timeline %s in text mode. Set BACTRIA_FTRACE_RAW to "
+                "record it.\n",
+                name);
+            return nullptr;
+        }
+
+        return new timeline{{span_names, span_names + span_name_count}, color, cat_id};
+    }
+
+    auto bactria_ranges_destroy_timeline(void* timeline_handle) noexcept -> void
+    {
+        auto t = static_cast<timeline*>(timeline_handle);
+        delete t;
+    }
+
+    auto bactria_ranges_submit_spans(
+        void* timeline_handle,
+        bactria::ranges::Span const* spans,
+        std::size_t count) noexcept -> void
+    {
+        auto const t = static_cast<timeline const*>(timeline_handle);
+        for(auto i = std::size_t{0u}; i < count; ++i)
+            write_raw_span(*t, spans[i]);
+    }
+
+    auto bactria_ranges_create_flow(
+        char const* name,
+        std::uint32_t color,
+        char const* /* cat_name */,
+        std::uint32_t cat_id) noexcept -> void*
+    {
+        return new flow{name, color, cat_id};
+    }
+
+    auto bactria_ranges_destroy_flow(void* flow_handle) noexcept -> void
+    {
+        auto f = static_cast<flow*>(flow_handle);
+        delete f;
+    }
+
+    // atrace has no flow arrows; an asynchronous slice keyed by the flow ID shows the time in flight instead
+    auto bactria_ranges_begin_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        auto const f = static_cast<flow const*>(flow_handle);
+
+        if(output.is_raw())
+            write_raw(flow_begin_record, f->cat_id, f->color, flow_id, f->name.c_str());
+        else
+            write_text("S|%d|%s|%llu\n", pid, f->name.c_str(), text_cookie(flow_cookies, flow_id));
+    }
+
+    auto bactria_ranges_end_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        auto const f = static_cast<flow const*>(flow_handle);
+
+        if(output.is_raw())
+            write_raw(flow_end_record, f->cat_id, f->color, flow_id, f->name.c_str());
+        else
+            write_text("F|%d|%s|%llu\n", pid, f->name.c_str(), text_cookie(flow_cookies, flow_id));
+    }
+}
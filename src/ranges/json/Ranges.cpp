@@ -0,0 +1,417 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#include <bactria/ranges/PluginInterface.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+/* This plugin writes the Trace Event Format understood by chrome://tracing and Perfetto. Every record becomes one
+ * element of the traceEvents array; the array is closed when the plugin is unloaded. */
+
+namespace
+{
+    class trace_file
+    {
+    public:
+        trace_file()
+        {
+            auto const user_file = std::getenv("BACTRIA_JSON_TRACE_FILE");
+            // Every process gets its own file by default so MPI ranks don't overwrite each other's traces
+            auto const path = (user_file != nullptr) ? std::string{user_file}
+                                                     : "bactria_trace_" + std::to_string(getpid()) + ".json";
+
+            m_file = std::fopen(path.c_str(), "w");
+            if(m_file == nullptr)
+            {
+                std::fprintf(
+                    stderr,
+                    "WARNING: bactria's JSON ranges plugin failed to open %s. No output will be written.\n",
+                    path.c_str());
+                return;
+            }
+
+            std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", m_file);
+        }
+
+        trace_file(trace_file const&) = delete;
+        auto operator=(trace_file const&) -> trace_file& = delete;
+
+        ~trace_file()
+        {
+            if(m_file != nullptr)
+            {
+                std::fputs("\n]}\n", m_file);
+                std::fclose(m_file);
+            }
+        }
+
+        auto write(nlohmann::json const& record) noexcept -> void
+        {
+            if(m_file == nullptr)
+                return;
+
+            // Names are user-supplied and may contain invalid UTF-8
+            auto const text = record.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+
+            std::lock_guard<std::mutex> const lock{m_mutex};
+            std::fputs(m_first ? "" : ",\n", m_file);
+            std::fputs(text.c_str(), m_file);
+            m_first = false;
+        }
+
+    private:
+        std::FILE* m_file{nullptr};
+        std::mutex m_mutex;
+        bool m_first{true};
+    };
+
+    auto const pid = getpid();
+    auto output = trace_file{};
+
+    // Small sequential thread IDs keep the viewer's track list readable
+    auto next_tid = std::atomic<std::uint64_t>{1u};
+
+    // Timelines get their own block of synthetic thread IDs, one per track
+    constexpr auto timeline_tid_base = std::uint64_t{1u} << 32u;
+    auto next_timeline = std::atomic<std::uint64_t>{1u};
+
+    auto thread_id() noexcept
+    {
+        thread_local auto const tid = next_tid.fetch_add(1u, std::memory_order_relaxed);
+        return tid;
+    }
+
+    // The Trace Event Format expects microseconds
+    auto to_us(std::int64_t ns) noexcept
+    {
+        return static_cast<double>(ns) / 1000.0;
+    }
+
+    auto now_us() noexcept
+    {
+        return to_us(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count());
+    }
+
+    auto make_record(char const* phase, std::string const& name, std::string const& cat_name, double ts)
+    {
+        return nlohmann::json{
+            {"ph", phase},
+            {"name", name},
+            {"cat", cat_name},
+            {"ts", ts},
+            {"pid", pid},
+            {"tid", thread_id()}};
+    }
+
+    auto make_payload(std::uint32_t type, std::uint64_t bits) -> nlohmann::json
+    {
+        auto const payload = bactria::ranges::Payload{type, bits};
+        switch(payload.get_type())
+        {
+        case bactria::ranges::payload_type::int64:
+            return payload.as_int64();
+        case bactria::ranges::payload_type::uint64:
+            return payload.as_uint64();
+        case bactria::ranges::payload_type::float64:
+            return payload.as_double();
+        default:
+            return nullptr;
+        }
+    }
+
+    struct event
+    {
+        std::string cat_name;
+    };
+
+    struct range
+    {
+        std::string name;
+        std::string cat_name;
+    };
+
+    struct counter
+    {
+        std::string name;
+        std::string cat_name;
+    };
+
+    struct timeline
+    {
+        std::string name;
+        std::vector<std::string> span_names;
+        std::string cat_name;
+        std::uint64_t tid_base;
+        std::set<std::uint32_t> named_tracks{};
+    };
+
+    struct flow
+    {
+        std::string name;
+        std::string cat_name;
+    };
+
+    // Flow arrows bind to the enclosing slice, so each end of a flow gets a zero-length slice of its own
+    auto write_flow(flow const& f, char const* phase, std::uint64_t flow_id) noexcept
+    {
+        auto const ts = now_us();
+
+        auto slice = make_record("X", f.name, f.cat_name, ts);
+        slice["dur"] = 0;
+        output.write(slice);
+
+        auto arrow = make_record(phase, f.name, f.cat_name, ts);
+        arrow["id"] = flow_id;
+        arrow["bp"] = "e";
+        output.write(arrow);
+    }
+} // namespace
+
+extern "C"
+{
+    // The Trace Event Format has no category registry; every record carries its category's name
+    auto bactria_ranges_register_category(std::uint32_t /* cat_id */, char const* /* cat_name */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_create_event(
+        std::uint32_t /* color */,
+        char const* cat_name,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return new event{cat_name};
+    }
+
+    auto bactria_ranges_destroy_event(void* event_handle) noexcept -> void
+    {
+        auto ev = static_cast<event*>(event_handle);
+        delete ev;
+    }
+
+    auto bactria_ranges_fire_event(
+        void* event_handle,
+        char const* event_name,
+        std::uint32_t payload_type,
+        std::uint64_t payload,
+        char const* source,
+        std::uint32_t lineno,
+        char const* caller) noexcept -> void
+    {
+        auto const ev = static_cast<event const*>(event_handle);
+
+        auto record = make_record("i", event_name, ev->cat_name, now_us());
+        record["s"] = "t";
+        record["args"] = {{"source", source}, {"line", lineno}, {"caller", caller}};
+        if(payload_type != static_cast<std::uint32_t>(bactria::ranges::payload_type::none))
+            record["args"]["value"] = make_payload(payload_type, payload);
+
+        output.write(record);
+    }
+
+    auto bactria_ranges_create_range(
+        char const* name,
+        std::uint32_t /* color */,
+        char const* cat_name,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return new range{name, cat_name};
+    }
+
+    auto bactria_ranges_destroy_range(void* range_handle) noexcept -> void
+    {
+        auto r = static_cast<range*>(range_handle);
+        delete r;
+    }
+
+    // Ranges may overlap freely, so they are recorded as asynchronous slices keyed by their handle
+    auto bactria_ranges_start_range(void* range_handle, std::uint32_t payload_type, std::uint64_t payload) noexcept
+        -> void
+    {
+        auto const r = static_cast<range const*>(range_handle);
+
+        auto record = make_record("b", r->name, r->cat_name, now_us());
+        record["id2"] = {{"local", reinterpret_cast<std::uintptr_t>(range_handle)}};
+        if(payload_type != static_cast<std::uint32_t>(bactria::ranges::payload_type::none))
+            record["args"] = {{"value", make_payload(payload_type, payload)}};
+
+        output.write(record);
+    }
+
+    auto bactria_ranges_stop_range(void* range_handle) noexcept -> void
+    {
+        auto const r = static_cast<range const*>(range_handle);
+
+        auto record = make_record("e", r->name, r->cat_name, now_us());
+        record["id2"] = {{"local", reinterpret_cast<std::uintptr_t>(range_handle)}};
+
+        output.write(record);
+    }
+
+    // The correlation ID replaces the handle so start and stop match across threads
+    auto bactria_ranges_start_async_range(void* range_handle, std::uint64_t correlation_id) noexcept -> void
+    {
+        auto const r = static_cast<range const*>(range_handle);
+
+        auto record = make_record("b", r->name, r->cat_name, now_us());
+        record["id2"] = {{"global", correlation_id}};
+
+        output.write(record);
+    }
+
+    auto bactria_ranges_stop_async_range(void* range_handle, std::uint64_t correlation_id) noexcept -> void
+    {
+        auto const r = static_cast<range const*>(range_handle);
+
+        auto record = make_record("e", r->name, r->cat_name, now_us());
+        record["id2"] = {{"global", correlation_id}};
+
+        output.write(record);
+    }
+
+    // Pushed ranges are strictly nested per thread which is exactly what B/E records describe
+    auto bactria_ranges_push_range(
+        char const* name,
+        std::uint32_t /* color */,
+        char const* cat_name,
+        std::uint32_t /* cat_id */) noexcept -> void
+    {
+        output.write(make_record("B", name, cat_name, now_us()));
+    }
+
+    auto bactria_ranges_pop_range() noexcept -> void
+    {
+        output.write(nlohmann::json{{"ph", "E"}, {"ts", now_us()}, {"pid", pid}, {"tid", thread_id()}});
+    }
+
+    auto bactria_ranges_create_counter(
+        char const* name,
+        std::uint32_t /* color */,
+        char const* cat_name,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return new counter{name, cat_name};
+    }
+
+    auto bactria_ranges_destroy_counter(void* counter_handle) noexcept -> void
+    {
+        auto c = static_cast<counter*>(counter_handle);
+        delete c;
+    }
+
+    auto bactria_ranges_sample_counter(void* counter_handle, std::uint32_t value_type, std::uint64_t value) noexcept
+        -> void
+    {
+        auto const c = static_cast<counter const*>(counter_handle);
+
+        auto record = make_record("C", c->name, c->cat_name, now_us());
+        record["args"] = {{c->name, make_payload(value_type, value)}};
+
+        output.write(record);
+    }
+
+    auto bactria_ranges_create_timeline(
+        char const* name,
+        char const* const* span_names,
+        std::uint32_t span_name_count,
+        std::uint32_t /* color */,
+        char const* cat_name,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        auto const tid_base = timeline_tid_base * next_timeline.fetch_add(1u, std::memory_order_relaxed);
+        return new timeline{name, {span_names, span_names + span_name_count}, cat_name, tid_base};
+    }
+
+    auto bactria_ranges_destroy_timeline(void* timeline_handle) noexcept -> void
+    {
+        auto t = static_cast<timeline*>(timeline_handle);
+        delete t;
+    }
+
+    // Spans carry their own timestamps, so they are written as complete slices on one synthetic thread per track
+    auto bactria_ranges_submit_spans(
+        void* timeline_handle,
+        bactria::ranges::Span const* spans,
+        std::size_t count) noexcept -> void
+    {
+        auto t = static_cast<timeline*>(timeline_handle);
+
+        for(auto i = std::size_t{0u}; i < count; ++i)
+        {
+            auto const& s = spans[i];
+            auto const tid = t->tid_base + s.track;
+
+            if(t->named_tracks.insert(s.track).second)
+            {
+                output.write(nlohmann::json{
+                    {"ph", "M"},
+                    {"name", "thread_name"},
+                    {"pid", pid},
+                    {"tid", tid},
+                    {"args", {{"name", t->name + " #" + std::to_string(s.track)}}}});
+            }
+
+            auto const name = (s.name_id < t->span_names.size()) ? t->span_names[s.name_id] : std::string{"?"};
+            output.write(nlohmann::json{
+                {"ph", "X"},
+                {"name", name},
+                {"cat", t->cat_name},
+                {"ts", to_us(s.start)},
+                {"dur", to_us(s.end - s.start)},
+                {"pid", pid},
+                {"tid", tid}});
+        }
+    }
+
+    auto bactria_ranges_create_flow(
+        char const* name,
+        std::uint32_t /* color */,
+        char const* cat_name,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return new flow{name, cat_name};
+    }
+
+    auto bactria_ranges_destroy_flow(void* flow_handle) noexcept -> void
+    {
+        auto f = static_cast<flow*>(flow_handle);
+        delete f;
+    }
+
+    auto bactria_ranges_begin_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        write_flow(*static_cast<flow const*>(flow_handle), "s", flow_id);
+    }
+
+    auto bactria_ranges_end_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        write_flow(*static_cast<flow const*>(flow_handle), "f", flow_id);
+    }
+}
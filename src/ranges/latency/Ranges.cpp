@@ -0,0 +1,375 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#include <bactria/ranges/PluginInterface.hpp>
+
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/* This plugin doesn't record a trace. It matches the two ends of every flow instance and aggregates the latencies per
+ * flow name. The distributions are printed when the plugin is unloaded. All other markers are ignored. */
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    /* Log-linear histogram: every power of two is split into sub_buckets linear buckets. Memory is fixed and the
+     * relative error of the reported quantiles is below 1 / sub_buckets. */
+    class histogram
+    {
+    public:
+        auto add(std::uint64_t ns) noexcept -> void
+        {
+            ++m_buckets[index(ns)];
+            ++m_count;
+            m_sum += static_cast<double>(ns);
+            m_min = std::min(m_min, ns);
+            m_max = std::max(m_max, ns);
+        }
+
+        auto count() const noexcept
+        {
+            return m_count;
+        }
+
+        auto min() const noexcept
+        {
+            return m_count == 0u ? std::uint64_t{0u} : m_min;
+        }
+
+        auto max() const noexcept
+        {
+            return m_max;
+        }
+
+        auto mean() const noexcept
+        {
+            return m_count == 0u ? 0.0 : m_sum / static_cast<double>(m_count);
+        }
+
+        auto quantile(double q) const noexcept -> std::uint64_t
+        {
+            if(m_count == 0u)
+                return 0u;
+
+            auto const rank = static_cast<std::uint64_t>(q * static_cast<double>(m_count - 1u)) + 1u;
+            auto seen = std::uint64_t{0u};
+            for(auto i = std::size_t{0u}; i < m_buckets.size(); ++i)
+            {
+                seen += m_buckets[i];
+                if(seen >= rank)
+                    return std::min(std::max(midpoint(i), m_min), m_max);
+            }
+
+            return m_max;
+        }
+
+    private:
+        static constexpr auto sub_bits = 4u;
+        static constexpr auto sub_buckets = std::size_t{1u} << sub_bits;
+
+        // Values below sub_buckets are exact; above, the top sub_bits + 1 bits select the bucket
+        static auto index(std::uint64_t ns) noexcept -> std::size_t
+        {
+            if(ns < sub_buckets)
+                return static_cast<std::size_t>(ns);
+
+            auto msb = 63u;
+            while((ns >> msb) == 0u)
+                --msb;
+
+            auto const shift = msb - sub_bits;
+            return static_cast<std::size_t>((shift + 1u) * sub_buckets + ((ns >> shift) - sub_buckets));
+        }
+
+        static auto midpoint(std::size_t i) noexcept -> std::uint64_t
+        {
+            if(i < sub_buckets)
+                return i;
+
+            auto const shift = static_cast<unsigned>(i / sub_buckets - 1u);
+            auto const lower = (sub_buckets + i % sub_buckets) << shift;
+            return lower + ((std::uint64_t{1u} << shift) >> 1u);
+        }
+
+        std::array<std::uint64_t, (64u - sub_bits + 1u) * sub_buckets> m_buckets{};
+        std::uint64_t m_count{0u};
+        double m_sum{0.0};
+        std::uint64_t m_min{std::numeric_limits<std::uint64_t>::max()};
+        std::uint64_t m_max{0u};
+    };
+
+    // Flows with the same name (and category) are aggregated, no matter how many Flow objects describe them
+    struct flow_stats
+    {
+        std::mutex mutex;
+        histogram latencies{};
+
+        // The end of a flow instance may be seen before its beginning; the bool is true for ends
+        std::unordered_map<std::uint64_t, std::pair<clock::time_point, bool>> pending{};
+    };
+
+    class registry
+    {
+    public:
+        registry() = default;
+        registry(registry const&) = delete;
+        auto operator=(registry const&) -> registry& = delete;
+
+        ~registry()
+        {
+            if(m_stats.empty())
+                return;
+
+            auto const user_file = std::getenv("BACTRIA_LATENCY_FILE");
+            auto out = (user_file != nullptr) ? std::fopen(user_file, "w") : stderr;
+            if(out == nullptr)
+            {
+                std::fprintf(stderr, "WARNING: bactria's latency plugin failed to open %s.\n", user_file);
+                out = stderr;
+            }
+
+            std::fprintf(
+                out,
+                "%-32s %-24s %10s %12s %12s %12s %12s %12s %12s %12s %8s\n",
+                "flow",
+                "category",
+                "count",
+                "min [us]",
+                "mean [us]",
+                "p50 [us]",
+                "p90 [us]",
+                "p99 [us]",
+                "p99.9 [us]",
+                "max [us]",
+                "pending");
+
+            auto const us = [](auto ns) { return static_cast<double>(ns) / 1000.0; };
+            for(auto const& entry : m_stats)
+            {
+                auto const& h = entry.second->latencies;
+                std::fprintf(
+                    out,
+                    "%-32s %-24s %10llu %12.3f %12.3f %12.3f %12.3f %12.3f %12.3f %12.3f %8zu\n",
+                    entry.first.first.c_str(),
+                    entry.first.second.c_str(),
+                    static_cast<unsigned long long>(h.count()),
+                    us(h.min()),
+                    us(h.mean()),
+                    us(h.quantile(0.5)),
+                    us(h.quantile(0.9)),
+                    us(h.quantile(0.99)),
+                    us(h.quantile(0.999)),
+                    us(h.max()),
+                    entry.second->pending.size());
+            }
+
+            if(out != stderr)
+                std::fclose(out);
+        }
+
+        auto get(std::string name, std::string cat_name) -> flow_stats*
+        {
+            std::lock_guard<std::mutex> const lock{m_mutex};
+            auto& stats = m_stats[std::make_pair(std::move(name), std::move(cat_name))];
+            if(stats == nullptr)
+                stats = std::make_unique<flow_stats>();
+
+            return stats.get();
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::map<std::pair<std::string, std::string>, std::unique_ptr<flow_stats>> m_stats;
+    };
+
+    registry flows;
+
+    auto match(flow_stats& stats, std::uint64_t flow_id, bool is_end) noexcept
+    {
+        auto const now = clock::now();
+
+        std::lock_guard<std::mutex> const lock{stats.mutex};
+        auto const it = stats.pending.find(flow_id);
+        if(it == stats.pending.end() || it->second.second == is_end)
+        {
+            // Unmatched so far. A repeated begin (or end) for the same ID replaces the older one.
+            stats.pending[flow_id] = std::make_pair(now, is_end);
+            return;
+        }
+
+        auto const begin = is_end ? it->second.first : now;
+        auto const end = is_end ? now : it->second.first;
+        auto const latency = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+        stats.latencies.add(latency > 0 ? static_cast<std::uint64_t>(latency) : 0u);
+        stats.pending.erase(it);
+    }
+} // namespace
+
+extern "C"
+{
+    auto bactria_ranges_register_category(std::uint32_t /* cat_id */, char const* /* cat_name */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_create_event(
+        std::uint32_t /* color */,
+        char const* /* cat_name */,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return nullptr;
+    }
+
+    auto bactria_ranges_destroy_event(void* /* event_handle */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_fire_event(
+        void* /* event_handle */,
+        char const* /* event_name */,
+        std::uint32_t /* payload_type */,
+        std::uint64_t /* payload */,
+        char const* /* source */,
+        std::uint32_t /* lineno */,
+        char const* /* caller */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_create_range(
+        char const* /* name */,
+        std::uint32_t /* color */,
+        char const* /* cat_name */,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return nullptr;
+    }
+
+    auto bactria_ranges_destroy_range(void* /* range_handle */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_start_range(
+        void* /* range_handle */,
+        std::uint32_t /* payload_type */,
+        std::uint64_t /* payload */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_stop_range(void* /* range_handle */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_start_async_range(void* /* range_handle */, std::uint64_t /* correlation_id */) noexcept
+        -> void
+    {
+    }
+
+    auto bactria_ranges_stop_async_range(void* /* range_handle */, std::uint64_t /* correlation_id */) noexcept
+        -> void
+    {
+    }
+
+    auto bactria_ranges_push_range(
+        char const* /* name */,
+        std::uint32_t /* color */,
+        char const* /* cat_name */,
+        std::uint32_t /* cat_id */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_pop_range() noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_create_counter(
+        char const* /* name */,
+        std::uint32_t /* color */,
+        char const* /* cat_name */,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return nullptr;
+    }
+
+    auto bactria_ranges_destroy_counter(void* /* counter_handle */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_sample_counter(
+        void* /* counter_handle */,
+        std::uint32_t /* value_type */,
+        std::uint64_t /* value */) noexcept -> void
+    {
+    }
+
+    // The null handle keeps bactria from buffering any spans
+    auto bactria_ranges_create_timeline(
+        char const* /* name */,
+        char const* const* /* span_names */,
+        std::uint32_t /* span_name_count */,
+        std::uint32_t /* color */,
+        char const* /* cat_name */,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return nullptr;
+    }
+
+    auto bactria_ranges_destroy_timeline(void* /* timeline_handle */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_submit_spans(
+        void* /* timeline_handle */,
+        bactria::ranges::Span const* /* spans */,
+        std::size_t /* count */) noexcept -> void
+    {
+    }
+
+    // The statistics outlive the handle so they can be reported at unload
+    auto bactria_ranges_create_flow(
+        char const* name,
+        std::uint32_t /* color */,
+        char const* cat_name,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return flows.get(name, cat_name);
+    }
+
+    auto bactria_ranges_destroy_flow(void* /* flow_handle */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_begin_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        match(*static_cast<flow_stats*>(flow_handle), flow_id, false);
+    }
+
+    auto bactria_ranges_end_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        match(*static_cast<flow_stats*>(flow_handle), flow_id, true);
+    }
+}
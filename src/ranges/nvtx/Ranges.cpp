@@ -17,32 +17,106 @@
 
 #include <nvToolsExt.h>
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
 
 namespace
 {
+    // All of bactria's markers live in their own domain so they can be told apart from the application's markers
+    auto const domain = nvtxDomainCreateA("bactria");
+
+    // The message is filled in by the caller
+    auto make_attributes(std::uint32_t color, std::uint32_t cat_id) noexcept
+    {
+        return nvtxEventAttributes_t{
+            /* .version = */ NVTX_VERSION,
+            /* .size = */ NVTX_EVENT_ATTRIB_STRUCT_SIZE,
+            /* .category = */ cat_id,
+            /* .colorType = */ NVTX_COLOR_ARGB,
+            /* .color = */ color,
+            /* .payloadType = */ NVTX_PAYLOAD_UNKNOWN,
+            /* .reserved0 = */ 0,
+            /* .payload = */ 0,
+            /* .messageType = */ NVTX_MESSAGE_TYPE_ASCII,
+            /* .message = */ nullptr};
+    }
+
+    auto make_registered_attributes(char const* name, std::uint32_t color, std::uint32_t cat_id) noexcept
+    {
+        auto attributes = make_attributes(color, cat_id);
+        attributes.messageType = NVTX_MESSAGE_TYPE_REGISTERED;
+        attributes.message.registered = nvtxDomainRegisterStringA(domain, name);
+        return attributes;
+    }
+
+    auto set_payload(nvtxEventAttributes_t& attributes, std::uint32_t type, std::uint64_t bits) noexcept
+    {
+        auto const payload = bactria::ranges::Payload{type, bits};
+        switch(payload.get_type())
+        {
+        case bactria::ranges::payload_type::int64:
+            attributes.payloadType = NVTX_PAYLOAD_TYPE_INT64;
+            attributes.payload.llValue = payload.as_int64();
+            break;
+        case bactria::ranges::payload_type::uint64:
+            attributes.payloadType = NVTX_PAYLOAD_TYPE_UNSIGNED_INT64;
+            attributes.payload.ullValue = payload.as_uint64();
+            break;
+        case bactria::ranges::payload_type::float64:
+            attributes.payloadType = NVTX_PAYLOAD_TYPE_DOUBLE;
+            attributes.payload.dValue = payload.as_double();
+            break;
+        default:
+            attributes.payloadType = NVTX_PAYLOAD_UNKNOWN;
+            attributes.payload.ullValue = 0u;
+            break;
+        }
+    }
+
     struct event
     {
-        std::uint32_t color;
-        char const* cat_name;
-        std::uint32_t cat_id;
+        nvtxEventAttributes_t attributes;
+        std::string registered_name{};
     };
 
     struct range
     {
-        char const* name;
-        std::uint32_t color;
-        char const* cat_name;
-        std::uint32_t cat_id;
+        nvtxEventAttributes_t attributes;
         nvtxRangeId_t id;
     };
+
+    struct counter
+    {
+        nvtxEventAttributes_t attributes;
+    };
+
+    struct flow
+    {
+        nvtxEventAttributes_t begin_attributes;
+        nvtxEventAttributes_t end_attributes;
+    };
+
+    auto mark_flow(nvtxEventAttributes_t attributes, std::uint64_t flow_id) noexcept
+    {
+        // The attributes are copied because both ends of a flow may be marked concurrently
+        attributes.payloadType = NVTX_PAYLOAD_TYPE_UNSIGNED_INT64;
+        attributes.payload.ullValue = flow_id;
+        nvtxDomainMarkEx(domain, &attributes);
+    }
 } // namespace
 
 extern "C"
 {
-    auto bactria_ranges_create_event(std::uint32_t color, char const* cat_name, std::uint32_t cat_id) noexcept -> void*
+    auto bactria_ranges_register_category(std::uint32_t cat_id, char const* cat_name) noexcept -> void
+    {
+        nvtxDomainNameCategoryA(domain, cat_id, cat_name);
+    }
+
+    auto bactria_ranges_create_event(std::uint32_t color, char const* /* cat_name */, std::uint32_t cat_id) noexcept
+        -> void*
     {
-        return new event{color, cat_name, cat_id};
+        return new event{make_attributes(color, cat_id)};
     }
 
     auto bactria_ranges_destroy_event(void* event_handle) noexcept -> void
@@ -54,36 +128,44 @@ extern "C"
     auto bactria_ranges_fire_event(
         void* event_handle,
         char const* event_name,
-        char const* source,
-        std::uint32_t lineno,
-        char const* caller) noexcept -> void
+        std::uint32_t payload_type,
+        std::uint64_t payload,
+        char const* /* source */,
+        std::uint32_t /* lineno */,
+        char const* /* caller */) noexcept -> void
     {
         auto const ev = static_cast<event*>(event_handle);
 
-        auto const attributes = nvtxEventAttributes_t{
-            /* .version = */ NVTX_VERSION,
-            /* .size = */ NVTX_EVENT_ATTRIB_STRUCT_SIZE,
-            /* .category = */ ev->cat_id,
-            /* .colorType = */ NVTX_COLOR_ARGB,
-            /* .color = */ ev->color,
-            /* .payloadType = */ NVTX_PAYLOAD_UNKNOWN, // currently not supported
-            /* .reserved0 = */ 0,
-            /* .payload = */ 0,
-            /* .messageType = */ NVTX_MESSAGE_TYPE_ASCII,
-            /* .message = */ event_name};
-
-        nvtxNameCategoryA(ev->cat_id, ev->cat_name);
+        /* The event name is only known on firing and may be generated by an action. Register the first name and
+         * reuse it as long as it doesn't change. Changing names are sent as ASCII messages, otherwise each of them
+         * would occupy a registered string for the rest of the program. */
+        if(ev->registered_name.empty())
+        {
+            ev->registered_name = event_name;
+            ev->attributes = make_registered_attributes(event_name, ev->attributes.color, ev->attributes.category);
+        }
 
-        nvtxMarkEx(&attributes);
+        if(ev->registered_name == event_name)
+        {
+            set_payload(ev->attributes, payload_type, payload);
+            nvtxDomainMarkEx(domain, &ev->attributes);
+        }
+        else
+        {
+            auto attributes = make_attributes(ev->attributes.color, ev->attributes.category);
+            attributes.message.ascii = event_name;
+            set_payload(attributes, payload_type, payload);
+            nvtxDomainMarkEx(domain, &attributes);
+        }
     }
 
     auto bactria_ranges_create_range(
         char const* name,
         std::uint32_t color,
-        char const* cat_name,
+        char const* /* cat_name */,
         std::uint32_t cat_id) noexcept -> void*
     {
-        return new range{name, color, cat_name, cat_id, nvtxRangeId_t{}};
+        return new range{make_registered_attributes(name, color, cat_id), nvtxRangeId_t{}};
     }
 
     auto bactria_ranges_destroy_range(void* range_handle) noexcept -> void
@@ -92,30 +174,130 @@ extern "C"
         delete r;
     }
 
-    auto bactria_ranges_start_range(void* range_handle) noexcept -> void
+    auto bactria_ranges_start_range(void* range_handle, std::uint32_t payload_type, std::uint64_t payload) noexcept
+        -> void
     {
         auto r = static_cast<range*>(range_handle);
+        set_payload(r->attributes, payload_type, payload);
+        r->id = nvtxDomainRangeStartEx(domain, &r->attributes);
+    }
 
-        auto const attributes = nvtxEventAttributes_t{
-            /* .version = */ NVTX_VERSION,
-            /* .size = */ NVTX_EVENT_ATTRIB_STRUCT_SIZE,
-            /* .category = */ r->cat_id,
-            /* .colorType = */ NVTX_COLOR_ARGB,
-            /* .color = */ r->color,
-            /* .payloadType = */ NVTX_PAYLOAD_UNKNOWN, // currently not supported
-            /* .reserved0 = */ 0,
-            /* .payload = */ 0,
-            /* .messageType = */ NVTX_MESSAGE_TYPE_ASCII,
-            /* .message = */ r->name};
+    auto bactria_ranges_stop_range(void* range_handle) noexcept -> void
+    {
+        auto const r = static_cast<range*>(range_handle);
+        nvtxDomainRangeEnd(domain, r->id);
+    }
 
-        nvtxNameCategoryA(r->cat_id, r->cat_name);
+    // Start / end ranges are not bound to a thread, so they can be used for async ranges directly
+    auto bactria_ranges_start_async_range(void* range_handle, std::uint64_t correlation_id) noexcept -> void
+    {
+        auto r = static_cast<range*>(range_handle);
 
-        r->id = nvtxRangeStartEx(&attributes);
+        auto attributes = r->attributes;
+        set_payload(attributes, static_cast<std::uint32_t>(bactria::ranges::payload_type::uint64), correlation_id);
+
+        r->id = nvtxDomainRangeStartEx(domain, &attributes);
     }
 
-    auto bactria_ranges_stop_range(void* range_handle) noexcept -> void
+    auto bactria_ranges_stop_async_range(void* range_handle, std::uint64_t /* correlation_id */) noexcept -> void
     {
         auto const r = static_cast<range*>(range_handle);
-        nvtxRangeEnd(r->id);
+        nvtxDomainRangeEnd(domain, r->id);
+    }
+
+    // NVTX maintains the per-thread range stack for us
+    auto bactria_ranges_push_range(
+        char const* name,
+        std::uint32_t color,
+        char const* /* cat_name */,
+        std::uint32_t cat_id) noexcept -> void
+    {
+        // There is no handle to keep a registered string in, so pushed ranges use ASCII messages
+        auto attributes = make_attributes(color, cat_id);
+        attributes.message.ascii = name;
+
+        nvtxDomainRangePushEx(domain, &attributes);
+    }
+
+    auto bactria_ranges_pop_range() noexcept -> void
+    {
+        nvtxDomainRangePop(domain);
+    }
+
+    auto bactria_ranges_create_counter(
+        char const* name,
+        std::uint32_t color,
+        char const* /* cat_name */,
+        std::uint32_t cat_id) noexcept -> void*
+    {
+        return new counter{make_registered_attributes(name, color, cat_id)};
+    }
+
+    auto bactria_ranges_destroy_counter(void* counter_handle) noexcept -> void
+    {
+        auto c = static_cast<counter*>(counter_handle);
+        delete c;
+    }
+
+    // NVTX has no counter API, but Nsight Systems shows the payload of marks and can plot them
+    auto bactria_ranges_sample_counter(void* counter_handle, std::uint32_t value_type, std::uint64_t value) noexcept
+        -> void
+    {
+        auto c = static_cast<counter*>(counter_handle);
+        set_payload(c->attributes, value_type, value);
+        nvtxDomainMarkEx(domain, &c->attributes);
+    }
+
+    // NVTX can't record ranges with explicit timestamps. The null handle keeps bactria from buffering any spans.
+    auto bactria_ranges_create_timeline(
+        char const* /* name */,
+        char const* const* /* span_names */,
+        std::uint32_t /* span_name_count */,
+        std::uint32_t /* color */,
+        char const* /* cat_name */,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return nullptr;
+    }
+
+    auto bactria_ranges_destroy_timeline(void* /* timeline_handle */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_submit_spans(
+        void* /* timeline_handle */,
+        bactria::ranges::Span const* /* spans */,
+        std::size_t /* count */) noexcept -> void
+    {
+    }
+
+    // NVTX has no flow API. Both ends become marks carrying the flow ID as payload so they can be matched up.
+    auto bactria_ranges_create_flow(
+        char const* name,
+        std::uint32_t color,
+        char const* /* cat_name */,
+        std::uint32_t cat_id) noexcept -> void*
+    {
+        auto const begin_name = std::string{name} + " [begin]";
+        auto const end_name = std::string{name} + " [end]";
+        return new flow{
+            make_registered_attributes(begin_name.c_str(), color, cat_id),
+            make_registered_attributes(end_name.c_str(), color, cat_id)};
+    }
+
+    auto bactria_ranges_destroy_flow(void* flow_handle) noexcept -> void
+    {
+        auto f = static_cast<flow*>(flow_handle);
+        delete f;
+    }
+
+    auto bactria_ranges_begin_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        mark_flow(static_cast<flow const*>(flow_handle)->begin_attributes, flow_id);
+    }
+
+    auto bactria_ranges_end_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        mark_flow(static_cast<flow const*>(flow_handle)->end_attributes, flow_id);
     }
 }
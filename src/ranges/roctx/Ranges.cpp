@@ -17,21 +17,39 @@
 
 #include <roctx.h>
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
 namespace
 {
     struct event
     {
     };
 
+    struct counter
+    {
+    };
+
     struct range
     {
-        char const* message;
+        std::string message;
         roctx_range_id_t id;
     };
+
+    struct flow
+    {
+        std::string name;
+    };
 } // namespace
 
 extern "C"
 {
+    auto bactria_ranges_register_category(std::uint32_t /* cat_id */, char const* /* cat_name */) noexcept -> void
+    {
+        // rocTX currently doesn't support categories
+    }
+
     auto bactria_ranges_create_event(
         std::uint32_t /* color */,
         char const* cat_name,
@@ -50,6 +68,8 @@ extern "C"
     auto bactria_ranges_fire_event(
         void* event_handle,
         char const* event_name,
+        std::uint32_t /* payload_type */,
+        std::uint64_t /* payload */,
         char const* source,
         std::uint32_t lineno,
         char const* caller) noexcept -> void
@@ -74,10 +94,14 @@ extern "C"
         delete r;
     }
 
-    auto bactria_ranges_start_range(void* range_handle) noexcept -> void
+    // rocTX currently doesn't support payloads
+    auto bactria_ranges_start_range(
+        void* range_handle,
+        std::uint32_t /* payload_type */,
+        std::uint64_t /* payload */) noexcept -> void
     {
         auto r = static_cast<range*>(range_handle);
-        r->id = roctxRangeStartA(r->message);
+        r->id = roctxRangeStartA(r->message.c_str());
     }
 
     auto bactria_ranges_stop_range(void* range_handle) noexcept -> void
@@ -85,4 +109,108 @@ extern "C"
         auto const r = static_cast<range*>(range_handle);
         roctxRangeStop(r->id);
     }
-}
\ No newline at end of file
+
+    // roctxRangeStartA / roctxRangeStop are process-wide, so they can be used for async ranges directly
+    auto bactria_ranges_start_async_range(void* range_handle, std::uint64_t /* correlation_id */) noexcept -> void
+    {
+        auto r = static_cast<range*>(range_handle);
+        r->id = roctxRangeStartA(r->message.c_str());
+    }
+
+    auto bactria_ranges_stop_async_range(void* range_handle, std::uint64_t /* correlation_id */) noexcept -> void
+    {
+        auto const r = static_cast<range*>(range_handle);
+        roctxRangeStop(r->id);
+    }
+
+    // rocTX maintains the per-thread range stack for us
+    auto bactria_ranges_push_range(
+        char const* name,
+        std::uint32_t /* color */,
+        char const* /* cat_name */,
+        std::uint32_t /* cat_id */) noexcept -> void
+    {
+        roctxRangePushA(name);
+    }
+
+    auto bactria_ranges_pop_range() noexcept -> void
+    {
+        roctxRangePop();
+    }
+
+    auto bactria_ranges_create_counter(
+        char const* /* name */,
+        std::uint32_t /* color */,
+        char const* /* cat_name */,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        // rocTX currently doesn't support counters
+        return new counter;
+    }
+
+    auto bactria_ranges_destroy_counter(void* counter_handle) noexcept -> void
+    {
+        auto c = static_cast<counter*>(counter_handle);
+        delete c;
+    }
+
+    auto bactria_ranges_sample_counter(
+        void* /* counter_handle */,
+        std::uint32_t /* value_type */,
+        std::uint64_t /* value */) noexcept -> void
+    {
+    }
+
+    // rocTX can't record ranges with explicit timestamps. The null handle keeps bactria from buffering any spans.
+    auto bactria_ranges_create_timeline(
+        char const* /* name */,
+        char const* const* /* span_names */,
+        std::uint32_t /* span_name_count */,
+        std::uint32_t /* color */,
+        char const* /* cat_name */,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return nullptr;
+    }
+
+    auto bactria_ranges_destroy_timeline(void* /* timeline_handle */) noexcept -> void
+    {
+    }
+
+    auto bactria_ranges_submit_spans(
+        void* /* timeline_handle */,
+        bactria::ranges::Span const* /* spans */,
+        std::size_t /* count */) noexcept -> void
+    {
+    }
+
+    // rocTX has neither flows nor payloads, so the flow ID becomes part of the mark's message
+    auto bactria_ranges_create_flow(
+        char const* name,
+        std::uint32_t /* color */,
+        char const* /* cat_name */,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return new flow{name};
+    }
+
+    auto bactria_ranges_destroy_flow(void* flow_handle) noexcept -> void
+    {
+        auto f = static_cast<flow*>(flow_handle);
+        delete f;
+    }
+
+    auto bactria_ranges_begin_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        auto const f = static_cast<flow const*>(flow_handle);
+        auto const message = f->name + " [begin " + std::to_string(flow_id) + "]";
+        roctxMarkA(message.c_str());
+    }
+
+    auto bactria_ranges_end_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        auto const f = static_cast<flow const*>(flow_handle);
+        auto const message = f->name + " [end " + std::to_string(flow_id) + "]";
+        roctxMarkA(message.c_str());
+    }
+}
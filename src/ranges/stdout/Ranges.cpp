@@ -20,8 +20,13 @@
 #include <fmt/core.h>
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace
 {
@@ -30,22 +35,74 @@ namespace
     struct event
     {
         std::uint32_t color;
-        char const* cat_name;
+        std::string cat_name;
         std::uint32_t cat_id;
     };
 
     struct range
     {
-        char const* name;
+        std::string name;
         std::uint32_t color;
-        char const* cat_name;
+        std::string cat_name;
         std::uint32_t cat_id;
         std::chrono::steady_clock::time_point start{};
     };
+
+    struct counter
+    {
+        std::string name;
+        std::uint32_t color;
+        std::string cat_name;
+    };
+
+    struct timeline
+    {
+        std::string name;
+        std::vector<std::string> span_names;
+        std::uint32_t color;
+        std::string cat_name;
+    };
+
+    struct flow
+    {
+        std::string name;
+        std::uint32_t color;
+        std::string cat_name;
+    };
+
+    // Pushed ranges are strictly nested per thread
+    thread_local auto range_stack = std::vector<range>{};
+
+    auto format_payload(std::uint32_t type, std::uint64_t bits) -> std::string
+    {
+        auto const payload = bactria::ranges::Payload{type, bits};
+        switch(payload.get_type())
+        {
+        case bactria::ranges::payload_type::int64:
+            return fmt::format(" [value {}]", payload.as_int64());
+        case bactria::ranges::payload_type::uint64:
+            return fmt::format(" [value {}]", payload.as_uint64());
+        case bactria::ranges::payload_type::float64:
+            return fmt::format(" [value {}]", payload.as_double());
+        default:
+            return std::string{};
+        }
+    }
+
+    // std::thread::id can't be printed by {fmt} directly
+    auto thread_id() noexcept
+    {
+        return std::hash<std::thread::id>{}(std::this_thread::get_id());
+    }
 } // namespace
 
 extern "C"
 {
+    auto bactria_ranges_register_category(std::uint32_t cat_id, char const* cat_name) noexcept -> void
+    {
+        fmt::print("Registering category {} with ID {}\n", cat_name, cat_id);
+    }
+
     auto bactria_ranges_create_event(std::uint32_t color, char const* cat_name, std::uint32_t cat_id) noexcept -> void*
     {
         return new event{color, cat_name, cat_id};
@@ -60,6 +117,8 @@ extern "C"
     auto bactria_ranges_fire_event(
         void* event_handle,
         char const* event_name,
+        std::uint32_t payload_type,
+        std::uint64_t payload,
         char const* source,
         std::uint32_t lineno,
         char const* caller) noexcept -> void
@@ -72,8 +131,9 @@ extern "C"
 
         fmt::print(
             fg(fmt::rgb(ev->color)),
-            "Event {} (Category {}) fired in {} at {}:{} after {:.3}.\n",
+            "Event {}{} (Category {}) fired in {} at {}:{} after {:.3}.\n",
             event_name,
+            format_payload(payload_type, payload),
             ev->cat_name,
             caller,
             source,
@@ -96,14 +156,20 @@ extern "C"
         delete r;
     }
 
-    auto bactria_ranges_start_range(void* range_handle) noexcept -> void
+    auto bactria_ranges_start_range(void* range_handle, std::uint32_t payload_type, std::uint64_t payload) noexcept
+        -> void
     {
         auto const now = std::chrono::steady_clock::now();
 
         auto r = static_cast<range*>(range_handle);
         r->start = now;
 
-        fmt::print(fg(fmt::rgb(r->color)), "Entering range {} (Category {})\n", r->name, r->cat_name);
+        fmt::print(
+            fg(fmt::rgb(r->color)),
+            "Entering range {}{} (Category {})\n",
+            r->name,
+            format_payload(payload_type, payload),
+            r->cat_name);
     }
 
     auto bactria_ranges_stop_range(void* range_handle) noexcept -> void
@@ -122,4 +188,201 @@ extern "C"
             r->cat_name,
             elapsed);
     }
+
+    auto bactria_ranges_start_async_range(void* range_handle, std::uint64_t correlation_id) noexcept -> void
+    {
+        auto const now = std::chrono::steady_clock::now();
+
+        auto r = static_cast<range*>(range_handle);
+        r->start = now;
+
+        fmt::print(
+            fg(fmt::rgb(r->color)),
+            "Starting async range {} [{}] (Category {}) on thread {}\n",
+            r->name,
+            correlation_id,
+            r->cat_name,
+            thread_id());
+    }
+
+    auto bactria_ranges_stop_async_range(void* range_handle, std::uint64_t correlation_id) noexcept -> void
+    {
+        using precise_duration = std::chrono::duration<double, std::micro>;
+
+        auto const now = std::chrono::steady_clock::now();
+        auto r = static_cast<range*>(range_handle);
+
+        auto const elapsed = std::chrono::duration_cast<precise_duration>(now - r->start);
+
+        fmt::print(
+            fg(fmt::rgb(r->color)),
+            "Stopping async range {} [{}] (Category {}) on thread {} after {:.3}\n",
+            r->name,
+            correlation_id,
+            r->cat_name,
+            thread_id(),
+            elapsed);
+    }
+
+    auto bactria_ranges_push_range(
+        char const* name,
+        std::uint32_t color,
+        char const* cat_name,
+        std::uint32_t cat_id) noexcept -> void
+    {
+        fmt::print(fg(fmt::rgb(color)), "Pushing range {} (Category {})\n", name, cat_name);
+
+        range_stack.push_back(range{name, color, cat_name, cat_id, std::chrono::steady_clock::now()});
+    }
+
+    auto bactria_ranges_pop_range() noexcept -> void
+    {
+        using precise_duration = std::chrono::duration<double, std::micro>;
+
+        auto const now = std::chrono::steady_clock::now();
+        if(range_stack.empty())
+            return;
+
+        auto const& r = range_stack.back();
+        auto const elapsed = std::chrono::duration_cast<precise_duration>(now - r.start);
+
+        fmt::print(
+            fg(fmt::rgb(r.color)),
+            "Popping range {} (Category {}) after {:.3}\n",
+            r.name,
+            r.cat_name,
+            elapsed);
+
+        range_stack.pop_back();
+    }
+
+    auto bactria_ranges_create_counter(
+        char const* name,
+        std::uint32_t color,
+        char const* cat_name,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return new counter{name, color, cat_name};
+    }
+
+    auto bactria_ranges_destroy_counter(void* counter_handle) noexcept -> void
+    {
+        auto c = static_cast<counter*>(counter_handle);
+        delete c;
+    }
+
+    auto bactria_ranges_sample_counter(void* counter_handle, std::uint32_t value_type, std::uint64_t value) noexcept
+        -> void
+    {
+        using precise_duration = std::chrono::duration<double, std::micro>;
+        auto const timestamp = std::chrono::steady_clock::now();
+        auto const elapsed = std::chrono::duration_cast<precise_duration>(timestamp - exec_stamp);
+
+        auto const c = static_cast<counter const*>(counter_handle);
+
+        fmt::print(
+            fg(fmt::rgb(c->color)),
+            "Counter {}{} (Category {}) sampled after {:.3}.\n",
+            c->name,
+            format_payload(value_type, value),
+            c->cat_name,
+            elapsed);
+    }
+
+    auto bactria_ranges_create_timeline(
+        char const* name,
+        char const* const* span_names,
+        std::uint32_t span_name_count,
+        std::uint32_t color,
+        char const* cat_name,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return new timeline{name, {span_names, span_names + span_name_count}, color, cat_name};
+    }
+
+    auto bactria_ranges_destroy_timeline(void* timeline_handle) noexcept -> void
+    {
+        auto t = static_cast<timeline*>(timeline_handle);
+        delete t;
+    }
+
+    auto bactria_ranges_submit_spans(
+        void* timeline_handle,
+        bactria::ranges::Span const* spans,
+        std::size_t count) noexcept -> void
+    {
+        using precise_duration = std::chrono::duration<double, std::micro>;
+
+        auto const t = static_cast<timeline const*>(timeline_handle);
+        auto const origin = exec_stamp.time_since_epoch();
+
+        for(auto i = std::size_t{0u}; i < count; ++i)
+        {
+            auto const& s = spans[i];
+            auto const start = std::chrono::nanoseconds{s.start} - origin;
+            auto const end = std::chrono::nanoseconds{s.end} - origin;
+            auto const name = (s.name_id < t->span_names.size()) ? t->span_names[s.name_id] : std::string{"?"};
+
+            fmt::print(
+                fg(fmt::rgb(t->color)),
+                "Span {} (Timeline {}, track {}, Category {}) from {:.3} to {:.3}\n",
+                name,
+                t->name,
+                s.track,
+                t->cat_name,
+                std::chrono::duration_cast<precise_duration>(start),
+                std::chrono::duration_cast<precise_duration>(end));
+        }
+    }
+
+    auto bactria_ranges_create_flow(
+        char const* name,
+        std::uint32_t color,
+        char const* cat_name,
+        std::uint32_t /* cat_id */) noexcept -> void*
+    {
+        return new flow{name, color, cat_name};
+    }
+
+    auto bactria_ranges_destroy_flow(void* flow_handle) noexcept -> void
+    {
+        auto f = static_cast<flow*>(flow_handle);
+        delete f;
+    }
+
+    auto bactria_ranges_begin_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        using precise_duration = std::chrono::duration<double, std::micro>;
+        auto const timestamp = std::chrono::steady_clock::now();
+        auto const elapsed = std::chrono::duration_cast<precise_duration>(timestamp - exec_stamp);
+
+        auto const f = static_cast<flow const*>(flow_handle);
+
+        fmt::print(
+            fg(fmt::rgb(f->color)),
+            "Flow {} [{}] (Category {}) begins on thread {} after {:.3}\n",
+            f->name,
+            flow_id,
+            f->cat_name,
+            thread_id(),
+            elapsed);
+    }
+
+    auto bactria_ranges_end_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        using precise_duration = std::chrono::duration<double, std::micro>;
+        auto const timestamp = std::chrono::steady_clock::now();
+        auto const elapsed = std::chrono::duration_cast<precise_duration>(timestamp - exec_stamp);
+
+        auto const f = static_cast<flow const*>(flow_handle);
+
+        fmt::print(
+            fg(fmt::rgb(f->color)),
+            "Flow {} [{}] (Category {}) ends on thread {} after {:.3}\n",
+            f->name,
+            flow_id,
+            f->cat_name,
+            thread_id(),
+            elapsed);
+    }
 }
@@ -0,0 +1,332 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+#include <bactria/ranges/PluginInterface.hpp>
+
+// Every probe gets a semaphore which is incremented by the tracer (perf, bpftrace, SystemTap, ...) on attachment
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* The semaphore names are dictated by sys/sdt.h: <provider>_<probe>_semaphore. They have to live in the .probes
+ * section so the tracer can find and modify them. */
+#define BACTRIA_USDT_SEMAPHORE(probe)                                                                                 \
+    __extension__ unsigned short bactria_##probe##_semaphore __attribute__((unused, section(".probes")))
+
+// Only evaluate the probe arguments if a tracer is attached to the probe
+#define BACTRIA_USDT_ENABLED(probe) __builtin_expect(bactria_##probe##_semaphore != 0, 0)
+
+extern "C"
+{
+    BACTRIA_USDT_SEMAPHORE(category_register);
+    BACTRIA_USDT_SEMAPHORE(event_fire);
+    BACTRIA_USDT_SEMAPHORE(range_start);
+    BACTRIA_USDT_SEMAPHORE(range_stop);
+    BACTRIA_USDT_SEMAPHORE(async_range_start);
+    BACTRIA_USDT_SEMAPHORE(async_range_stop);
+    BACTRIA_USDT_SEMAPHORE(range_push);
+    BACTRIA_USDT_SEMAPHORE(range_pop);
+    BACTRIA_USDT_SEMAPHORE(counter_sample);
+    BACTRIA_USDT_SEMAPHORE(span);
+    BACTRIA_USDT_SEMAPHORE(flow_begin);
+    BACTRIA_USDT_SEMAPHORE(flow_end);
+}
+
+namespace
+{
+    struct event
+    {
+        std::uint32_t color;
+        std::string cat_name;
+        std::uint32_t cat_id;
+    };
+
+    struct range
+    {
+        std::string name;
+        std::uint32_t color;
+        std::string cat_name;
+        std::uint32_t cat_id;
+    };
+
+    struct counter
+    {
+        std::string name;
+        std::string cat_name;
+        std::uint32_t cat_id;
+    };
+
+    struct timeline
+    {
+        std::string name;
+        std::vector<std::string> span_names;
+        std::uint32_t cat_id;
+    };
+
+    struct flow
+    {
+        std::string name;
+        std::string cat_name;
+        std::uint32_t cat_id;
+    };
+} // namespace
+
+extern "C"
+{
+    auto bactria_ranges_register_category(std::uint32_t cat_id, char const* cat_name) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(category_register))
+            STAP_PROBE2(bactria, category_register, cat_id, cat_name);
+    }
+
+    auto bactria_ranges_create_event(std::uint32_t color, char const* cat_name, std::uint32_t cat_id) noexcept -> void*
+    {
+        return new event{color, cat_name, cat_id};
+    }
+
+    auto bactria_ranges_destroy_event(void* event_handle) noexcept -> void
+    {
+        auto ev = static_cast<event*>(event_handle);
+        delete ev;
+    }
+
+    auto bactria_ranges_fire_event(
+        void* event_handle,
+        char const* event_name,
+        std::uint32_t payload_type,
+        std::uint64_t payload,
+        char const* source,
+        std::uint32_t lineno,
+        char const* caller) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(event_fire))
+        {
+            auto const ev = static_cast<event const*>(event_handle);
+            STAP_PROBE9(
+                bactria,
+                event_fire,
+                event_name,
+                ev->cat_name.c_str(),
+                ev->cat_id,
+                ev->color,
+                payload_type,
+                payload,
+                source,
+                lineno,
+                caller);
+        }
+    }
+
+    auto bactria_ranges_create_range(
+        char const* name,
+        std::uint32_t color,
+        char const* cat_name,
+        std::uint32_t cat_id) noexcept -> void*
+    {
+        return new range{name, color, cat_name, cat_id};
+    }
+
+    auto bactria_ranges_destroy_range(void* range_handle) noexcept -> void
+    {
+        auto r = static_cast<range*>(range_handle);
+        delete r;
+    }
+
+    auto bactria_ranges_start_range(void* range_handle, std::uint32_t payload_type, std::uint64_t payload) noexcept
+        -> void
+    {
+        // The handle address identifies the range so the tracer can match start and stop
+        if(BACTRIA_USDT_ENABLED(range_start))
+        {
+            auto const r = static_cast<range const*>(range_handle);
+            STAP_PROBE7(
+                bactria,
+                range_start,
+                range_handle,
+                r->name.c_str(),
+                r->cat_name.c_str(),
+                r->cat_id,
+                r->color,
+                payload_type,
+                payload);
+        }
+    }
+
+    auto bactria_ranges_stop_range(void* range_handle) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(range_stop))
+        {
+            auto const r = static_cast<range const*>(range_handle);
+            STAP_PROBE4(bactria, range_stop, range_handle, r->name.c_str(), r->cat_name.c_str(), r->cat_id);
+        }
+    }
+
+    // Async ranges may start and stop on different threads; the tracer matches them by the correlation ID
+    auto bactria_ranges_start_async_range(void* range_handle, std::uint64_t correlation_id) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(async_range_start))
+        {
+            auto const r = static_cast<range const*>(range_handle);
+            STAP_PROBE6(
+                bactria,
+                async_range_start,
+                range_handle,
+                correlation_id,
+                r->name.c_str(),
+                r->cat_name.c_str(),
+                r->cat_id,
+                r->color);
+        }
+    }
+
+    auto bactria_ranges_stop_async_range(void* range_handle, std::uint64_t correlation_id) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(async_range_stop))
+        {
+            auto const r = static_cast<range const*>(range_handle);
+            STAP_PROBE5(
+                bactria,
+                async_range_stop,
+                range_handle,
+                correlation_id,
+                r->name.c_str(),
+                r->cat_name.c_str(),
+                r->cat_id);
+        }
+    }
+
+    // The tracer sees the thread of each probe, so it can maintain the per-thread range stack on its own
+    auto bactria_ranges_push_range(
+        char const* name,
+        std::uint32_t color,
+        char const* cat_name,
+        std::uint32_t cat_id) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(range_push))
+            STAP_PROBE4(bactria, range_push, name, cat_name, cat_id, color);
+    }
+
+    auto bactria_ranges_pop_range() noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(range_pop))
+            STAP_PROBE(bactria, range_pop);
+    }
+
+    auto bactria_ranges_create_counter(
+        char const* name,
+        std::uint32_t /* color */,
+        char const* cat_name,
+        std::uint32_t cat_id) noexcept -> void*
+    {
+        return new counter{name, cat_name, cat_id};
+    }
+
+    auto bactria_ranges_destroy_counter(void* counter_handle) noexcept -> void
+    {
+        auto c = static_cast<counter*>(counter_handle);
+        delete c;
+    }
+
+    auto bactria_ranges_sample_counter(void* counter_handle, std::uint32_t value_type, std::uint64_t value) noexcept
+        -> void
+    {
+        if(BACTRIA_USDT_ENABLED(counter_sample))
+        {
+            auto const c = static_cast<counter const*>(counter_handle);
+            STAP_PROBE6(
+                bactria,
+                counter_sample,
+                counter_handle,
+                c->name.c_str(),
+                c->cat_name.c_str(),
+                c->cat_id,
+                value_type,
+                value);
+        }
+    }
+
+    auto bactria_ranges_create_timeline(
+        char const* name,
+        char const* const* span_names,
+        std::uint32_t span_name_count,
+        std::uint32_t /* color */,
+        char const* /* cat_name */,
+        std::uint32_t cat_id) noexcept -> void*
+    {
+        return new timeline{name, {span_names, span_names + span_name_count}, cat_id};
+    }
+
+    auto bactria_ranges_destroy_timeline(void* timeline_handle) noexcept -> void
+    {
+        auto t = static_cast<timeline*>(timeline_handle);
+        delete t;
+    }
+
+    // One probe per span; the timestamps are nanoseconds of CLOCK_MONOTONIC like the tracer's own clock
+    auto bactria_ranges_submit_spans(
+        void* timeline_handle,
+        bactria::ranges::Span const* spans,
+        std::size_t count) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(span))
+        {
+            auto const t = static_cast<timeline const*>(timeline_handle);
+            for(auto i = std::size_t{0u}; i < count; ++i)
+            {
+                auto const& s = spans[i];
+                auto const name = (s.name_id < t->span_names.size()) ? t->span_names[s.name_id].c_str() : "";
+                STAP_PROBE7(bactria, span, timeline_handle, t->name.c_str(), name, t->cat_id, s.track, s.start, s.end);
+            }
+        }
+    }
+
+    auto bactria_ranges_create_flow(
+        char const* name,
+        std::uint32_t /* color */,
+        char const* cat_name,
+        std::uint32_t cat_id) noexcept -> void*
+    {
+        return new flow{name, cat_name, cat_id};
+    }
+
+    auto bactria_ranges_destroy_flow(void* flow_handle) noexcept -> void
+    {
+        auto f = static_cast<flow*>(flow_handle);
+        delete f;
+    }
+
+    // The tracer matches both ends by the flow ID and can compute the hand-over latency on its own
+    auto bactria_ranges_begin_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(flow_begin))
+        {
+            auto const f = static_cast<flow const*>(flow_handle);
+            STAP_PROBE5(bactria, flow_begin, flow_handle, flow_id, f->name.c_str(), f->cat_name.c_str(), f->cat_id);
+        }
+    }
+
+    auto bactria_ranges_end_flow(void* flow_handle, std::uint64_t flow_id) noexcept -> void
+    {
+        if(BACTRIA_USDT_ENABLED(flow_end))
+        {
+            auto const f = static_cast<flow const*>(flow_handle);
+            STAP_PROBE5(bactria, flow_end, flow_handle, flow_id, f->name.c_str(), f->cat_name.c_str(), f->cat_id);
+        }
+    }
+}
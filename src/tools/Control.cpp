@@ -0,0 +1,187 @@
+/* Copyright 2021 Jan Stephan
+ *
+ * Licensed under the EUPL, Version 1.2 or - as soon they will be approved by
+ * the European Commission - subsequent versions of the EUPL (the “Licence”).
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ *     http://ec.europa.eu/idabc/eupl.html
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the Licence is distributed on an “AS IS” basis, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  Licence permissions and limitations under the Licence.
+ */
+
+
+#include <bactria/core/Control.hpp>
+#include <bactria/core/Filter.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+/* bactria-ctl switches recording on and off in a process which runs with BACTRIA_CONTROL=on (or off). The switches
+ * are the global bit, one bit per category and one bit per site (a marker name in a category); a site records if all
+ * three are set and the process is inside a capture window (see BACTRIA_CAPTURE). Sectors and phases belong to the
+ * category "bactria.metrics". Changes take effect immediately. */
+
+namespace control = bactria::control;
+
+namespace
+{
+    auto usage(char const* program) -> int
+    {
+        std::fprintf(
+            stderr,
+            "Usage: %s <pid>                          Show the switches.\n"
+            "       %s <pid> on|off                   Switch recording on or off.\n"
+            "       %s <pid> category <glob> on|off   Switch the matching categories on or off.\n"
+            "       %s <pid> site <glob> on|off       Switch the matching sites on or off.\n"
+            "Sites can be selected by name or by <category>/<name>. Globs support * and ?.\n",
+            program,
+            program,
+            program,
+            program);
+        return EXIT_FAILURE;
+    }
+
+    auto parse_switch(char const* str, std::uint32_t& bit) -> bool
+    {
+        if(std::strcmp(str, "on") == 0)
+            bit = 1u;
+        else if(std::strcmp(str, "off") == 0)
+            bit = 0u;
+        else
+            return false;
+
+        return true;
+    }
+
+    auto state(control::site_flag const& flag) -> char const*
+    {
+        return control::is_enabled(flag) ? "on" : "off";
+    }
+
+    auto show(control::block& b) -> void
+    {
+        auto const categories = b.categories.load(std::memory_order_acquire);
+        auto const sites = b.sites.load(std::memory_order_acquire);
+
+        std::printf("recording: %s\n", state(b.global));
+        std::printf("capture window: %s\n\ncategories:\n", control::is_enabled(b.capture) ? "open" : "closed");
+        for(auto i = std::uint32_t{0u}; i < categories; ++i)
+            std::printf("  %-3s %s\n", state(b.category[i].enabled), b.category[i].name);
+
+        std::printf("\nsites (effective, site):\n");
+        for(auto i = std::uint32_t{0u}; i < sites; ++i)
+        {
+            auto const& s = b.site[i];
+            auto const category = b.category[s.category].name;
+            std::printf("  %-3s %-3s %s/%s\n", state(s.effective), state(s.enabled), category, s.name);
+        }
+
+        auto const overflow = b.overflow.load(std::memory_order_relaxed);
+        if(overflow != 0u)
+            std::printf("\n%u site(s) didn't fit into the block and only follow the global switch.\n", overflow);
+    }
+
+    // Returns the number of matching categories or sites
+    auto set(control::block& b, char const* what, char const* pattern, std::uint32_t bit) -> std::uint32_t
+    {
+        auto matches = std::uint32_t{0u};
+        control::block_lock const lock{b};
+
+        if(std::strcmp(what, "category") == 0)
+        {
+            auto const categories = b.categories.load(std::memory_order_acquire);
+            for(auto i = std::uint32_t{0u}; i < categories; ++i)
+            {
+                if(bactria::glob_match(pattern, b.category[i].name))
+                {
+                    b.category[i].enabled.store(bit, std::memory_order_relaxed);
+                    ++matches;
+                }
+            }
+        }
+        else if(std::strcmp(what, "site") == 0)
+        {
+            auto const sites = b.sites.load(std::memory_order_acquire);
+            for(auto i = std::uint32_t{0u}; i < sites; ++i)
+            {
+                auto& s = b.site[i];
+                auto const qualified = std::string{b.category[s.category].name} + '/' + s.name;
+                if(bactria::glob_match(pattern, s.name) || bactria::glob_match(pattern, qualified.c_str()))
+                {
+                    s.enabled.store(bit, std::memory_order_relaxed);
+                    ++matches;
+                }
+            }
+        }
+        else
+        {
+            b.global.store(bit, std::memory_order_relaxed);
+            matches = 1u;
+        }
+
+        control::refresh(b);
+        return matches;
+    }
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    auto bit = std::uint32_t{0u};
+    auto const show_only = (argc == 2);
+    auto const global = (argc == 3 && parse_switch(argv[2], bit));
+    auto const selective = (argc == 5 && (std::strcmp(argv[2], "category") == 0 || std::strcmp(argv[2], "site") == 0)
+                            && parse_switch(argv[4], bit));
+    if(!show_only && !global && !selective)
+        return usage(argv[0]);
+
+    auto const pid = std::strtol(argv[1], nullptr, 10);
+    auto const name = control::block_name(pid);
+    auto const fd = shm_open(name.c_str(), O_RDWR, 0);
+    auto const mapping = (fd != -1) ? mmap(nullptr, sizeof(control::block), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                                    : MAP_FAILED;
+    if(fd != -1)
+        close(fd);
+
+    if(mapping == MAP_FAILED || static_cast<control::block*>(mapping)->magic != control::magic)
+    {
+        std::fprintf(
+            stderr,
+            "%s: no control block found for pid %ld. Is it running with BACTRIA_CONTROL=on or off?\n",
+            argv[0],
+            pid);
+        return EXIT_FAILURE;
+    }
+
+    auto& b = *static_cast<control::block*>(mapping);
+    if(show_only)
+        show(b);
+    else
+    {
+        auto const what = global ? "global" : argv[2];
+        auto const matches = set(b, what, global ? "" : argv[3], bit);
+        if(matches == 0u)
+        {
+            std::fprintf(stderr, "%s: no %s matches %s.\n", argv[0], what, argv[3]);
+            return EXIT_FAILURE;
+        }
+        if(selective)
+        {
+            auto const plural = (std::strcmp(what, "category") == 0) ? "categories" : "sites";
+            std::printf("Switched %u %s %s.\n", matches, (matches == 1u) ? what : plural, argv[4]);
+        }
+    }
+
+    munmap(mapping, sizeof(control::block));
+    return EXIT_SUCCESS;
+}